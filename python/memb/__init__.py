@@ -1,4 +1,5 @@
-from .builder import Builder
-from .reader import Reader
+from .builder import Builder, ShardedBuilder
+from .reader import Reader, ShardedReader
 from .readers_union import ReadersUnion
+from .vocabulary import Vocabulary
 from _memb import available_compression_strategies
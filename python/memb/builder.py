@@ -9,26 +9,72 @@ class Builder:
     dim : int
         Dimension of word vectors
     storage_type : str
-        Type of storage for embeddings. Supported values are 'full', 'uniform' and
-        'trained'
+        Type of storage for embeddings. Supported values are 'full', 'uniform',
+        'trained', 'ans' and 'packed'. 'ans' quantizes like 'trained', but codes
+        the values with table ANS instead of Huffman codes, which decodes faster.
+        'packed' stores the same values in bits_per_weight bits each, trading
+        file size for the fastest decoding
     bits_per_weight : int
         Number of bits used to represent single weight. If this value is beyond
         range accepted by quantization strategy, closest supported value will be
         used instead
+    perfect_hash_index : bool
+        Store minimal perfect hash index of the vocabulary to make word lookups
+        O(1). Only 'trained', 'ans' and 'packed' storages support it, others ignore the flag
+    search_tree : bool
+        Store cache-friendly (Eytzinger ordered) copy of the sorted vocabulary,
+        which speeds up word lookups when perfect hash index is not used.
+        Only 'trained', 'ans' and 'packed' storages support it
+    ivf_lists : int
+        Number of clusters of the approximate nearest neighbour index stored
+        with the model, 0 disables the index. A few times the square root of
+        the vocabulary size is a reasonable choice
+    huffman_streams : int
+        Number of interleaved Huffman streams per vector: 1, 2, 4 or 8.
+        Several streams can be decoded in parallel by the CPU at the cost
+        of 2 bytes per vector for every additional stream. Only 'trained'
+        storage supports it
+    codebook_blocks : int
+        Split dimensions into at most this many contiguous blocks, each with
+        its own Huffman codebook. Models whose dimensions have different value
+        distributions get smaller, at a small cost in decoding speed.
+        Only 'trained' storage supports it
+    checkpoint_interval : int
+        Store bit offsets of every checkpoint_interval-th value of a vector
+        (a multiple of huffman_streams), so that Reader.batch_embedding_range_by_ids
+        skips the values before the range. Costs 2 bytes per checkpoint and stream
+        of every vector, 0 disables checkpoints. Only 'trained' storage supports it
+    decode_table_bits : int
+        Store ready Huffman lookup tables of this many bits (up to 16), which
+        readers with the same decode_table_bits and one symbol per lookup use
+        from the file instead of building them at startup. 0 disables the tables.
+        Only 'trained' storage supports it
     '''
 
-    def __init__(self, dim, storage_type='trained', bits_per_weight=4):
-        self._impl = _memb.Builder(dim, storage_type, bits_per_weight)
+    def __init__(self, dim, storage_type='trained', bits_per_weight=4,
+                 perfect_hash_index=False, search_tree=False, ivf_lists=0, huffman_streams=1,
+                 codebook_blocks=1, checkpoint_interval=0, decode_table_bits=0):
+        self._impl = _memb.Builder(
+            dim, storage_type, bits_per_weight, perfect_hash_index, search_tree, ivf_lists,
+            huffman_streams, codebook_blocks,
+            checkpoint_interval, decode_table_bits)
 
-    def add_word(self, word, vector):
+    def add_word(self, word, vector, frequency=0.0):
         '''Add word to builder
         Parameters
         ----------
         word : str
         
         vector : numpy.float32
+
+        frequency : float
+            Vectors of frequent words are stored together at the beginning of
+            the file, so that the hot part of the model occupies few pages.
+            Equally frequent words keep the insertion order, so models added
+            in frequency order (as most published ones are) need no frequencies.
+            Only 'trained', 'ans' and 'packed' storages support it
         '''
-        self._impl.add_word(word, vector)
+        self._impl.add_word(word, vector, frequency)
 
     def save(self, filename):
         '''Compress builder content and save it to file
@@ -37,3 +83,41 @@ class Builder:
         filename : str or pathlib.Path
         '''
         self._impl.save(str(filename))
+
+
+class ShardedBuilder:
+    '''Builder that splits the vocabulary into several model files described
+    by a JSON manifest. Shards are compressed in parallel and read back with
+    ShardedReader
+    Parameters
+    ----------
+    dim, storage_type, bits_per_weight, perfect_hash_index, search_tree, ivf_lists, huffman_streams,
+    codebook_blocks, checkpoint_interval, decode_table_bits
+        Same as for Builder, applied to every shard
+    shards : int
+        Number of shards for hash partitioning of the vocabulary
+    first_words : list of str
+        Smallest word of every shard for range partitioning, must start with
+        an empty string and be sorted. Overrides shards when given
+    '''
+
+    def __init__(self, dim, storage_type='trained', bits_per_weight=4, shards=1, first_words=None,
+                 perfect_hash_index=False, search_tree=False, ivf_lists=0, huffman_streams=1,
+                 codebook_blocks=1, checkpoint_interval=0, decode_table_bits=0):
+        self._impl = _memb.ShardedBuilder(
+            dim, storage_type, bits_per_weight, shards, first_words or [],
+            perfect_hash_index, search_tree, ivf_lists, huffman_streams, codebook_blocks,
+            checkpoint_interval, decode_table_bits)
+
+    def add_word(self, word, vector, frequency=0.0):
+        '''Add word to the shard responsible for it, see Builder.add_word'''
+        self._impl.add_word(word, vector, frequency)
+
+    def save(self, filename):
+        '''Save shards next to the manifest and the manifest itself
+        Parameters
+        ----------
+        filename : str or pathlib.Path
+            Manifest file name, shards are named <manifest stem>-<index>.memb
+        '''
+        self._impl.save(str(filename))
@@ -1,5 +1,8 @@
 from abc import ABC, abstractmethod
+import asyncio
+import os
 import _memb
+from .vocabulary import Vocabulary
 
 
 class BaseReader(ABC):
@@ -51,28 +54,123 @@ class Reader(BaseReader):
     reading and decoding them on the fly
     Parameters
     ----------
-    filename : str or pathib.Path
+    source : str, pathlib.Path, int or buffer
+        Model file name, open file descriptor (memfd included) or any object
+        supporting the buffer protocol, e.g. bytes, mmap.mmap or numpy array.
+        Buffers are used without copying and kept alive by the reader
+    offset, size : int
+        Part of the file descriptor holding the model, zero size means up to
+        the end of the file. Ignored for other sources
     num_threads : int
         Number of threads used to decode large batches of words.
-        Pass 0 to use as much threads as there are cores in the system
+        Pass 0 to share a process-wide pool with a thread per core
+    cache_bytes : int
+        Memory budget for decoded vectors of frequently requested words.
+        Pass 0 to disable caching
+    vocabulary_residency, decoder_residency, values_residency : str
+        How pages of the corresponding model file sections are kept in memory:
+        'default', 'random', 'willneed', 'hugepages', 'populate' (read the section
+        while opening the file) or 'lock' (read the section and pin it in memory)
+    prefetch_batches : bool
+        Request readahead for the values of batch words before decoding them
+    decode_table_bits : int
+        Bits indexing Huffman lookup tables of trained storage, up to 16.
+        Larger tables resolve more codes with a single lookup
+    symbols_per_lookup : int
+        Up to 4 codes of trained storage emitted by one table lookup.
+        Values above 1 build an extra table, 12 table bits suit them best
     Attributes
     ----------
     dim : int
         Embeddings dimension
     '''
 
-    def __init__(self, filename, num_threads=0):
+    def __init__(self, source, num_threads=0, cache_bytes=0,
+                 vocabulary_residency='default', decoder_residency='default',
+                 values_residency='default', prefetch_batches=False,
+                 offset=0, size=0, decode_table_bits=10, symbols_per_lookup=1):
         super().__init__()
-        self._impl = _memb.Reader(str(filename), num_threads)
+        if isinstance(source, os.PathLike):
+            source = os.fsdecode(source)
+        self._impl = _memb.Reader(
+            source, offset, size, num_threads, cache_bytes,
+            vocabulary_residency, decoder_residency, values_residency, prefetch_batches,
+            decode_table_bits, symbols_per_lookup)
 
     @property
     def dim(self):
         return self._impl.dim()
     
+    def __len__(self):
+        return self._impl.size()
+
     def keys(self):
         '''List of words contained in model'''
         return self._impl.keys()
 
+    @property
+    def vocabulary(self):
+        '''Lazy sequence of words contained in model supporting len(), indexing
+        by word id, slicing and iteration without building a list of all words'''
+        return Vocabulary(self._impl)
+
+    def cache_statistics(self):
+        '''Obtain dict with hits, misses, entries and capacity of the decoded vectors cache'''
+        statistics = self._impl.cache_statistics()
+        return {
+            'hits': statistics.hits,
+            'misses': statistics.misses,
+            'entries': statistics.entries,
+            'capacity': statistics.capacity
+        }
+
+    def word_id(self, word):
+        '''Obtain integer id of a word, ids are stable for a given model file
+        and lie in range [0, len(reader)). -1 is returned for missing words
+        Parameters
+        ----------
+        word : str
+        '''
+        return self._impl.word_id(word)
+
+    def batch_word_ids(self, words):
+        '''Obtain one-dimensional array of type int64 with ids of given words
+        Parameters
+        ----------
+        words : list of str
+        '''
+        return self._impl.batch_word_ids(words)
+
+    def embedding_by_id(self, word_id):
+        '''Obtain one-dimensional array of type float32 for a given word id.
+        Negative ids produce arrays filled with zeros
+        Parameters
+        ----------
+        word_id : int
+        '''
+        return self._impl.embedding_by_id(word_id)
+
+    def batch_embedding_by_ids(self, word_ids):
+        '''Obtain array of type float32 with shape word_ids.shape + (dim,).
+        Positions of negative ids are filled with zeros
+        Parameters
+        ----------
+        word_ids : numpy array of type int32 or int64
+        '''
+        return self._impl.batch_embedding_by_ids(word_ids)
+
+    def batch_embedding_range_by_ids(self, word_ids, begin, end):
+        '''Obtain dimensions [begin, end) of the vectors as an array of type
+        float32 with shape word_ids.shape + (end - begin,). Models built with
+        checkpoint_interval decode only the codes around the range
+        Parameters
+        ----------
+        word_ids : numpy array of type int32 or int64
+
+        begin, end : int
+        '''
+        return self._impl.batch_embedding_range_by_ids(word_ids, begin, end)
+
     def word_embedding(self, word):
         '''Obtain one-dimensional array of type float32 for a given word.
         If word is not present in the model, array filled with zeros is returned
@@ -91,6 +189,121 @@ class Reader(BaseReader):
         '''
         return self._impl.batch_embedding(words)
 
+    def similarity(self, first, second, metric='cosine'):
+        '''Similarity of two words computed from quantized codes without
+        decoding the vectors. Unknown words are treated as zero vectors
+        Parameters
+        ----------
+        first : str
+        second : str
+        metric : str
+            'cosine', 'dot' or 'l2', for 'l2' the result is euclidean distance
+        Returns
+        -------
+        float
+        '''
+        return self._impl.similarity(first, second, metric)
+
+    def batch_similarity(self, first_words, second_words, metric='cosine'):
+        '''Similarities of word pairs (first_words[i], second_words[i])
+        Returns
+        -------
+        numpy.float32 array of len(first_words) elements
+        '''
+        return self._impl.batch_similarity(first_words, second_words, metric)
+
+    def batch_similarity_by_ids(self, first_ids, second_ids, metric='cosine'):
+        '''Similarities of pairs given by two one-dimensional arrays of word ids,
+        negative ids are treated as zero vectors
+        '''
+        return self._impl.batch_similarity_by_ids(first_ids, second_ids, metric)
+
+    def most_similar(self, key, k=10, metric='cosine'):
+        '''Find k words with vectors most similar to a word or to a vector by
+        scanning the whole model without decoding it to floats. The word itself
+        is excluded from results
+        Parameters
+        ----------
+        key : str or one-dimensional numpy array
+        k : int
+        metric : str
+            'cosine', 'dot' or 'l2'. Results are sorted from the most similar
+            word, for 'l2' scores are euclidean distances
+        Returns
+        -------
+        list of (word, score) tuples
+        '''
+        if isinstance(key, str):
+            return self._impl.most_similar(key, k, metric)
+        return self._impl.most_similar_by_vector(key, k, metric)
+
+    def batch_most_similar(self, queries, k=10, metric='cosine'):
+        '''Find k most similar words for every row of queries
+        Parameters
+        ----------
+        queries : two-dimensional numpy array
+        k : int
+        metric : str
+            'cosine', 'dot' or 'l2'
+        Returns
+        -------
+        word ids (int64) and scores (float32), two arrays of shape (len(queries), k)
+        '''
+        return self._impl.batch_most_similar(queries, k, metric)
+
+    @property
+    def has_ann_index(self):
+        return self._impl.has_ann_index()
+
+    def approximate_most_similar(self, query, k=10, nprobe=8, metric='cosine'):
+        '''Find k words with vectors most similar to a vector using the index
+        built with `ivf_lists` builder parameter. Only words from nprobe
+        clusters closest to the query are scored
+        Parameters
+        ----------
+        query : one-dimensional numpy array
+        k : int
+        nprobe : int
+            Larger values trade speed for recall, the number of index lists
+            gives exact results
+        metric : str
+            'cosine', 'dot' or 'l2'
+        Returns
+        -------
+        list of (word, score) tuples
+        '''
+        return self._impl.approximate_most_similar(query, k, nprobe, metric)
+
+    def batch_approximate_most_similar(self, queries, k=10, nprobe=8, metric='cosine'):
+        '''Approximate version of batch_most_similar, rows with less than
+        k words found are padded with -1 ids and nan scores
+        '''
+        return self._impl.batch_approximate_most_similar(queries, k, nprobe, metric)
+
+    async def batch_embedding_async(self, words):
+        '''Coroutine version of batch_embedding. Decoding runs on the reader
+        threads without holding the GIL, so the event loop stays responsive
+        Parameters
+        ----------
+        words : list of str
+        '''
+        loop = asyncio.get_running_loop()
+        future = loop.create_future()
+
+        def set_result(result, error):
+            if future.cancelled():
+                return
+            if error is not None:
+                future.set_exception(RuntimeError(error))
+            else:
+                future.set_result(result)
+
+        def on_done(result, error):
+            loop.call_soon_threadsafe(set_result, result, error)
+
+        self._impl.batch_embedding_async(words, on_done)
+        return await future
+
     def tokenizer_embedding(self, tokenizer):
         '''Convert keras.preprocessing.text.Tokenizer to weights of Embedding layer
         Parameters
@@ -109,3 +322,52 @@ class Reader(BaseReader):
             sorted_word_list[idx] = word
 
         return self.batch_embedding(sorted_word_list)
+
+
+class ShardedReader(BaseReader):
+    '''Reader over the model files listed in a manifest saved by ShardedBuilder.
+    Word lookups are routed to the shard holding the word, batches are split
+    by shard and decoded in parallel
+    Parameters
+    ----------
+    manifest_filename : str or pathlib.Path
+    num_threads : int
+        Threads shared by all shards, 0 means a process-wide pool
+    cache_bytes : int
+        Total memory budget for decoded vectors, split evenly between shards
+    Attributes
+    ----------
+    dim : int
+        Embeddings dimension
+    '''
+
+    def __init__(self, manifest_filename, num_threads=0, cache_bytes=0):
+        super().__init__()
+        self._impl = _memb.ShardedReader(str(manifest_filename), num_threads, cache_bytes)
+
+    @property
+    def dim(self):
+        return self._impl.dim()
+
+    def __len__(self):
+        return self._impl.size()
+
+    @property
+    def shards_count(self):
+        return self._impl.shards_count()
+
+    def keys(self):
+        '''Sorted words of all shards'''
+        return self._impl.keys()
+
+    def word_embedding(self, word):
+        '''Get vector for a single word, zeros for unknown words'''
+        return self._impl.word_embedding(word)
+
+    def batch_embedding(self, words):
+        '''Get vectors for a list of words'''
+        return self._impl.batch_embedding(words)
+
+    def tokenizer_embedding(self, tokenizer):
+        '''Convert keras.preprocessing.text.Tokenizer to weights of Embedding layer'''
+        return Reader.tokenizer_embedding(self, tokenizer)
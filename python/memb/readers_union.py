@@ -1,5 +1,6 @@
 import numpy as np
-from .reader import BaseReader
+import _memb
+from .reader import BaseReader, Reader
 
 
 class AverageUnionMaker:
@@ -67,12 +68,23 @@ class ReadersUnion(BaseReader):
         self._union_maker.check(readers)
         self._readers = readers
 
+        # Native union decodes into one output matrix, other readers
+        # (e.g. nested unions) are merged with numpy
+        self._impl = None
+        if all(isinstance(reader, Reader) for reader in readers):
+            self._impl = _memb.ReadersUnion([reader._impl for reader in readers], mode)
+
     @property
     def dim(self):
+        if self._impl is not None:
+            return self._impl.dim()
         return self._union_maker.dim([reader.dim for reader in self._readers])
 
     def keys(self):
         '''Union of keys contained in wrapped models'''
+        if self._impl is not None:
+            return self._impl.keys()
+
         all_keys = set()
         for reader in self._readers:
             all_keys |= set(reader.keys())
@@ -85,6 +97,8 @@ class ReadersUnion(BaseReader):
         ----------
         word : str
         '''
+        if self._impl is not None:
+            return self._impl.word_embedding(word)
         return self._union_maker.merge([reader.word_embedding(word) for reader in self._readers])
 
     def batch_embedding(self, words):
@@ -93,6 +107,8 @@ class ReadersUnion(BaseReader):
         ----------
         words : list of str
         '''
+        if self._impl is not None:
+            return self._impl.batch_embedding(words)
         return self._union_maker.merge([reader.batch_embedding(words) for reader in self._readers])
 
     def tokenizer_embedding(self, tokenizer):
@@ -101,4 +117,6 @@ class ReadersUnion(BaseReader):
         ----------
         tokenizer : keras.preprocessing.text.Tokenizer
         '''
+        if self._impl is not None:
+            return Reader.tokenizer_embedding(self, tokenizer)
         return self._union_maker.merge([reader.tokenizer_embedding(tokenizer) for reader in self._readers])
@@ -0,0 +1,47 @@
+from collections.abc import Sequence
+
+
+class Vocabulary(Sequence):
+    '''Lazy sequence of words contained in a model, ordered by word ids.
+    Words are read from the model file on request, so listing a large
+    vocabulary does not require to keep all of it in memory
+    Parameters
+    ----------
+    reader_impl : _memb.Reader
+    '''
+
+    CHUNK_SIZE = 4096
+
+    def __init__(self, reader_impl):
+        self._impl = reader_impl
+
+    def __len__(self):
+        return self._impl.size()
+
+    def __getitem__(self, index):
+        if isinstance(index, slice):
+            begin, end, step = index.indices(len(self))
+            if step == 1:
+                return self._impl.words(begin, max(begin, end))
+            return [self._impl.word(word_id) for word_id in range(begin, end, step)]
+
+        if index < 0:
+            index += len(self)
+        if index < 0 or index >= len(self):
+            raise IndexError('Vocabulary index is out of range')
+
+        return self._impl.word(index)
+
+    def __iter__(self):
+        for begin in range(0, len(self), self.CHUNK_SIZE):
+            yield from self._impl.words(begin, begin + self.CHUNK_SIZE)
+
+    def __contains__(self, word):
+        return isinstance(word, str) and self._impl.word_id(word) >= 0
+
+    def index(self, word, *args):
+        word_id = self._impl.word_id(word) if isinstance(word, str) else -1
+        if word_id < 0:
+            raise ValueError('{} is not in vocabulary'.format(word))
+
+        return word_id
@@ -1,31 +1,314 @@
 #include "builder.h"
 #include "reader.h"
 #include "compression_strategy.h"
+#include "sharded_reader.h"
+#include "readers_union.h"
 
 #include <pybind11/pybind11.h>
 #include <pybind11/stl.h>
 #include <pybind11/numpy.h>
 
+#include <limits>
+
 namespace py = pybind11;
 
+namespace {
+
+template <typename Builder>
+void addWord(Builder& builder, const std::string& word, py::array_t<float, py::array::c_style> values, double frequency)
+{
+    auto valuesBuffer = values.request();
+    if (valuesBuffer.ndim != 1) {
+        throw std::runtime_error("Word vector must be 1-dimensional");
+    }
+
+    float* valuesPointer = reinterpret_cast<float*>(valuesBuffer.ptr);
+
+    builder.addWord(
+        word,
+        std::vector<float>(valuesPointer, valuesPointer + valuesBuffer.shape[0]),
+        frequency);
+}
+
+template <typename WordId>
+py::array_t<float> batchEmbeddingByIds(
+    const memb::Reader& reader,
+    py::array_t<WordId, py::array::c_style | py::array::forcecast> wordIds)
+{
+    std::vector<size_t> shape(wordIds.shape(), wordIds.shape() + wordIds.ndim());
+    shape.push_back(reader.dim());
+
+    py::array_t<float> result(shape);
+    auto buffer = result.request();
+    {
+        py::gil_scoped_release release;
+        reader.batchEmbeddingByIdsToBuffer(
+            wordIds.data(), wordIds.size(), reinterpret_cast<float*>(buffer.ptr));
+    }
+
+    return result;
+}
+
+py::array_t<float> batchEmbeddingRangeByIds(
+    const memb::Reader& reader,
+    py::array_t<int64_t, py::array::c_style | py::array::forcecast> wordIds,
+    size_t begin,
+    size_t end)
+{
+    std::vector<size_t> shape(wordIds.shape(), wordIds.shape() + wordIds.ndim());
+    shape.push_back(end > begin ? end - begin : 0);
+
+    py::array_t<float> result(shape);
+    auto buffer = result.request();
+    {
+        py::gil_scoped_release release;
+        reader.batchEmbeddingRangeByIdsToBuffer(
+            wordIds.data(), wordIds.size(), begin, end, reinterpret_cast<float*>(buffer.ptr));
+    }
+
+    return result;
+}
+
+py::array_t<float> batchSimilarityByIds(
+    const memb::Reader& reader,
+    py::array_t<int64_t, py::array::c_style | py::array::forcecast> firstIds,
+    py::array_t<int64_t, py::array::c_style | py::array::forcecast> secondIds,
+    const std::string& metric)
+{
+    if (firstIds.ndim() != 1 || secondIds.ndim() != 1 || firstIds.shape(0) != secondIds.shape(0)) {
+        throw std::runtime_error("Word ids must be 1-dimensional arrays of equal size");
+    }
+
+    auto parsedMetric = memb::parseSimilarityMetric(metric);
+    py::array_t<float> result(firstIds.shape(0));
+    auto buffer = result.request();
+    {
+        py::gil_scoped_release release;
+        reader.batchSimilarityByIdsToBuffer(
+            firstIds.data(), secondIds.data(), firstIds.size(), reinterpret_cast<float*>(buffer.ptr), parsedMetric);
+    }
+
+    return result;
+}
+
+// Filenames are mapped, integers are treated as file descriptors and
+// anything else must expose a contiguous buffer, which is used without copying
+memb::ModelBuffer modelBuffer(const py::object& source, size_t offset, size_t size)
+{
+    if (py::isinstance<py::str>(source)) {
+        return memb::ModelBuffer::fromFile(source.cast<std::string>());
+    }
+
+    if (py::isinstance<py::int_>(source)) {
+        return memb::ModelBuffer::fromFileDescriptor(source.cast<int>(), offset, size);
+    }
+
+    std::unique_ptr<Py_buffer> rawView(new Py_buffer());
+    if (PyObject_GetBuffer(source.ptr(), rawView.get(), PyBUF_SIMPLE) != 0) {
+        throw py::error_already_set();
+    }
+
+    // Releasing the view may run Python code of the exporter
+    std::shared_ptr<Py_buffer> view(
+        rawView.release(),
+        [](Py_buffer* view)
+        {
+            py::gil_scoped_acquire acquire;
+            PyBuffer_Release(view);
+            delete view;
+        });
+
+    return memb::ModelBuffer::fromMemory(view->buf, view->len, view);
+}
+
+py::list vocabularySlice(const memb::Reader& reader, size_t begin, size_t end)
+{
+    auto vocabulary = reader.vocabulary();
+    end = std::min(end, vocabulary.size());
+    begin = std::min(begin, end);
+
+    py::list result(end - begin);
+    for (size_t wordId = begin; wordId < end; ++wordId) {
+        auto word = vocabulary[wordId];
+        result[wordId - begin] = py::str(word.data(), word.size());
+    }
+
+    return result;
+}
+
+py::list neighboursToList(const memb::Reader& reader, const std::vector<memb::Neighbour>& neighbours)
+{
+    auto vocabulary = reader.vocabulary();
+    py::list result;
+    for (const auto& neighbour : neighbours) {
+        auto word = vocabulary[neighbour.wordId];
+        result.append(py::make_tuple(py::str(word.data(), word.size()), neighbour.score));
+    }
+
+    return result;
+}
+
+void checkQueries(const memb::Reader& reader, const py::array_t<float, py::array::c_style | py::array::forcecast>& queries)
+{
+    if (queries.ndim() != 2 || static_cast<size_t>(queries.shape(1)) != reader.dim()) {
+        throw std::runtime_error("Queries must be a 2-dimensional array with a row per query");
+    }
+}
+
+// Returns word ids and scores as two arrays of shape (queries count, k),
+// rows with less than k neighbours are padded with -1 ids and nan scores
+py::tuple neighboursToArrays(
+    const memb::Reader& reader,
+    const std::vector<std::vector<memb::Neighbour>>& neighbours,
+    size_t k)
+{
+    size_t queriesCount = neighbours.size();
+    size_t resultSize = std::min(k, reader.size());
+    py::array_t<int64_t> wordIds({queriesCount, resultSize});
+    py::array_t<float> scores({queriesCount, resultSize});
+    auto wordIdsData = wordIds.mutable_data();
+    auto scoresData = scores.mutable_data();
+    for (size_t query = 0; query < queriesCount; ++query) {
+        for (size_t i = 0; i < resultSize; ++i) {
+            bool found = i < neighbours[query].size();
+            wordIdsData[query * resultSize + i] = found ? neighbours[query][i].wordId : -1;
+            scoresData[query * resultSize + i] =
+                found ? neighbours[query][i].score : std::numeric_limits<float>::quiet_NaN();
+        }
+    }
+
+    return py::make_tuple(wordIds, scores);
+}
+
+py::tuple batchMostSimilar(
+    const memb::Reader& reader,
+    py::array_t<float, py::array::c_style | py::array::forcecast> queries,
+    size_t k,
+    const std::string& metric)
+{
+    checkQueries(reader, queries);
+
+    auto parsedMetric = memb::parseSimilarityMetric(metric);
+    std::vector<std::vector<memb::Neighbour>> neighbours;
+    {
+        py::gil_scoped_release release;
+        neighbours = reader.batchMostSimilar(queries.data(), queries.shape(0), k, parsedMetric);
+    }
+
+    return neighboursToArrays(reader, neighbours, k);
+}
+
+py::tuple batchApproximateMostSimilar(
+    const memb::Reader& reader,
+    py::array_t<float, py::array::c_style | py::array::forcecast> queries,
+    size_t k,
+    size_t nprobe,
+    const std::string& metric)
+{
+    checkQueries(reader, queries);
+
+    auto parsedMetric = memb::parseSimilarityMetric(metric);
+    std::vector<std::vector<memb::Neighbour>> neighbours;
+    {
+        py::gil_scoped_release release;
+        neighbours = reader.batchApproximateMostSimilar(queries.data(), queries.shape(0), k, nprobe, parsedMetric);
+    }
+
+    return neighboursToArrays(reader, neighbours, k);
+}
+
+// Objects of a pending request, Python ones are released by the completion
+// callback while it holds the GIL. The reader is kept alive until then,
+// even if Python drops it while the request is queued
+struct AsyncBatch {
+    std::shared_ptr<memb::Reader> reader;
+    py::array_t<float> result;
+    py::function callback;
+};
+
+void batchEmbeddingAsync(
+    const std::shared_ptr<memb::Reader>& reader,
+    std::vector<std::string> words,
+    py::function callback)
+{
+    auto batch = new AsyncBatch{reader, py::array_t<float>({words.size(), reader->dim()}), callback};
+    float* buffer = batch->result.mutable_data();
+
+    reader->batchEmbeddingAsync(
+        std::move(words),
+        buffer,
+        [batch](std::exception_ptr error)
+        {
+            // Released after the GIL, destroying the reader may wait for its threads
+            std::shared_ptr<memb::Reader> reader = std::move(batch->reader);
+            py::gil_scoped_acquire acquire;
+            std::unique_ptr<AsyncBatch> batchHolder(batch);
+
+            try {
+                if (error) {
+                    try {
+                        std::rethrow_exception(error);
+                    } catch (const std::exception& exception) {
+                        batchHolder->callback(py::none(), exception.what());
+                    } catch (...) {
+                        batchHolder->callback(py::none(), "Unknown decoding error");
+                    }
+                } else {
+                    batchHolder->callback(batchHolder->result, py::none());
+                }
+            } catch (py::error_already_set& pythonError) {
+                // There is nobody to report to on a decoding thread
+                pythonError.restore();
+                PyErr_WriteUnraisable(batchHolder->callback.ptr());
+            }
+        });
+}
+
+} // namespace
+
 PYBIND11_MODULE(_memb, m) {
     py::class_<memb::Builder>(m, "Builder")
-        .def(py::init<size_t, const std::string&, size_t>())
         .def(
-            "add_word",
-            [](memb::Builder& builder, const std::string& word, py::array_t<float, py::array::c_style> values)
-            {
-                auto valuesBuffer = values.request();
-                if (valuesBuffer.ndim != 1) {
-                    throw std::runtime_error("Word vector must be 1-dimensional");
-                }
+            py::init(
+                [](size_t dim,
+                   const std::string& storageType,
+                   size_t bitsPerWeight,
+                   bool perfectHashIndex,
+                   bool searchTree,
+                   size_t ivfLists,
+                   size_t huffmanStreams,
+                   size_t codebookBlocks,
+                   size_t checkpointInterval,
+                   size_t decodeTableBits)
+                {
+                    memb::CompressionOptions options;
+                    options.perfectHashIndex = perfectHashIndex;
+                    options.searchTree = searchTree;
+                    options.ivfListsCount = ivfLists;
+                    options.huffmanStreams = huffmanStreams;
+                    options.codebookBlocks = codebookBlocks;
+                    options.checkpointInterval = checkpointInterval;
+                    options.decodeTableBits = decodeTableBits;
 
-                float* valuesPointer = reinterpret_cast<float*>(valuesBuffer.ptr);
-
-                builder.addWord(
-                    word,
-                    std::vector<float>(valuesPointer, valuesPointer + valuesBuffer.shape[0]));
-            })
+                    return std::unique_ptr<memb::Builder>(
+                        new memb::Builder(dim, storageType, bitsPerWeight, options));
+                }),
+            py::arg("dim"),
+            py::arg("storage_type"),
+            py::arg("bits_per_weight"),
+            py::arg("perfect_hash_index") = false,
+            py::arg("search_tree") = false,
+            py::arg("ivf_lists") = 0,
+            py::arg("huffman_streams") = 1,
+            py::arg("codebook_blocks") = 1,
+            py::arg("checkpoint_interval") = 0,
+            py::arg("decode_table_bits") = 0)
+        .def(
+            "add_word",
+            &addWord<memb::Builder>,
+            py::arg("word"),
+            py::arg("values"),
+            py::arg("frequency") = 0.0)
         .def(
             "save",
             [](memb::Builder& builder, const std::string& filename)
@@ -33,8 +316,50 @@ PYBIND11_MODULE(_memb, m) {
                 builder.save(filename);
             });
 
-    py::class_<memb::Reader>(m, "Reader")
-        .def(py::init<std::string, size_t>())
+    py::class_<memb::CacheStatistics>(m, "CacheStatistics")
+        .def_readonly("hits", &memb::CacheStatistics::hits)
+        .def_readonly("misses", &memb::CacheStatistics::misses)
+        .def_readonly("entries", &memb::CacheStatistics::entries)
+        .def_readonly("capacity", &memb::CacheStatistics::capacity);
+
+    py::class_<memb::Reader, std::shared_ptr<memb::Reader>>(m, "Reader")
+        .def(
+            py::init(
+                [](const py::object& source,
+                   size_t offset,
+                   size_t size,
+                   size_t numThreads,
+                   size_t cacheBytes,
+                   const std::string& vocabularyResidency,
+                   const std::string& decoderResidency,
+                   const std::string& valuesResidency,
+                   bool prefetchBatches,
+                   size_t decodeTableBits,
+                   size_t symbolsPerLookup)
+                {
+                    memb::ReaderOptions options;
+                    options.numThreads = numThreads;
+                    options.cacheBytes = cacheBytes;
+                    options.residency.vocabulary = memb::parseResidencyPolicy(vocabularyResidency);
+                    options.residency.decoder = memb::parseResidencyPolicy(decoderResidency);
+                    options.residency.values = memb::parseResidencyPolicy(valuesResidency);
+                    options.residency.prefetchBatches = prefetchBatches;
+                    options.decoding.decodeTableBits = decodeTableBits;
+                    options.decoding.symbolsPerLookup = symbolsPerLookup;
+
+                    return std::make_shared<memb::Reader>(modelBuffer(source, offset, size), options);
+                }),
+            py::arg("source"),
+            py::arg("offset") = 0,
+            py::arg("size") = 0,
+            py::arg("num_threads") = 0,
+            py::arg("cache_bytes") = 0,
+            py::arg("vocabulary_residency") = "default",
+            py::arg("decoder_residency") = "default",
+            py::arg("values_residency") = "default",
+            py::arg("prefetch_batches") = false,
+            py::arg("decode_table_bits") = memb::DecodingOptions().decodeTableBits,
+            py::arg("symbols_per_lookup") = 1)
         .def(
             "dim",
             [](memb::Reader& reader)
@@ -57,15 +382,297 @@ PYBIND11_MODULE(_memb, m) {
             {
                 py::array_t<float> result({words.size(), reader.dim()});
                 auto buffer = result.request();
-                reader.batchEmbeddingToBuffer(words, reinterpret_cast<float*>(buffer.ptr));
+                {
+                    py::gil_scoped_release release;
+                    reader.batchEmbeddingToBuffer(words, reinterpret_cast<float*>(buffer.ptr));
+                }
 
                 return result;
             })
+        .def("batch_embedding_async", &batchEmbeddingAsync)
         .def(
             "keys",
             [](memb::Reader& reader)
             {
-                return reader.keys();
+                return vocabularySlice(reader, 0, reader.size());
+            })
+        .def("words", &vocabularySlice)
+        .def(
+            "word",
+            [](memb::Reader& reader, size_t wordId)
+            {
+                if (wordId >= reader.size()) {
+                    throw py::index_error("Word id is out of range");
+                }
+
+                auto word = reader.vocabulary()[wordId];
+                return py::str(word.data(), word.size());
+            })
+        .def(
+            "size",
+            [](memb::Reader& reader)
+            {
+                return reader.size();
+            })
+        .def(
+            "word_id",
+            [](memb::Reader& reader, const std::string& word)
+            {
+                py::gil_scoped_release release;
+                return reader.wordId(word);
+            })
+        .def(
+            "batch_word_ids",
+            [](memb::Reader& reader, const std::vector<std::string>& words)
+            {
+                py::array_t<int64_t> result(words.size());
+                auto buffer = result.request();
+                {
+                    py::gil_scoped_release release;
+                    reader.batchWordIdsToBuffer(words, reinterpret_cast<int64_t*>(buffer.ptr));
+                }
+
+                return result;
+            })
+        .def(
+            "embedding_by_id",
+            [](memb::Reader& reader, int64_t wordId)
+            {
+                py::array_t<float> result(reader.dim());
+                auto buffer = result.request();
+                {
+                    py::gil_scoped_release release;
+                    reader.embeddingByIdToBuffer(wordId, reinterpret_cast<float*>(buffer.ptr));
+                }
+
+                return result;
+            })
+        .def("batch_embedding_by_ids", &batchEmbeddingByIds<int64_t>)
+        .def("batch_embedding_by_ids", &batchEmbeddingByIds<int32_t>)
+        .def("batch_embedding_range_by_ids", &batchEmbeddingRangeByIds)
+        .def(
+            "similarity",
+            [](memb::Reader& reader, const std::string& first, const std::string& second, const std::string& metric)
+            {
+                return reader.similarity(first, second, memb::parseSimilarityMetric(metric));
+            })
+        .def(
+            "batch_similarity",
+            [](memb::Reader& reader,
+               const std::vector<std::string>& firstWords,
+               const std::vector<std::string>& secondWords,
+               const std::string& metric)
+            {
+                auto parsedMetric = memb::parseSimilarityMetric(metric);
+                std::vector<float> result;
+                {
+                    py::gil_scoped_release release;
+                    result = reader.batchSimilarity(firstWords, secondWords, parsedMetric);
+                }
+
+                return py::array_t<float>(result.size(), result.data());
+            })
+        .def("batch_similarity_by_ids", &batchSimilarityByIds)
+        .def(
+            "most_similar",
+            [](memb::Reader& reader, const std::string& word, size_t k, const std::string& metric)
+            {
+                auto parsedMetric = memb::parseSimilarityMetric(metric);
+                std::vector<memb::Neighbour> neighbours;
+                {
+                    py::gil_scoped_release release;
+                    neighbours = reader.mostSimilar(word, k, parsedMetric);
+                }
+
+                return neighboursToList(reader, neighbours);
+            })
+        .def(
+            "most_similar_by_vector",
+            [](memb::Reader& reader,
+               py::array_t<float, py::array::c_style | py::array::forcecast> query,
+               size_t k,
+               const std::string& metric)
+            {
+                if (query.ndim() != 1 || static_cast<size_t>(query.shape(0)) != reader.dim()) {
+                    throw std::runtime_error("Query must be a 1-dimensional array of model dimension");
+                }
+
+                auto parsedMetric = memb::parseSimilarityMetric(metric);
+                std::vector<memb::Neighbour> neighbours;
+                {
+                    py::gil_scoped_release release;
+                    neighbours = reader.mostSimilar(query.data(), k, parsedMetric);
+                }
+
+                return neighboursToList(reader, neighbours);
+            })
+        .def("batch_most_similar", &batchMostSimilar)
+        .def("has_ann_index", &memb::Reader::hasAnnIndex)
+        .def(
+            "approximate_most_similar",
+            [](memb::Reader& reader,
+               py::array_t<float, py::array::c_style | py::array::forcecast> query,
+               size_t k,
+               size_t nprobe,
+               const std::string& metric)
+            {
+                if (query.ndim() != 1 || static_cast<size_t>(query.shape(0)) != reader.dim()) {
+                    throw std::runtime_error("Query must be a 1-dimensional array of model dimension");
+                }
+
+                auto parsedMetric = memb::parseSimilarityMetric(metric);
+                std::vector<memb::Neighbour> neighbours;
+                {
+                    py::gil_scoped_release release;
+                    neighbours = reader.approximateMostSimilar(query.data(), k, nprobe, parsedMetric);
+                }
+
+                return neighboursToList(reader, neighbours);
+            })
+        .def("batch_approximate_most_similar", &batchApproximateMostSimilar)
+        .def(
+            "cache_statistics",
+            [](memb::Reader& reader)
+            {
+                return reader.cacheStatistics();
+            });
+
+    py::class_<memb::ShardedBuilder>(m, "ShardedBuilder")
+        .def(
+            py::init(
+                [](size_t dim,
+                   const std::string& storageType,
+                   size_t bitsPerWeight,
+                   size_t shards,
+                   const std::vector<std::string>& firstWords,
+                   bool perfectHashIndex,
+                   bool searchTree,
+                   size_t ivfLists,
+                   size_t huffmanStreams,
+                   size_t codebookBlocks,
+                   size_t checkpointInterval,
+                   size_t decodeTableBits)
+                {
+                    memb::CompressionOptions options;
+                    options.perfectHashIndex = perfectHashIndex;
+                    options.searchTree = searchTree;
+                    options.ivfListsCount = ivfLists;
+                    options.huffmanStreams = huffmanStreams;
+                    options.codebookBlocks = codebookBlocks;
+                    options.checkpointInterval = checkpointInterval;
+                    options.decodeTableBits = decodeTableBits;
+
+                    if (!firstWords.empty()) {
+                        return std::unique_ptr<memb::ShardedBuilder>(
+                            new memb::ShardedBuilder(dim, storageType, bitsPerWeight, firstWords, options));
+                    }
+
+                    return std::unique_ptr<memb::ShardedBuilder>(
+                        new memb::ShardedBuilder(dim, storageType, bitsPerWeight, shards, options));
+                }),
+            py::arg("dim"),
+            py::arg("storage_type"),
+            py::arg("bits_per_weight"),
+            py::arg("shards"),
+            py::arg("first_words"),
+            py::arg("perfect_hash_index") = false,
+            py::arg("search_tree") = false,
+            py::arg("ivf_lists") = 0,
+            py::arg("huffman_streams") = 1,
+            py::arg("codebook_blocks") = 1,
+            py::arg("checkpoint_interval") = 0,
+            py::arg("decode_table_bits") = 0)
+        .def(
+            "add_word",
+            &addWord<memb::ShardedBuilder>,
+            py::arg("word"),
+            py::arg("values"),
+            py::arg("frequency") = 0.0)
+        .def(
+            "save",
+            [](memb::ShardedBuilder& builder, const std::string& manifestFilename)
+            {
+                py::gil_scoped_release release;
+                builder.save(manifestFilename);
+            });
+
+    py::class_<memb::ShardedReader>(m, "ShardedReader")
+        .def(
+            py::init(
+                [](const std::string& manifestFilename, size_t numThreads, size_t cacheBytes)
+                {
+                    memb::ReaderOptions options;
+                    options.numThreads = numThreads;
+                    options.cacheBytes = cacheBytes;
+
+                    return std::unique_ptr<memb::ShardedReader>(
+                        new memb::ShardedReader(manifestFilename, options));
+                }),
+            py::arg("manifest_filename"),
+            py::arg("num_threads") = 0,
+            py::arg("cache_bytes") = 0)
+        .def("dim", &memb::ShardedReader::dim)
+        .def("size", &memb::ShardedReader::size)
+        .def("shards_count", &memb::ShardedReader::shardsCount)
+        .def("keys", &memb::ShardedReader::keys)
+        .def(
+            "word_embedding",
+            [](memb::ShardedReader& reader, const std::string& word)
+            {
+                py::array_t<float> result(reader.dim());
+                auto buffer = result.request();
+                reader.wordEmbeddingToBuffer(word, reinterpret_cast<float*>(buffer.ptr));
+
+                return result;
+            })
+        .def(
+            "batch_embedding",
+            [](memb::ShardedReader& reader, const std::vector<std::string>& words)
+            {
+                py::array_t<float> result({words.size(), reader.dim()});
+                auto buffer = result.request();
+                {
+                    py::gil_scoped_release release;
+                    reader.batchEmbeddingToBuffer(words, reinterpret_cast<float*>(buffer.ptr));
+                }
+
+                return result;
+            });
+
+    py::class_<memb::ReadersUnion>(m, "ReadersUnion")
+        .def(
+            py::init(
+                [](const std::vector<std::shared_ptr<memb::Reader>>& readers, const std::string& mode)
+                {
+                    return std::unique_ptr<memb::ReadersUnion>(
+                        new memb::ReadersUnion(readers, memb::parseUnionMode(mode)));
+                }),
+            py::arg("readers"),
+            py::arg("mode"))
+        .def("dim", &memb::ReadersUnion::dim)
+        .def("keys", &memb::ReadersUnion::keys)
+        .def(
+            "word_embedding",
+            [](memb::ReadersUnion& readersUnion, const std::string& word)
+            {
+                py::array_t<float> result(readersUnion.dim());
+                auto buffer = result.request();
+                readersUnion.wordEmbeddingToBuffer(word, reinterpret_cast<float*>(buffer.ptr));
+
+                return result;
+            })
+        .def(
+            "batch_embedding",
+            [](memb::ReadersUnion& readersUnion, const std::vector<std::string>& words)
+            {
+                py::array_t<float> result({words.size(), readersUnion.dim()});
+                auto buffer = result.request();
+                {
+                    py::gil_scoped_release release;
+                    readersUnion.batchEmbeddingToBuffer(words, reinterpret_cast<float*>(buffer.ptr));
+                }
+
+                return result;
             });
 
     m.def("available_compression_strategies", &memb::availableCompressionStrategies);
@@ -0,0 +1,102 @@
+#include "benchmark.h"
+#include "reader.h"
+
+#include <boost/test/unit_test.hpp>
+
+#include <unordered_set>
+
+using namespace memb;
+
+namespace {
+
+const std::string ANN_MODEL_FILENAME = "ann_benchmark.bin";
+const size_t WORDS_COUNT = 50000;
+const size_t CLUSTERS_COUNT = 200;
+const size_t LISTS_COUNT = 256;
+const size_t QUERIES_COUNT = 100;
+const size_t DIM = 100;
+const size_t K = 10;
+
+std::vector<float> clusteredVectors(size_t count, const std::vector<float>& centers, std::mt19937& generator)
+{
+    std::normal_distribution<float> distribution;
+    std::vector<float> result(count * DIM);
+    for (size_t i = 0; i < count; ++i) {
+        size_t cluster = generator() % CLUSTERS_COUNT;
+        for (size_t j = 0; j < DIM; ++j) {
+            result[i * DIM + j] = centers[cluster * DIM + j] + distribution(generator);
+        }
+    }
+
+    return result;
+}
+
+void reportSearch(const std::string& name, double seconds, double recall)
+{
+    std::cout << std::left << std::setw(48) << name << " "
+        << std::fixed << std::setprecision(0) << QUERIES_COUNT / seconds << " queries/s, recall@10 "
+        << std::setprecision(3) << recall << std::endl;
+}
+
+} // namespace
+
+BOOST_AUTO_TEST_SUITE(approximateSearch)
+
+BOOST_AUTO_TEST_CASE(ivfRecallAndThroughput)
+{
+    std::mt19937 generator(42);
+    std::normal_distribution<float> distribution;
+    std::vector<float> centers(CLUSTERS_COUNT * DIM);
+    for (auto& value : centers) {
+        value = 2 * distribution(generator);
+    }
+
+    auto vectors = clusteredVectors(WORDS_COUNT, centers, generator);
+    auto words = benchmarkWords(WORDS_COUNT);
+
+    CompressionOptions options;
+    options.ivfListsCount = LISTS_COUNT;
+    Builder builder(DIM, "trained", 4, options);
+    for (size_t i = 0; i < WORDS_COUNT; ++i) {
+        builder.addWord(words[i], std::vector<float>(vectors.begin() + i * DIM, vectors.begin() + (i + 1) * DIM));
+    }
+    builder.save(ANN_MODEL_FILENAME);
+
+    Reader reader(ANN_MODEL_FILENAME, 1);
+    auto queries = clusteredVectors(QUERIES_COUNT, centers, generator);
+
+    std::vector<std::vector<Neighbour>> expected;
+    auto exactSeconds = measureSeconds(
+        [&]()
+        {
+            expected = reader.batchMostSimilar(queries.data(), QUERIES_COUNT, K);
+        });
+    reportSearch("exact search", exactSeconds, 1.0);
+
+    for (size_t nprobe : {1, 4, 16, 64}) {
+        std::vector<std::vector<Neighbour>> neighbours;
+        auto seconds = measureSeconds(
+            [&]()
+            {
+                neighbours = reader.batchApproximateMostSimilar(queries.data(), QUERIES_COUNT, K, nprobe);
+            });
+
+        size_t found = 0;
+        for (size_t query = 0; query < QUERIES_COUNT; ++query) {
+            std::unordered_set<int64_t> expectedIds;
+            for (const auto& neighbour : expected[query]) {
+                expectedIds.insert(neighbour.wordId);
+            }
+            for (const auto& neighbour : neighbours[query]) {
+                found += expectedIds.count(neighbour.wordId);
+            }
+        }
+
+        reportSearch(
+            "ivf, nprobe " + std::to_string(nprobe),
+            seconds,
+            static_cast<double>(found) / (QUERIES_COUNT * K));
+    }
+}
+
+BOOST_AUTO_TEST_SUITE_END()
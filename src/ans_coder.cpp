@@ -0,0 +1,197 @@
+#include "ans_coder.h"
+#include "bit_stream.h"
+
+#include <boost/format.hpp>
+
+#include <algorithm>
+#include <numeric>
+#include <stdexcept>
+
+namespace memb {
+
+namespace {
+
+size_t floorLog2(size_t value)
+{
+    size_t result = 0;
+    while (value >>= 1) {
+        ++result;
+    }
+
+    return result;
+}
+
+void checkTableLog(size_t tableLog)
+{
+    if (tableLog < AnsEncoder::MIN_TABLE_LOG || tableLog > AnsEncoder::MAX_TABLE_LOG) {
+        throw std::runtime_error(boost::str(
+            boost::format("ANS table log must be between %1% and %2%, got %3%") %
+            AnsEncoder::MIN_TABLE_LOG % AnsEncoder::MAX_TABLE_LOG % tableLog));
+    }
+}
+
+// Every present symbol keeps at least one slot, rounding errors
+// are compensated by the most frequent symbols
+std::vector<uint16_t> normalizeFrequencies(const std::vector<size_t>& counts, size_t tableLog)
+{
+    size_t tableSize = 1U << tableLog;
+    size_t total = std::accumulate(counts.begin(), counts.end(), size_t(0));
+    if (total == 0) {
+        throw std::runtime_error("ANS coder needs at least one symbol");
+    }
+
+    std::vector<uint16_t> result(counts.size(), 0);
+    std::vector<size_t> symbols;
+    size_t assigned = 0;
+    for (size_t symbol = 0; symbol < counts.size(); ++symbol) {
+        if (counts[symbol] > 0) {
+            double scaledCount = static_cast<double>(counts[symbol]) * tableSize / total;
+            result[symbol] = std::max<size_t>(1, static_cast<size_t>(scaledCount + 0.5));
+            assigned += result[symbol];
+            symbols.push_back(symbol);
+        }
+    }
+
+    if (symbols.size() > tableSize) {
+        throw std::runtime_error(boost::str(
+            boost::format("ANS table of %1% slots cannot hold %2% symbols") % tableSize % symbols.size()));
+    }
+
+    std::stable_sort(
+        symbols.begin(),
+        symbols.end(),
+        [&counts](size_t lhs, size_t rhs)
+        {
+            return counts[lhs] > counts[rhs];
+        });
+
+    for (size_t i = 0; assigned != tableSize; i = (i + 1) % symbols.size()) {
+        auto& frequency = result[symbols[i]];
+        if (assigned < tableSize) {
+            ++frequency;
+            ++assigned;
+        } else if (frequency > 1) {
+            --frequency;
+            --assigned;
+        }
+    }
+
+    return result;
+}
+
+// Slots of every symbol are scattered over the table with an odd step,
+// which visits every slot once and keeps the states of a symbol apart
+std::vector<uint8_t> spreadSymbols(const std::vector<uint16_t>& frequencies, size_t tableLog)
+{
+    size_t tableSize = 1U << tableLog;
+    size_t step = (tableSize >> 1) + (tableSize >> 3) + 3;
+
+    std::vector<uint8_t> result(tableSize);
+    size_t position = 0;
+    for (size_t symbol = 0; symbol < frequencies.size(); ++symbol) {
+        for (size_t i = 0; i < frequencies[symbol]; ++i) {
+            result[position] = symbol;
+            position = (position + step) & (tableSize - 1);
+        }
+    }
+
+    return result;
+}
+
+} // namespace
+
+const size_t AnsEncoder::STATES_COUNT;
+const size_t AnsEncoder::MIN_TABLE_LOG;
+const size_t AnsEncoder::MAX_TABLE_LOG;
+const size_t AnsDecoder::SYMBOLS_PER_REFILL;
+
+AnsEncoder::AnsEncoder(const std::vector<size_t>& counts, size_t tableLog):
+    tableLog_(tableLog)
+{
+    checkTableLog(tableLog_);
+    frequencies_ = normalizeFrequencies(counts, tableLog_);
+
+    cumulativeFrequencies_.assign(frequencies_.size() + 1, 0);
+    std::partial_sum(frequencies_.begin(), frequencies_.end(), cumulativeFrequencies_.begin() + 1);
+
+    size_t tableSize = 1U << tableLog_;
+    auto positions = cumulativeFrequencies_;
+    nextStates_.resize(tableSize);
+    auto spread = spreadSymbols(frequencies_, tableLog_);
+    for (size_t slot = 0; slot < tableSize; ++slot) {
+        nextStates_[positions[spread[slot]]++] = tableSize + slot;
+    }
+}
+
+// Symbols are encoded from the last one, so the chunks of bits are
+// written in reverse and the decoder reads the stream forward
+std::vector<uint8_t> AnsEncoder::encode(const std::vector<uint8_t>& data) const
+{
+    size_t tableSize = 1U << tableLog_;
+    std::array<size_t, STATES_COUNT> states;
+    states.fill(tableSize);
+
+    std::vector<PrefixCode> chunks;
+    chunks.reserve(data.size() + STATES_COUNT);
+    for (size_t i = data.size(); i-- > 0;) {
+        auto& state = states[i % STATES_COUNT];
+        auto symbol = data[i];
+        size_t frequency = frequencies_[symbol];
+
+        size_t bitsCount = 0;
+        while ((state >> bitsCount) >= 2 * frequency) {
+            ++bitsCount;
+        }
+        chunks.push_back({static_cast<uint16_t>(state & ((1U << bitsCount) - 1)), bitsCount});
+        state = nextStates_[cumulativeFrequencies_[symbol] + (state >> bitsCount) - frequency];
+    }
+
+    for (size_t i = STATES_COUNT; i-- > 0;) {
+        chunks.push_back({static_cast<uint16_t>(states[i] - tableSize), tableLog_});
+    }
+
+    BitStream bitStream;
+    for (auto chunk = chunks.rbegin(); chunk != chunks.rend(); ++chunk) {
+        bitStream.push(*chunk);
+    }
+
+    return bitStream.data();
+}
+
+flatbuffers::Offset<wire::AnsDecoder> AnsEncoder::saveDecoder(flatbuffers::FlatBufferBuilder& builder) const
+{
+    return wire::CreateAnsDecoder(builder, tableLog_, builder.CreateVector(frequencies_));
+}
+
+AnsDecoder::AnsDecoder(const std::vector<uint16_t>& frequencies, size_t tableLog):
+    tableLog_(tableLog)
+{
+    checkTableLog(tableLog_);
+    size_t tableSize = 1U << tableLog_;
+    if (std::accumulate(frequencies.begin(), frequencies.end(), size_t(0)) != tableSize) {
+        throw std::runtime_error("ANS frequencies do not fill the decoding table");
+    }
+
+    // Slots of a symbol get consecutive states from [frequency, 2 * frequency),
+    // which are scaled back to the table with the bits read from the stream
+    std::vector<size_t> states(frequencies.begin(), frequencies.end());
+    auto spread = spreadSymbols(frequencies, tableLog_);
+    table_.reserve(tableSize);
+    for (auto symbol : spread) {
+        size_t state = states[symbol]++;
+        size_t bitsCount = tableLog_ - floorLog2(state);
+        table_.push_back({
+            static_cast<uint16_t>((state << bitsCount) - tableSize),
+            symbol,
+            static_cast<uint8_t>(bitsCount)});
+    }
+}
+
+AnsDecoder AnsDecoder::load(const wire::AnsDecoder* serialized)
+{
+    return AnsDecoder(
+        std::vector<uint16_t>(serialized->frequencies()->begin(), serialized->frequencies()->end()),
+        serialized->table_log());
+}
+
+}
@@ -0,0 +1,91 @@
+#pragma once
+
+#include "ans_decoder_generated.h"
+#include "bit_stream_reader.h"
+
+#include <array>
+#include <vector>
+
+namespace memb {
+
+// Table-based asymmetric numeral systems (tANS) coder of bytes. Symbol
+// probabilities are quantized to 2^tableLog slots, so codes take fractional
+// numbers of bits. Consecutive symbols alternate between STATES_COUNT coder
+// states sharing one bit stream, which lets the decoder overlap their lookups.
+class AnsEncoder {
+public:
+    static const size_t STATES_COUNT = 2;
+    static const size_t MIN_TABLE_LOG = 5;
+    static const size_t MAX_TABLE_LOG = 14;
+
+    // Counts are indexed by symbol, at least one of them must be positive
+    AnsEncoder(const std::vector<size_t>& counts, size_t tableLog);
+
+    std::vector<uint8_t> encode(const std::vector<uint8_t>& data) const;
+
+    flatbuffers::Offset<wire::AnsDecoder> saveDecoder(flatbuffers::FlatBufferBuilder& builder) const;
+
+private:
+    size_t tableLog_;
+    std::vector<uint16_t> frequencies_;
+    std::vector<uint32_t> cumulativeFrequencies_;
+    // Encoder states reached from the subranges of every symbol
+    std::vector<uint32_t> nextStates_;
+};
+
+class AnsDecoder {
+public:
+    AnsDecoder(const std::vector<uint16_t>& frequencies, size_t tableLog);
+
+    static AnsDecoder load(const wire::AnsDecoder* serialized);
+
+    // Calls consume(index, symbol) for count symbols. Data must be followed
+    // by BitStreamReader::PADDING_BYTES readable bytes.
+    template <typename Consumer>
+    void decode(const uint8_t* data, size_t count, Consumer&& consume) const
+    {
+        BitStreamReader reader(data);
+        reader.refill();
+
+        std::array<size_t, AnsEncoder::STATES_COUNT> states;
+        for (auto& state : states) {
+            state = reader.peek(tableLog_);
+            reader.consume(tableLog_);
+        }
+
+        size_t index = 0;
+        for (; index + SYMBOLS_PER_REFILL <= count; index += SYMBOLS_PER_REFILL) {
+            reader.refill();
+            for (size_t i = 0; i < SYMBOLS_PER_REFILL; ++i) {
+                consume(index + i, decodeSymbol(reader, states[i % AnsEncoder::STATES_COUNT]));
+            }
+        }
+        for (; index < count; ++index) {
+            reader.refill();
+            consume(index, decodeSymbol(reader, states[index % AnsEncoder::STATES_COUNT]));
+        }
+    }
+
+private:
+    // Symbols of at most MAX_TABLE_LOG bits that fit into one refill
+    static const size_t SYMBOLS_PER_REFILL = 4;
+
+    struct DecodeData {
+        uint16_t baseState;
+        uint8_t symbol;
+        uint8_t bitsCount;
+    };
+
+    uint8_t decodeSymbol(BitStreamReader& reader, size_t& state) const
+    {
+        auto entry = table_[state];
+        state = entry.baseState + (reader.peek(tableLog_) >> (tableLog_ - entry.bitsCount));
+        reader.consume(entry.bitsCount);
+        return entry.symbol;
+    }
+
+    size_t tableLog_;
+    std::vector<DecodeData> table_;
+};
+
+}
@@ -0,0 +1,112 @@
+#include "ans_coder.h"
+
+#include <boost/test/unit_test.hpp>
+
+#include <cmath>
+#include <random>
+
+using namespace memb;
+
+namespace {
+
+std::vector<uint8_t> decodeAll(const AnsDecoder& decoder, std::vector<uint8_t> encoded, size_t count)
+{
+    encoded.resize(encoded.size() + BitStreamReader::PADDING_BYTES, 0);
+
+    std::vector<uint8_t> result(count);
+    decoder.decode(
+        encoded.data(),
+        count,
+        [&result](size_t index, uint8_t symbol)
+        {
+            result[index] = symbol;
+        });
+
+    return result;
+}
+
+std::vector<size_t> symbolCounts(const std::vector<uint8_t>& data)
+{
+    std::vector<size_t> result(256, 0);
+    for (auto symbol : data) {
+        ++result[symbol];
+    }
+
+    return result;
+}
+
+AnsDecoder loadDecoder(const AnsEncoder& encoder)
+{
+    flatbuffers::FlatBufferBuilder builder;
+    builder.Finish(encoder.saveDecoder(builder));
+
+    return AnsDecoder::load(flatbuffers::GetRoot<wire::AnsDecoder>(builder.GetBufferPointer()));
+}
+
+} // namespace
+
+BOOST_AUTO_TEST_SUITE(ansCoder)
+
+BOOST_AUTO_TEST_CASE(ansCoderRoundTrips)
+{
+    std::mt19937 generator(42);
+    std::geometric_distribution<int> distribution(0.3);
+
+    std::vector<uint8_t> data;
+    for (size_t i = 0; i < 10001; ++i) {
+        data.push_back(std::min(distribution(generator), 15));
+    }
+
+    for (size_t tableLog : {AnsEncoder::MIN_TABLE_LOG, size_t(9), AnsEncoder::MAX_TABLE_LOG}) {
+        AnsEncoder encoder(symbolCounts(data), tableLog);
+        auto decoder = loadDecoder(encoder);
+
+        for (size_t count : {size_t(0), size_t(1), size_t(3), size_t(300), data.size()}) {
+            std::vector<uint8_t> prefix(data.begin(), data.begin() + count);
+            BOOST_CHECK(decodeAll(decoder, encoder.encode(prefix), count) == prefix);
+        }
+    }
+}
+
+BOOST_AUTO_TEST_CASE(ansCoderApproachesEntropy)
+{
+    std::mt19937 generator(42);
+    std::discrete_distribution<int> distribution({60, 20, 10, 5, 3, 2});
+
+    std::vector<uint8_t> data;
+    for (size_t i = 0; i < 100000; ++i) {
+        data.push_back(distribution(generator));
+    }
+
+    double entropyBits = 0;
+    for (auto count : symbolCounts(data)) {
+        if (count > 0) {
+            entropyBits -= count * std::log2(static_cast<double>(count) / data.size());
+        }
+    }
+
+    AnsEncoder encoder(symbolCounts(data), 11);
+    auto encoded = encoder.encode(data);
+    BOOST_CHECK_LT(encoded.size() * 8, entropyBits * 1.01);
+    BOOST_CHECK(decodeAll(loadDecoder(encoder), encoded, data.size()) == data);
+}
+
+BOOST_AUTO_TEST_CASE(ansCoderHandlesSingleSymbol)
+{
+    std::vector<uint8_t> data(100, 7);
+    AnsEncoder encoder(symbolCounts(data), AnsEncoder::MIN_TABLE_LOG);
+
+    auto encoded = encoder.encode(data);
+    BOOST_CHECK_EQUAL(encoded.size(), size_t(2));
+    BOOST_CHECK(decodeAll(loadDecoder(encoder), encoded, data.size()) == data);
+}
+
+BOOST_AUTO_TEST_CASE(ansCoderRejectsInvalidTables)
+{
+    BOOST_CHECK_THROW(AnsEncoder(std::vector<size_t>(256, 1), AnsEncoder::MAX_TABLE_LOG + 1), std::runtime_error);
+    BOOST_CHECK_THROW(AnsEncoder(std::vector<size_t>(256, 1), AnsEncoder::MIN_TABLE_LOG), std::runtime_error);
+    BOOST_CHECK_THROW(AnsEncoder(std::vector<size_t>(256, 0), 10), std::runtime_error);
+    BOOST_CHECK_THROW(AnsDecoder({1, 2, 3}, 5), std::runtime_error);
+}
+
+BOOST_AUTO_TEST_SUITE_END()
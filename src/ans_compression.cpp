@@ -0,0 +1,126 @@
+#include "ans_compression.h"
+
+#include <algorithm>
+
+namespace memb {
+
+namespace {
+
+// Table has 2^TABLE_LOG_EXTRA_BITS slots per quantization level. Larger tables
+// approach the entropy closer, but every vector stores its states in tableLog bits.
+const size_t TABLE_LOG_EXTRA_BITS = 3;
+
+} // namespace
+
+AnsCompressor::AnsCompressor(
+        flatbuffers::FlatBufferBuilder& builder,
+        size_t bitsPerWeight,
+        const CompressionOptions& options):
+    CentroidCompressor(builder, bitsPerWeight, options),
+    tableLog_(std::min<size_t>(
+        AnsEncoder::MAX_TABLE_LOG,
+        std::max<size_t>(AnsEncoder::MIN_TABLE_LOG, bitsPerWeight + TABLE_LOG_EXTRA_BITS)))
+{}
+
+void AnsCompressor::fitCoder(const std::vector<std::vector<uint8_t>>& codes)
+{
+    std::vector<size_t> counts(quantizationLevels_, 0);
+    for (const auto& vectorCodes : codes) {
+        for (auto code : vectorCodes) {
+            ++counts[code];
+        }
+    }
+
+    // Empty vocabularies still get a valid decoder
+    if (std::all_of(counts.begin(), counts.end(), [](size_t count) { return count == 0; })) {
+        counts[0] = 1;
+    }
+
+    encoder_ = std::make_shared<AnsEncoder>(counts, tableLog_);
+}
+
+std::vector<uint8_t> AnsCompressor::encodeCodes(const std::vector<uint8_t>& codes) const
+{
+    return encoder_->encode(codes);
+}
+
+flatbuffers::Offset<void> AnsCompressor::createStorage(const StorageParts& parts)
+{
+    auto decoder = encoder_->saveDecoder(builder_);
+
+    return wire::CreateAns(
+        builder_,
+        parts.wordOffsets,
+        parts.valueOffsets,
+        parts.packedWords,
+        parts.packedValues,
+        decoder,
+        parts.clusterizer,
+        parts.perfectHash,
+        parts.searchTree,
+        parts.squaredNorms
+    ).Union();
+}
+
+AnsCompressedStorage::AnsCompressedStorage(const void* flatStorage, size_t dim):
+    CentroidCompressedStorage(static_cast<const wire::Ans*>(flatStorage), dim, true),
+    flatStorage_(static_cast<const wire::Ans*>(flatStorage)),
+    decoder_(AnsDecoder::load(flatStorage_->decoder()))
+{}
+
+void AnsCompressedStorage::extractById(size_t wordId, float* destination) const
+{
+    decoder_.decode(
+        packedValues(wordId),
+        dim_,
+        [this, destination](size_t index, uint8_t code)
+        {
+            destination[index] = centroids_[code];
+        });
+}
+
+void AnsCompressedStorage::decodeCodes(size_t wordId, uint8_t* codes) const
+{
+    decoder_.decode(
+        packedValues(wordId),
+        dim_,
+        [codes](size_t index, uint8_t code)
+        {
+            codes[index] = code;
+        });
+}
+
+std::vector<MemoryRange> AnsCompressedStorage::memoryRanges() const
+{
+    auto result = commonMemoryRanges(flatStorage_);
+    result.push_back(vectorRange(
+        StorageSection::Decoder, flatStorage_->decoder()->frequencies(), sizeof(uint16_t)));
+
+    return result;
+}
+
+std::shared_ptr<Compressor> AnsCompressionStrategy::createCompressor(
+    flatbuffers::FlatBufferBuilder& builder,
+    size_t bitsPerWeight,
+    const CompressionOptions& options) const
+{
+    return std::make_shared<AnsCompressor>(builder, bitsPerWeight, options);
+}
+
+std::shared_ptr<CompressedStorage> AnsCompressionStrategy::createCompressedStorage(
+    const void* flatStorage, size_t dim, const DecodingOptions& /*options*/) const
+{
+    return std::make_shared<AnsCompressedStorage>(flatStorage, dim);
+}
+
+std::string AnsCompressionStrategy::storageName() const
+{
+    return "ans";
+}
+
+wire::Storage AnsCompressionStrategy::storageType() const
+{
+    return wire::Storage_Ans;
+}
+
+}
@@ -0,0 +1,56 @@
+#pragma once
+
+#include "ans_coder.h"
+#include "centroid_compression.h"
+
+namespace memb {
+
+// Same quantization as trained storage, with the codes
+// entropy-coded by tANS instead of Huffman codes
+class AnsCompressedStorage : public CentroidCompressedStorage {
+public:
+    AnsCompressedStorage(const void* flatStorage, size_t dim);
+    virtual void extractById(size_t wordId, float* destination) const override;
+    virtual std::vector<MemoryRange> memoryRanges() const override;
+
+protected:
+    virtual void decodeCodes(size_t wordId, uint8_t* codes) const override;
+
+private:
+    const wire::Ans* flatStorage_;
+    AnsDecoder decoder_;
+};
+
+class AnsCompressor : public CentroidCompressor {
+public:
+    AnsCompressor(
+        flatbuffers::FlatBufferBuilder& builder,
+        size_t bitsPerWeight,
+        const CompressionOptions& options);
+
+protected:
+    virtual void fitCoder(const std::vector<std::vector<uint8_t>>& codes) override;
+    virtual std::vector<uint8_t> encodeCodes(const std::vector<uint8_t>& codes) const override;
+    virtual flatbuffers::Offset<void> createStorage(const StorageParts& parts) override;
+
+private:
+    size_t tableLog_;
+    std::shared_ptr<AnsEncoder> encoder_;
+};
+
+class AnsCompressionStrategy : public CompressionStrategy {
+public:
+    virtual std::shared_ptr<Compressor> createCompressor(
+        flatbuffers::FlatBufferBuilder& builder,
+        size_t bitsPerWeight,
+        const CompressionOptions& options) const override;
+
+    virtual std::shared_ptr<CompressedStorage> createCompressedStorage(
+        const void* flatStorage, size_t dim, const DecodingOptions& options) const override;
+
+    virtual std::string storageName() const override;
+
+    virtual wire::Storage storageType() const override;
+};
+
+}
@@ -0,0 +1,85 @@
+#pragma once
+
+#include "builder.h"
+
+#include <chrono>
+#include <iomanip>
+#include <iostream>
+#include <random>
+#include <string>
+
+namespace memb {
+
+template <typename Function>
+double measureSeconds(Function&& function)
+{
+    auto start = std::chrono::steady_clock::now();
+    function();
+    std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+
+    return elapsed.count();
+}
+
+inline void reportThroughput(
+    const std::string& name,
+    size_t operationsCount,
+    double seconds,
+    const std::string& unit = "lookups")
+{
+    std::cout << std::left << std::setw(48) << name << " "
+        << std::fixed << std::setprecision(2) << operationsCount / seconds / 1e6
+        << " M" << unit << "/s" << std::endl;
+}
+
+inline std::vector<std::string> benchmarkWords(size_t count)
+{
+    std::vector<std::string> result;
+    for (size_t i = 0; i < count; ++i) {
+        result.push_back("word" + std::to_string(i));
+    }
+
+    return result;
+}
+
+// Random gaussian vectors for benchmarkWords(wordsCount) saved to filename
+inline void createBenchmarkModel(
+    const std::string& filename,
+    size_t wordsCount,
+    size_t dim,
+    const std::string& storageName = "trained",
+    size_t bitsPerWeight = 4,
+    const CompressionOptions& options = CompressionOptions())
+{
+    std::mt19937 generator(42);
+    std::normal_distribution<float> distribution;
+
+    Builder builder(dim, storageName, bitsPerWeight, options);
+    std::vector<float> embedding(dim);
+    for (const auto& word : benchmarkWords(wordsCount)) {
+        for (auto& value : embedding) {
+            value = distribution(generator);
+        }
+        builder.addWord(word, embedding);
+    }
+    builder.save(filename);
+}
+
+// Token stream with Zipf-distributed word frequencies, as in natural texts
+inline std::vector<std::string> zipfTokens(const std::vector<std::string>& words, size_t count)
+{
+    std::mt19937 generator(42);
+    std::vector<double> weights;
+    for (size_t rank = 1; rank <= words.size(); ++rank) {
+        weights.push_back(1.0 / rank);
+    }
+    std::discrete_distribution<size_t> distribution(weights.begin(), weights.end());
+
+    std::vector<std::string> result;
+    for (size_t i = 0; i < count; ++i) {
+        result.push_back(words[distribution(generator)]);
+    }
+
+    return result;
+}
+
+} // namespace memb
@@ -33,6 +33,11 @@ public:
         }
     }
 
+    size_t bitsCount() const
+    {
+        return data_.size() * 8 - freeBits_;
+    }
+
     std::vector<uint8_t> data()
     {
         return data_;
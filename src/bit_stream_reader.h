@@ -1,41 +1,72 @@
 #pragma once
 
+#include <cstddef>
 #include <cstdint>
+#include <cstring>
+
+#ifdef _MSC_VER
+#include <stdlib.h>
+#endif
 
 namespace memb {
 
+inline uint64_t loadBigEndian64(const uint8_t* data)
+{
+    uint64_t value;
+    std::memcpy(&value, data, sizeof(value));
+#if defined(_MSC_VER)
+    return _byteswap_uint64(value);
+#elif defined(__BYTE_ORDER__) && __BYTE_ORDER__ == __ORDER_BIG_ENDIAN__
+    return value;
+#else
+    return __builtin_bswap64(value);
+#endif
+}
+
+// Reads a big-endian bit stream with one unaligned 64-bit load per refill.
+// Loads run up to PADDING_BYTES past the last consumed byte, so the stream
+// has to be followed by at least that many readable bytes.
 class BitStreamReader {
 public:
-    BitStreamReader(const uint8_t* data, const uint8_t* dataEnd):
+    static const size_t PADDING_BYTES = sizeof(uint64_t);
+    // Bits that may be peeked after a refill
+    static const size_t REFILL_BITS = 57;
+
+    BitStreamReader():
+        data_(nullptr),
         accumulator_(0),
+        consumedBits_(0)
+    {}
+
+    explicit BitStreamReader(const uint8_t* data):
         data_(data),
-        dataEnd_(dataEnd),
-        extraBits_(0)
+        accumulator_(0),
+        consumedBits_(0)
     {}
 
-    uint64_t pull(size_t bitsCount)
+    void refill()
     {
-        extraBits_ -= bitsCount;
-        while (extraBits_ < 0) {
-            for (size_t i = 0; i < 4; ++i) {
-                accumulator_ <<= 8;
-                if (data_ < dataEnd_) {
-                    accumulator_ += *data_;
-                    ++data_;
-                }
-            }
-            extraBits_ += 32;
-        }
-
-        return accumulator_ >> extraBits_;
+        data_ += consumedBits_ >> 3;
+        consumedBits_ &= 7;
+        accumulator_ = loadBigEndian64(data_) << consumedBits_;
+    }
+
+    // Next bitsCount bits without consuming them, bitsCount must be positive
+    uint64_t peek(size_t bitsCount) const
+    {
+        return accumulator_ >> (64 - bitsCount);
+    }
+
+    void consume(size_t bitsCount)
+    {
+        accumulator_ <<= bitsCount;
+        consumedBits_ += bitsCount;
     }
 
 private:
-    uint64_t accumulator_;
     const uint8_t* data_;
-    const uint8_t* dataEnd_;
-    int extraBits_;
+    uint64_t accumulator_;
+    size_t consumedBits_;
 };
 
-
 } // namespace memb
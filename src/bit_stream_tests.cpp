@@ -1,6 +1,9 @@
 #include <boost/test/unit_test.hpp>
 
 #include "bit_stream.h"
+#include "bit_stream_reader.h"
+
+#include <random>
 
 using namespace memb;
 
@@ -58,4 +61,32 @@ BOOST_AUTO_TEST_CASE(bitStreamWorks)
     BOOST_CHECK_EQUAL(bitStreamRepr, simpleRepr);
 }
 
+BOOST_AUTO_TEST_CASE(bitStreamReaderReadsPushedCodes)
+{
+    std::mt19937 generator(42);
+    std::uniform_int_distribution<size_t> lengthDistribution(1, 16);
+
+    BitStream bitStream;
+    std::vector<PrefixCode> prefixCodes;
+    for (size_t i = 0; i < 1000; ++i) {
+        size_t bitsCount = lengthDistribution(generator);
+        uint16_t code = generator() & ((1U << bitsCount) - 1);
+        prefixCodes.push_back({code, bitsCount});
+        bitStream.push(prefixCodes.back());
+    }
+
+    auto data = bitStream.data();
+    data.resize(data.size() + BitStreamReader::PADDING_BYTES, 0);
+
+    BitStreamReader reader(data.data());
+    for (const auto& code : prefixCodes) {
+        reader.refill();
+        BOOST_CHECK_EQUAL(reader.peek(code.bitsCount), code.code);
+        reader.consume(code.bitsCount);
+    }
+
+    reader.refill();
+    BOOST_CHECK_EQUAL(reader.peek(BitStreamReader::REFILL_BITS), 0);
+}
+
 BOOST_AUTO_TEST_SUITE_END()
@@ -1,8 +1,11 @@
 #include "builder.h"
 #include "compression_strategy.h"
+#include "ivf_index.h"
+#include "thread_pool.h"
 
 #include <boost/format.hpp>
 
+#include <algorithm>
 #include <fstream>
 
 namespace memb {
@@ -17,21 +20,31 @@ const std::string DUPLICATE_MESSAGE_TEMPLATE =
 
 } // namespace
 
-Builder::Builder(size_t dim, wire::Storage storageType, size_t bitsPerWeight):
+Builder::Builder(
+        size_t dim,
+        wire::Storage storageType,
+        size_t bitsPerWeight,
+        const CompressionOptions& options):
     dim_(dim),
     storageType_(storageType),
-    compressor_(createCompressionStrategy(storageType)->createCompressor(builder_, bitsPerWeight))
+    compressor_(createCompressionStrategy(storageType)->createCompressor(builder_, bitsPerWeight, options)),
+    ivfListsCount_(options.ivfListsCount)
 {}
 
-Builder::Builder(size_t dim, const std::string& storageName, size_t bitsPerWeight):
-    dim_(dim)
+Builder::Builder(
+        size_t dim,
+        const std::string& storageName,
+        size_t bitsPerWeight,
+        const CompressionOptions& options):
+    dim_(dim),
+    ivfListsCount_(options.ivfListsCount)
 {
     auto compressionStrategy = createCompressionStrategy(storageName);
     storageType_ = compressionStrategy->storageType();
-    compressor_ = compressionStrategy->createCompressor(builder_, bitsPerWeight);
+    compressor_ = compressionStrategy->createCompressor(builder_, bitsPerWeight, options);
 }
 
-void Builder::addWord(const std::string& word, const std::vector<float>& embedding)
+void Builder::addWord(const std::string& word, const std::vector<float>& embedding, double frequency)
 {
     if (embedding.size() != dim_) {
         throw std::runtime_error(boost::str(
@@ -44,16 +57,39 @@ void Builder::addWord(const std::string& word, const std::vector<float>& embeddi
             boost::format(DUPLICATE_MESSAGE_TEMPLATE) % word));
     }
 
-    compressor_->add(word, embedding.data(), dim_);
+    compressor_->add(word, embedding.data(), dim_, frequency);
+    if (ivfListsCount_ > 0) {
+        indexedVectors_.emplace_back(word, embedding);
+    }
 }
 
 void Builder::dump(std::ostream& sink)
 {
     auto storage = compressor_->finalize();
+
+    flatbuffers::Offset<wire::IvfIndex> annIndex;
+    if (ivfListsCount_ > 0) {
+        // Word ids of every storage are positions in the sorted vocabulary
+        std::sort(indexedVectors_.begin(), indexedVectors_.end());
+
+        std::vector<float> vectors;
+        vectors.reserve(indexedVectors_.size() * dim_);
+        for (const auto& wordVector : indexedVectors_) {
+            vectors.insert(vectors.end(), wordVector.second.begin(), wordVector.second.end());
+        }
+
+        IvfIndexBuilder ivfBuilder(dim_, ivfListsCount_);
+        ivfBuilder.fit(vectors, ThreadPool::shared().get());
+        annIndex = ivfBuilder.save(builder_);
+    }
+
     wire::IndexBuilder indexBuilder(builder_);
     indexBuilder.add_dim(dim_);
     indexBuilder.add_storage_type(storageType_);
     indexBuilder.add_storage(storage);
+    if (ivfListsCount_ > 0) {
+        indexBuilder.add_ann_index(annIndex);
+    }
     wire::FinishIndexBuffer(builder_, indexBuilder.Finish());
 
     sink << std::string(
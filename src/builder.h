@@ -4,16 +4,28 @@
 #include "compression_strategy.h"
 
 #include <unordered_set>
+#include <utility>
 #include <iostream>
 
 namespace memb {
 
 class Builder {
 public:
-    Builder(size_t dim, wire::Storage storageType, size_t bitsPerWeight);
-    Builder(size_t dim, const std::string& storageType, size_t bitsPerWeight);
+    Builder(
+        size_t dim,
+        wire::Storage storageType,
+        size_t bitsPerWeight,
+        const CompressionOptions& options = CompressionOptions());
+    Builder(
+        size_t dim,
+        const std::string& storageType,
+        size_t bitsPerWeight,
+        const CompressionOptions& options = CompressionOptions());
 
-    void addWord(const std::string& word, const std::vector<float>& embedding);
+    // Vectors of words with higher frequency are placed closer to the beginning
+    // of the values section, equally frequent words keep the insertion order.
+    // Any monotonic score works, e.g. counts or negated ranks
+    void addWord(const std::string& word, const std::vector<float>& embedding, double frequency = 0.0);
     void dump(std::ostream& sink);
     void save(const std::string& filename);
 
@@ -23,6 +35,9 @@ private:
     wire::Storage storageType_;
     std::shared_ptr<Compressor> compressor_;
     std::unordered_set<std::string> addedWords_;
+    size_t ivfListsCount_;
+    // Source vectors kept for clustering when the index is requested
+    std::vector<std::pair<std::string, std::vector<float>>> indexedVectors_;
 };
 
 }
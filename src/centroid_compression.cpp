@@ -0,0 +1,318 @@
+#include "centroid_compression.h"
+#include "bit_stream_reader.h"
+#include "perfect_hash.h"
+#include "search_tree.h"
+#include "residency.h"
+
+#include <boost/format.hpp>
+
+#include <algorithm>
+#include <limits>
+#include <numeric>
+
+namespace memb {
+
+namespace {
+
+struct StorageNode {
+    std::string word;
+    uint32_t offset;
+    float squaredNorm;
+};
+
+const size_t CLUSTER_SAMPLE_SIZE = 10000;
+
+} // namespace
+
+void CentroidCompressedStorage::initialize(
+    const flatbuffers::Vector<uint8_t>* packedValues, bool paddedValues)
+{
+    if (squaredNorms_ && squaredNorms_->size() != size()) {
+        throw std::runtime_error(boost::str(boost::format(
+            "%1% squared norms do not match the vocabulary of %2% words") % squaredNorms_->size() % size()));
+    }
+
+    packedValues_ = packedValues->data();
+    packedValuesSize_ = packedValues->size();
+    tailOffset_ = std::numeric_limits<size_t>::max();
+    if (!paddedValues) {
+        // Vectors before the last one starting at least PADDING_BYTES
+        // before the end are followed by enough bytes of the next ones
+        size_t size = packedValues->size();
+        size_t safeEnd = size > BitStreamReader::PADDING_BYTES ? size - BitStreamReader::PADDING_BYTES : 0;
+        tailOffset_ = 0;
+        for (auto offset : *valueOffsets_) {
+            if (offset <= safeEnd) {
+                tailOffset_ = std::max<size_t>(tailOffset_, offset);
+            }
+        }
+
+        paddedTail_.assign(packedValues_ + tailOffset_, packedValues_ + size);
+        paddedTail_.resize(paddedTail_.size() + BitStreamReader::PADDING_BYTES, 0);
+    }
+}
+
+const std::vector<float>& CentroidCompressedStorage::centroidProducts() const
+{
+    std::call_once(
+        centroidProductsBuilt_,
+        [this]
+        {
+            for (size_t first = 0; first < levelsCount_; ++first) {
+                for (size_t second = 0; second < levelsCount_; ++second) {
+                    centroidProducts_.push_back(centroids_[first] * centroids_[second]);
+                }
+            }
+        });
+
+    return centroidProducts_;
+}
+
+int64_t CentroidCompressedStorage::wordId(const std::string& word) const
+{
+    return vocabulary_.find(word);
+}
+
+std::vector<int64_t> CentroidCompressedStorage::sortedWordIds(
+    const std::vector<const std::string*>& words) const
+{
+    return vocabulary_.findSorted(words);
+}
+
+size_t CentroidCompressedStorage::size() const
+{
+    return vocabulary_.size();
+}
+
+boost::string_view CentroidCompressedStorage::word(size_t wordId) const
+{
+    return vocabulary_.word(wordId);
+}
+
+ScoringQueries CentroidCompressedStorage::prepareScoring(
+    const float* queries, size_t queriesCount, size_t dim) const
+{
+    size_t levels = levelsCount_;
+
+    ScoringQueries result{queries, queriesCount, dim, std::vector<float>(queriesCount, 0.0f), {}};
+    result.tables.resize(queriesCount * dim * levels);
+    for (size_t query = 0; query < queriesCount; ++query) {
+        float* table = result.tables.data() + query * dim * levels;
+        for (size_t i = 0; i < dim; ++i) {
+            float value = queries[query * dim + i];
+            result.squaredNorms[query] += value * value;
+            for (size_t level = 0; level < levels; ++level) {
+                table[i * levels + level] = value * centroids_[level];
+            }
+        }
+    }
+
+    return result;
+}
+
+void CentroidCompressedStorage::scoreBatch(
+    const ScoringQueries& queries,
+    SimilarityMetric metric,
+    const uint32_t* wordIds,
+    size_t wordsCount,
+    float* scores) const
+{
+    size_t levels = levelsCount_;
+    size_t dim = queries.dim;
+
+    std::vector<uint8_t> codes(dim);
+    for (size_t word = 0; word < wordsCount; ++word) {
+        decodeCodes(wordIds[word], codes.data());
+        float vectorSquaredNorm = squaredNorm(wordIds[word], codes.data());
+
+        for (size_t query = 0; query < queries.count; ++query) {
+            const float* table = queries.tables.data() + query * dim * levels;
+            float dot = 0;
+            for (size_t i = 0; i < dim; ++i) {
+                dot += table[i * levels + codes[i]];
+            }
+
+            scores[query * wordsCount + word] = similarityScore(
+                metric, dot, queries.squaredNorms[query], vectorSquaredNorm);
+        }
+    }
+}
+
+float CentroidCompressedStorage::squaredNorm(size_t wordId, const uint8_t* codes) const
+{
+    if (squaredNorms_) {
+        return squaredNorms_->Get(wordId);
+    }
+
+    size_t levels = levelsCount_;
+    const auto& products = centroidProducts();
+    float result = 0;
+    for (size_t i = 0; i < dim_; ++i) {
+        result += products[codes[i] * (levels + 1)];
+    }
+
+    return result;
+}
+
+void CentroidCompressedStorage::scorePairs(
+    size_t,
+    SimilarityMetric metric,
+    const int64_t* firstIds,
+    const int64_t* secondIds,
+    size_t pairsCount,
+    float* scores) const
+{
+    size_t levels = levelsCount_;
+    const auto& products = centroidProducts();
+    std::vector<uint8_t> firstCodes(dim_);
+    std::vector<uint8_t> secondCodes(dim_);
+
+    for (size_t pair = 0; pair < pairsCount; ++pair) {
+        float dot = 0;
+        float firstSquaredNorm = 0;
+        float secondSquaredNorm = 0;
+
+        if (firstIds[pair] >= 0 && secondIds[pair] >= 0) {
+            decodeCodes(firstIds[pair], firstCodes.data());
+            decodeCodes(secondIds[pair], secondCodes.data());
+            for (size_t i = 0; i < dim_; ++i) {
+                dot += products[firstCodes[i] * levels + secondCodes[i]];
+            }
+            firstSquaredNorm = squaredNorm(firstIds[pair], firstCodes.data());
+            secondSquaredNorm = squaredNorm(secondIds[pair], secondCodes.data());
+        } else if (metric == SimilarityMetric::L2) {
+            // Distance to a zero vector is the norm of the other one
+            for (auto wordId : {firstIds[pair], secondIds[pair]}) {
+                if (wordId >= 0) {
+                    decodeCodes(wordId, firstCodes.data());
+                    firstSquaredNorm = squaredNorm(wordId, firstCodes.data());
+                }
+            }
+        }
+
+        scores[pair] = pairSimilarity(metric, dot, firstSquaredNorm, secondSquaredNorm);
+    }
+}
+
+void CentroidCompressedStorage::prefetch(const std::vector<int64_t>& wordIds) const
+{
+    std::vector<size_t> offsets;
+    offsets.reserve(wordIds.size());
+    for (auto wordId : wordIds) {
+        if (wordId != MISSING_WORD) {
+            offsets.push_back(valueOffsets_->Get(wordId));
+        }
+    }
+
+    prefetchPages(packedValues_, packedValuesSize_, std::move(offsets));
+}
+
+CentroidCompressor::CentroidCompressor(
+        flatbuffers::FlatBufferBuilder& builder,
+        size_t bitsPerWeight,
+        const CompressionOptions& options):
+    builder_(builder),
+    quantizationLevels_(std::min(1 << bitsPerWeight, 255)),
+    options_(options)
+{}
+
+void CentroidCompressor::add(
+    const std::string& word,
+    const float* source,
+    size_t dim,
+    double frequency)
+{
+    embeddings_.push_back({word, std::vector<float>(source, source + dim), frequency});
+}
+
+flatbuffers::Offset<void> CentroidCompressor::finalize()
+{
+    std::vector<float> valuesSample;
+
+    for (size_t i = 0; i < std::min(CLUSTER_SAMPLE_SIZE, embeddings_.size()); ++i) {
+        valuesSample.insert(
+            valuesSample.end(), embeddings_[i].values.begin(), embeddings_[i].values.end());
+    }
+
+    KMeansClusterizer clusterizer(quantizationLevels_);
+    clusterizer.fit(valuesSample);
+
+    std::vector<std::vector<uint8_t>> codes;
+    codes.reserve(embeddings_.size());
+    for (const auto& wordVector : embeddings_) {
+        codes.push_back(clusterizer.predict(wordVector.values));
+    }
+    fitCoder(codes);
+
+    // Hot vectors are packed together at the start of packed_values,
+    // word ids are defined by the sorted words and do not depend on this order
+    std::vector<size_t> packingOrder(embeddings_.size());
+    std::iota(packingOrder.begin(), packingOrder.end(), 0);
+    std::stable_sort(
+        packingOrder.begin(),
+        packingOrder.end(),
+        [this](size_t lhs, size_t rhs)
+        {
+            return embeddings_[lhs].frequency > embeddings_[rhs].frequency;
+        });
+
+    std::vector<StorageNode> nodes;
+    std::vector<uint8_t> packedValues;
+
+    const auto& centroids = clusterizer.centroids();
+    for (auto index : packingOrder) {
+        auto offset = packedValues.size();
+        auto encodedValues = encodeCodes(codes[index]);
+        packedValues.insert(
+            packedValues.end(), encodedValues.begin(), encodedValues.end());
+
+        float squaredNorm = 0;
+        for (auto code : codes[index]) {
+            squaredNorm += centroids[code] * centroids[code];
+        }
+        nodes.push_back(StorageNode{embeddings_[index].word, static_cast<uint32_t>(offset), squaredNorm});
+    }
+    packedValues.resize(packedValues.size() + BitStreamReader::PADDING_BYTES, 0);
+
+    std::sort(
+        nodes.begin(),
+        nodes.end(),
+        [](const StorageNode& lhs, const StorageNode& rhs)
+        {
+            return lhs.word < rhs.word;
+        });
+
+    std::string packedWords;
+    std::vector<uint32_t> wordOffsets;
+    std::vector<uint32_t> valueOffsets;
+    std::vector<float> squaredNorms;
+    std::vector<std::string> sortedWords;
+
+    for (const auto& node : nodes) {
+        wordOffsets.push_back(packedWords.size());
+        valueOffsets.push_back(node.offset);
+        squaredNorms.push_back(node.squaredNorm);
+        sortedWords.push_back(node.word);
+
+        packedWords.insert(packedWords.size(), node.word.c_str(), node.word.size() + 1);
+    }
+
+    StorageParts parts;
+    if (options_.perfectHashIndex) {
+        parts.perfectHash = PerfectHashIndexBuilder(sortedWords).save(builder_);
+    }
+    if (options_.searchTree) {
+        parts.searchTree = SearchTreeBuilder(sortedWords).save(builder_);
+    }
+
+    parts.wordOffsets = builder_.CreateVector(wordOffsets);
+    parts.valueOffsets = builder_.CreateVector(valueOffsets);
+    parts.packedWords = builder_.CreateString(packedWords);
+    parts.packedValues = builder_.CreateVector(packedValues);
+    parts.clusterizer = clusterizer.save(builder_);
+    parts.squaredNorms = builder_.CreateVector(squaredNorms);
+
+    return createStorage(parts);
+}
+
+}
@@ -0,0 +1,178 @@
+#pragma once
+
+#include "compression_strategy.h"
+#include "kmeans.h"
+#include "packed_vocabulary.h"
+
+#include <mutex>
+
+namespace memb {
+
+template <typename T>
+MemoryRange vectorRange(StorageSection section, const flatbuffers::Vector<T>* vector, size_t itemSize)
+{
+    if (!vector) {
+        return {section, nullptr, 0};
+    }
+
+    return {section, vector->Data(), vector->size() * itemSize};
+}
+
+// Vectors quantized to shared k-means centroids with entropy-coded codes.
+// Flat storages keep the same fields and differ in the coder of packed_values.
+class CentroidCompressedStorage : public CompressedStorage {
+public:
+    virtual int64_t wordId(const std::string& word) const override;
+    virtual std::vector<int64_t> sortedWordIds(
+        const std::vector<const std::string*>& words) const override;
+    virtual size_t size() const override;
+    virtual boost::string_view word(size_t wordId) const override;
+    // Tables hold products of every query value with every centroid
+    virtual ScoringQueries prepareScoring(
+        const float* queries, size_t queriesCount, size_t dim) const override;
+    // Scores are accumulated from the tables of products with
+    // centroids, so the vectors are never decoded to floats
+    virtual void scoreBatch(
+        const ScoringQueries& queries,
+        SimilarityMetric metric,
+        const uint32_t* wordIds,
+        size_t wordsCount,
+        float* scores) const override;
+    // Dot products are summed from a table of centroid products,
+    // norms are read from the file when the builder stored them
+    virtual void scorePairs(
+        size_t dim,
+        SimilarityMetric metric,
+        const int64_t* firstIds,
+        const int64_t* secondIds,
+        size_t pairsCount,
+        float* scores) const override;
+    virtual void prefetch(const std::vector<int64_t>& wordIds) const override;
+
+protected:
+    // Only the last vectors of packed values without padding are copied,
+    // so that decoders may read BitStreamReader::PADDING_BYTES past every vector
+    template <typename FlatStorage>
+    CentroidCompressedStorage(const FlatStorage* flatStorage, size_t dim, bool paddedValues):
+        dim_(dim),
+        centroids_(flatStorage->clusterizer()->centroids()->data()),
+        levelsCount_(flatStorage->clusterizer()->centroids()->size()),
+        vocabulary_(
+            flatStorage->word_offsets(),
+            flatStorage->packed_words(),
+            flatStorage->perfect_hash(),
+            flatStorage->search_tree()),
+        valueOffsets_(flatStorage->value_offsets()),
+        squaredNorms_(flatStorage->squared_norms())
+    {
+        initialize(flatStorage->packed_values(), paddedValues);
+    }
+
+    template <typename FlatStorage>
+    static std::vector<MemoryRange> commonMemoryRanges(const FlatStorage* flatStorage)
+    {
+        std::vector<MemoryRange> result = {
+            vectorRange(StorageSection::Vocabulary, flatStorage->word_offsets(), sizeof(uint32_t)),
+            vectorRange(StorageSection::Vocabulary, flatStorage->packed_words(), sizeof(char)),
+            vectorRange(StorageSection::Vocabulary, flatStorage->search_tree(), sizeof(wire::SearchTreeNode)),
+            vectorRange(StorageSection::Decoder, flatStorage->clusterizer()->centroids(), sizeof(float)),
+            vectorRange(StorageSection::Values, flatStorage->value_offsets(), sizeof(uint32_t)),
+            vectorRange(StorageSection::Values, flatStorage->packed_values(), sizeof(uint8_t)),
+            vectorRange(StorageSection::Values, flatStorage->squared_norms(), sizeof(float))
+        };
+
+        if (flatStorage->perfect_hash()) {
+            auto perfectHash = flatStorage->perfect_hash();
+            result.push_back(vectorRange(
+                StorageSection::Vocabulary, perfectHash->bucket_seeds(), sizeof(uint32_t)));
+            result.push_back(vectorRange(
+                StorageSection::Vocabulary, perfectHash->slots(), sizeof(wire::PerfectHashSlot)));
+        }
+
+        return result;
+    }
+
+    virtual void decodeCodes(size_t wordId, uint8_t* codes) const = 0;
+
+    const uint8_t* packedValues(size_t wordId) const
+    {
+        size_t offset = valueOffsets_->Get(wordId);
+        return offset < tailOffset_
+            ? packedValues_ + offset
+            : paddedTail_.data() + (offset - tailOffset_);
+    }
+
+    size_t dim_;
+    // Point into the mapped file
+    const float* centroids_;
+    size_t levelsCount_;
+
+private:
+    void initialize(const flatbuffers::Vector<uint8_t>* packedValues, bool paddedValues);
+    float squaredNorm(size_t wordId, const uint8_t* codes) const;
+    // Built on first use, so that opening a model does not depend on the levels count
+    const std::vector<float>& centroidProducts() const;
+
+    PackedVocabulary vocabulary_;
+    const flatbuffers::Vector<uint32_t>* valueOffsets_;
+    const flatbuffers::Vector<float>* squaredNorms_;
+    const uint8_t* packedValues_;
+    size_t packedValuesSize_;
+    // Padded copy of the vectors from tailOffset_ on, which end too close
+    // to the end of unpadded packed values
+    size_t tailOffset_;
+    std::vector<uint8_t> paddedTail_;
+    // Row-major levels x levels matrix of centroid products
+    mutable std::vector<float> centroidProducts_;
+    mutable std::once_flag centroidProductsBuilt_;
+};
+
+// Quantizes vectors with k-means and lays out their codes, entropy coding
+// of the codes and the flat storage table are left to subclasses
+class CentroidCompressor : public Compressor {
+public:
+    CentroidCompressor(
+        flatbuffers::FlatBufferBuilder& builder,
+        size_t bitsPerWeight,
+        const CompressionOptions& options);
+
+    virtual void add(
+        const std::string& word,
+        const float* source,
+        size_t dim,
+        double frequency) override;
+
+    virtual flatbuffers::Offset<void> finalize() override;
+
+protected:
+    struct StorageParts {
+        flatbuffers::Offset<flatbuffers::Vector<uint32_t>> wordOffsets;
+        flatbuffers::Offset<flatbuffers::Vector<uint32_t>> valueOffsets;
+        flatbuffers::Offset<flatbuffers::String> packedWords;
+        flatbuffers::Offset<flatbuffers::Vector<uint8_t>> packedValues;
+        flatbuffers::Offset<wire::KMeansClusterizer> clusterizer;
+        flatbuffers::Offset<wire::PerfectHashIndex> perfectHash;
+        flatbuffers::Offset<flatbuffers::Vector<const wire::SearchTreeNode*>> searchTree;
+        flatbuffers::Offset<flatbuffers::Vector<float>> squaredNorms;
+    };
+
+    // Called with codes of all vectors before any of them is encoded
+    virtual void fitCoder(const std::vector<std::vector<uint8_t>>& codes) = 0;
+    virtual std::vector<uint8_t> encodeCodes(const std::vector<uint8_t>& codes) const = 0;
+    virtual flatbuffers::Offset<void> createStorage(const StorageParts& parts) = 0;
+
+    flatbuffers::FlatBufferBuilder& builder_;
+    uint8_t quantizationLevels_;
+    CompressionOptions options_;
+
+private:
+    struct WordVector {
+        std::string word;
+        std::vector<float> values;
+        double frequency;
+    };
+
+    std::vector<WordVector> embeddings_;
+};
+
+}
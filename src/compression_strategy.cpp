@@ -1,9 +1,14 @@
 #include "full_compression.h"
 #include "uniform_compression.h"
 #include "trained_compression.h"
+#include "ans_compression.h"
+#include "packed_compression.h"
 
 #include <boost/format.hpp>
 
+#include <algorithm>
+#include <numeric>
+
 namespace memb {
 
 namespace {
@@ -15,6 +20,8 @@ const std::vector<std::shared_ptr<CompressionStrategy>>& compressionStrategies()
         std::make_shared<FullCompressionStrategy>(),
         std::make_shared<UniformCompressionStrategy>(),
         std::make_shared<TrainedCompressionStrategy>(),
+        std::make_shared<AnsCompressionStrategy>(),
+        std::make_shared<PackedCompressionStrategy>(),
     };
 
     return strategies;
@@ -22,6 +29,139 @@ const std::vector<std::shared_ptr<CompressionStrategy>>& compressionStrategies()
 
 } // namespace
 
+const int64_t CompressedStorage::MISSING_WORD;
+
+std::vector<int64_t> CompressedStorage::sortedWordIds(const std::vector<const std::string*>& words) const
+{
+    std::vector<int64_t> result;
+    result.reserve(words.size());
+
+    for (auto word : words) {
+        result.push_back(wordId(*word));
+    }
+
+    return result;
+}
+
+bool CompressedStorage::extract(const std::string& word, float* destination) const
+{
+    auto id = wordId(word);
+    if (id == MISSING_WORD) {
+        return false;
+    }
+
+    extractById(id, destination);
+    return true;
+}
+
+void CompressedStorage::extractRangeById(
+    size_t wordId, size_t dim, size_t begin, size_t end, float* destination) const
+{
+    std::vector<float> values(dim);
+    extractById(wordId, values.data());
+    std::copy(values.begin() + begin, values.begin() + end, destination);
+}
+
+std::vector<std::string> CompressedStorage::keys() const
+{
+    std::vector<std::string> result;
+    result.reserve(size());
+
+    for (size_t wordId = 0; wordId < size(); ++wordId) {
+        result.push_back(word(wordId).to_string());
+    }
+
+    return result;
+}
+
+ScoringQueries CompressedStorage::prepareScoring(const float* queries, size_t queriesCount, size_t dim) const
+{
+    ScoringQueries result{queries, queriesCount, dim, {}, {}};
+    for (size_t query = 0; query < queriesCount; ++query) {
+        const float* queryValues = queries + query * dim;
+        result.squaredNorms.push_back(std::inner_product(queryValues, queryValues + dim, queryValues, 0.0f));
+    }
+
+    return result;
+}
+
+void CompressedStorage::scoreBatch(
+    const ScoringQueries& queries,
+    SimilarityMetric metric,
+    const uint32_t* wordIds,
+    size_t wordsCount,
+    float* scores) const
+{
+    size_t dim = queries.dim;
+    std::vector<float> values(dim);
+    for (size_t i = 0; i < wordsCount; ++i) {
+        extractById(wordIds[i], values.data());
+        auto squaredNorm = std::inner_product(values.begin(), values.end(), values.begin(), 0.0f);
+
+        for (size_t query = 0; query < queries.count; ++query) {
+            auto dot = std::inner_product(values.begin(), values.end(), queries.values + query * dim, 0.0f);
+            scores[query * wordsCount + i] = similarityScore(
+                metric, dot, queries.squaredNorms[query], squaredNorm);
+        }
+    }
+}
+
+void CompressedStorage::scorePairs(
+    size_t dim,
+    SimilarityMetric metric,
+    const int64_t* firstIds,
+    const int64_t* secondIds,
+    size_t pairsCount,
+    float* scores) const
+{
+    std::vector<float> first(dim);
+    std::vector<float> second(dim);
+    for (size_t i = 0; i < pairsCount; ++i) {
+        std::fill(first.begin(), first.end(), 0);
+        std::fill(second.begin(), second.end(), 0);
+        if (firstIds[i] >= 0) {
+            extractById(firstIds[i], first.data());
+        }
+        if (secondIds[i] >= 0) {
+            extractById(secondIds[i], second.data());
+        }
+
+        scores[i] = pairSimilarity(
+            metric,
+            std::inner_product(first.begin(), first.end(), second.begin(), 0.0f),
+            std::inner_product(first.begin(), first.end(), first.begin(), 0.0f),
+            std::inner_product(second.begin(), second.end(), second.begin(), 0.0f));
+    }
+}
+
+std::vector<MemoryRange> CompressedStorage::memoryRanges() const
+{
+    return {};
+}
+
+void CompressedStorage::prefetch(const std::vector<int64_t>&) const
+{}
+
+std::vector<bool> CompressedStorage::extractSorted(
+    const std::vector<const std::string*>& words,
+    const std::vector<float*>& destinations) const
+{
+    auto wordIds = sortedWordIds(words);
+
+    std::vector<bool> result;
+    result.reserve(words.size());
+    for (size_t i = 0; i < wordIds.size(); ++i) {
+        if (wordIds[i] != MISSING_WORD) {
+            extractById(wordIds[i], destinations[i]);
+            result.push_back(true);
+        } else {
+            result.push_back(false);
+        }
+    }
+
+    return result;
+}
+
 std::shared_ptr<CompressionStrategy> createCompressionStrategy(wire::Storage storage)
 {
     const std::vector<std::shared_ptr<CompressionStrategy>>& strategies = compressionStrategies();
@@ -1,22 +1,134 @@
 #pragma once
 
 #include "embeddings_generated.h"
+#include "similarity.h"
+
+#include <boost/utility/string_view.hpp>
 
 namespace memb {
 
+struct CompressionOptions {
+    bool perfectHashIndex = false;
+    bool searchTree = false;
+    // Number of k-means clusters of the approximate nearest neighbour index,
+    // zero disables the index
+    size_t ivfListsCount = 0;
+    // Symbols of every vector are split round-robin into this many
+    // independent Huffman streams (1, 2, 4 or 8), which lets the decoder
+    // overlap table lookups of different streams
+    size_t huffmanStreams = 1;
+    // Dimensions are split into at most this many contiguous blocks with
+    // their own Huffman codebooks, which follow per-dimension distributions
+    // closer and keep every decode table small
+    size_t codebookBlocks = 1;
+    // Trained storage keeps bit offsets of every checkpointInterval-th code
+    // (a multiple of huffmanStreams), so that dimension ranges are decoded
+    // without the codes before them. Zero disables checkpoints.
+    size_t checkpointInterval = 0;
+    // Trained storage keeps finished lookup tables of that many bits (1 to 16),
+    // so that readers with the same DecodingOptions::decodeTableBits and one
+    // symbol per lookup start without building them. Zero disables the tables.
+    size_t decodeTableBits = 0;
+};
+
+struct DecodingOptions {
+    // Bits indexing the Huffman lookup tables, longer codes take a second lookup
+    size_t decodeTableBits = 10;
+    // Codes emitted by one lookup of trained storage (1 to 4). Values above one
+    // add a table of decodeTableBits size that resolves several short codes at once.
+    size_t symbolsPerLookup = 1;
+};
+
+enum class StorageSection {
+    Vocabulary,
+    Decoder,
+    Values
+};
+
+struct MemoryRange {
+    StorageSection section;
+    const void* data;
+    size_t size;
+};
+
+// Row-major queries of a similarity search with the data that would
+// otherwise be recomputed by every scoreBatch call
+struct ScoringQueries {
+    const float* values;
+    size_t count;
+    size_t dim;
+    std::vector<float> squaredNorms;
+    // Storage-specific per-query tables, such as products with centroids
+    std::vector<float> tables;
+};
+
 class CompressedStorage {
 public:
-    virtual bool extract(const std::string& word, float* destination) const = 0;
-    virtual std::vector<std::string> keys() const = 0;
+    static const int64_t MISSING_WORD = -1;
+
+    // Word ids are positions of words in the sorted vocabulary,
+    // MISSING_WORD is returned for unknown words
+    virtual int64_t wordId(const std::string& word) const = 0;
+
+    // Words must be sorted in ascending order and contain no duplicates
+    virtual std::vector<int64_t> sortedWordIds(const std::vector<const std::string*>& words) const;
+
+    virtual size_t size() const = 0;
+    virtual void extractById(size_t wordId, float* destination) const = 0;
+
+    virtual bool extract(const std::string& word, float* destination) const;
+    // Writes dimensions [begin, end) of the vector, storages without
+    // random access decode the whole vector to a temporary buffer
+    virtual void extractRangeById(
+        size_t wordId, size_t dim, size_t begin, size_t end, float* destination) const;
+
+    // Words must be sorted in ascending order and contain no duplicates.
+    // Returns flags telling which of the words were found.
+    virtual std::vector<bool> extractSorted(
+        const std::vector<const std::string*>& words,
+        const std::vector<float*>& destinations) const;
+
+    // Points into the mapped file, valid while the storage is alive
+    virtual boost::string_view word(size_t wordId) const = 0;
+    virtual std::vector<std::string> keys() const;
+
+    // Prepared once per set of queries, which must outlive the result
+    virtual ScoringQueries prepareScoring(const float* queries, size_t queriesCount, size_t dim) const;
+    // Writes similarityScore of every query against the words
+    // to scores, which is a row-major queries.count x wordsCount matrix
+    virtual void scoreBatch(
+        const ScoringQueries& queries,
+        SimilarityMetric metric,
+        const uint32_t* wordIds,
+        size_t wordsCount,
+        float* scores) const;
+
+    // Writes pairSimilarity of vectors with firstIds[i] and secondIds[i]
+    // to scores[i], negative ids stand for zero vectors
+    virtual void scorePairs(
+        size_t dim,
+        SimilarityMetric metric,
+        const int64_t* firstIds,
+        const int64_t* secondIds,
+        size_t pairsCount,
+        float* scores) const;
+
+    // Parts of the mapped file used by the storage, empty if they are not separable
+    virtual std::vector<MemoryRange> memoryRanges() const;
+    // Hint that the words are going to be decoded soon, MISSING_WORD ids are skipped
+    virtual void prefetch(const std::vector<int64_t>& wordIds) const;
+
     virtual ~CompressedStorage() {};
 };
 
 class Compressor {
 public:
+    // Storages that support it lay out vectors of frequent words first
     virtual void add(
         const std::string& word,
         const float* source,
-        size_t dim) = 0;
+        size_t dim,
+        double frequency) = 0;
 
     virtual flatbuffers::Offset<void> finalize() = 0;
     virtual ~Compressor() {};
@@ -25,10 +137,12 @@ public:
 class CompressionStrategy {
 public:
     virtual std::shared_ptr<Compressor> createCompressor(
-        flatbuffers::FlatBufferBuilder& builder, size_t bitsPerWeight) const = 0;
+        flatbuffers::FlatBufferBuilder& builder,
+        size_t bitsPerWeight,
+        const CompressionOptions& options) const = 0;
 
     virtual std::shared_ptr<CompressedStorage> createCompressedStorage(
-        const void* flatStorage, size_t dim) const = 0;
+        const void* flatStorage, size_t dim, const DecodingOptions& options) const = 0;
 
     virtual std::string storageName() const = 0;
 
@@ -0,0 +1,356 @@
+#include "benchmark.h"
+#include "reader.h"
+#include "bit_stream.h"
+#include "bit_stream_reader.h"
+#include "huffman_encoder.h"
+#include "trained_compression.h"
+
+#include <boost/format.hpp>
+#include <boost/test/unit_test.hpp>
+
+#include <algorithm>
+#include <cmath>
+#include <fstream>
+#include <numeric>
+
+using namespace memb;
+
+namespace {
+
+const std::string BENCHMARK_MODEL_FILENAME = "benchmark.bin";
+const size_t WORDS_COUNT = 50000;
+const size_t DIM = 300;
+const size_t SYMBOLS_COUNT = 1 << 24;
+
+size_t fileSize(const std::string& filename)
+{
+    return std::ifstream(filename, std::ios::binary | std::ios::ate).tellg();
+}
+
+// Decodes every vector one by one, which is dominated by the Huffman decoder
+double decodeAllSeconds(const Reader& reader)
+{
+    std::vector<float> buffer(reader.dim());
+    return measureSeconds(
+        [&]()
+        {
+            for (size_t wordId = 0; wordId < reader.size(); ++wordId) {
+                reader.embeddingByIdToBuffer(wordId, buffer.data());
+            }
+        });
+}
+
+// Quantized gaussian values, skewed like the codes of trained storage
+std::vector<uint8_t> gaussianSymbols(size_t count, size_t bitsPerSymbol)
+{
+    std::mt19937 generator(42);
+    std::normal_distribution<double> distribution(0, (1 << bitsPerSymbol) / 6.0);
+    int maxSymbol = (1 << bitsPerSymbol) - 1;
+
+    std::vector<uint8_t> result;
+    for (size_t i = 0; i < count; ++i) {
+        int value = std::lround(distribution(generator) + maxSymbol / 2.0);
+        result.push_back(std::max(0, std::min(value, maxSymbol)));
+    }
+
+    return result;
+}
+
+// Previous reader, which refills the accumulator byte by byte with a bounds check
+class ByteWiseBitStreamReader {
+public:
+    ByteWiseBitStreamReader(const uint8_t* data, const uint8_t* dataEnd):
+        accumulator_(0),
+        data_(data),
+        dataEnd_(dataEnd),
+        extraBits_(0)
+    {}
+
+    uint64_t pull(size_t bitsCount)
+    {
+        extraBits_ -= bitsCount;
+        while (extraBits_ < 0) {
+            for (size_t i = 0; i < 4; ++i) {
+                accumulator_ <<= 8;
+                if (data_ < dataEnd_) {
+                    accumulator_ += *data_;
+                    ++data_;
+                }
+            }
+            extraBits_ += 32;
+        }
+
+        return accumulator_ >> extraBits_;
+    }
+
+private:
+    uint64_t accumulator_;
+    const uint8_t* data_;
+    const uint8_t* dataEnd_;
+    int extraBits_;
+};
+
+} // namespace
+
+BOOST_AUTO_TEST_SUITE(vectorDecoding)
+
+BOOST_AUTO_TEST_CASE(interleavedStreams)
+{
+    for (size_t bitsPerWeight : {4, 8}) {
+        for (size_t streams : {1, 2, 4, 8}) {
+            CompressionOptions options;
+            options.huffmanStreams = streams;
+            createBenchmarkModel(BENCHMARK_MODEL_FILENAME, WORDS_COUNT, DIM, "trained", bitsPerWeight, options);
+            Reader reader(BENCHMARK_MODEL_FILENAME, 1);
+
+            auto name = boost::str(boost::format("%1% bits, %2% streams (%3% MB)") %
+                bitsPerWeight % streams % (fileSize(BENCHMARK_MODEL_FILENAME) >> 20));
+            reportThroughput(name, WORDS_COUNT, decodeAllSeconds(reader), "vectors");
+        }
+    }
+}
+
+BOOST_AUTO_TEST_CASE(ansVersusHuffman)
+{
+    for (size_t bitsPerWeight : {2, 4, 6, 8}) {
+        for (const std::string storageName : {"trained", "ans"}) {
+            createBenchmarkModel(BENCHMARK_MODEL_FILENAME, WORDS_COUNT, DIM, storageName, bitsPerWeight);
+            Reader reader(BENCHMARK_MODEL_FILENAME, 1);
+
+            auto name = boost::str(boost::format("%1% bits, %2% (%3$.2f MB)") %
+                bitsPerWeight % storageName % (fileSize(BENCHMARK_MODEL_FILENAME) / 1048576.0));
+            reportThroughput(name, WORDS_COUNT, decodeAllSeconds(reader), "vectors");
+        }
+    }
+}
+
+BOOST_AUTO_TEST_CASE(packedVersusHuffman)
+{
+    for (size_t bitsPerWeight : {2, 4, 6, 8}) {
+        for (const std::string storageName : {"trained", "packed"}) {
+            createBenchmarkModel(BENCHMARK_MODEL_FILENAME, WORDS_COUNT, DIM, storageName, bitsPerWeight);
+            Reader reader(BENCHMARK_MODEL_FILENAME, 1);
+
+            auto name = boost::str(boost::format("%1% bits, %2% (%3$.2f MB)") %
+                bitsPerWeight % storageName % (fileSize(BENCHMARK_MODEL_FILENAME) / 1048576.0));
+            reportThroughput(name, WORDS_COUNT, decodeAllSeconds(reader), "vectors");
+        }
+    }
+}
+
+BOOST_AUTO_TEST_CASE(codebookBlocks)
+{
+    // Dimensions with different spreads and offsets, as in trained embeddings
+    std::mt19937 generator(42);
+    std::normal_distribution<float> distribution;
+    auto words = benchmarkWords(WORDS_COUNT);
+    std::vector<std::vector<float>> vectors(words.size(), std::vector<float>(DIM));
+    for (auto& vector : vectors) {
+        for (size_t i = 0; i < DIM; ++i) {
+            double position = static_cast<double>(i) / DIM;
+            vector[i] = distribution(generator) * (0.2 + 2 * position * position) + std::sin(8 * position);
+        }
+    }
+
+    for (size_t bitsPerWeight : {4, 6}) {
+        for (size_t blocks : {1, 2, 8, 30}) {
+            CompressionOptions options;
+            options.codebookBlocks = blocks;
+            Builder builder(DIM, "trained", bitsPerWeight, options);
+            for (size_t i = 0; i < words.size(); ++i) {
+                builder.addWord(words[i], vectors[i]);
+            }
+            builder.save(BENCHMARK_MODEL_FILENAME);
+            Reader reader(BENCHMARK_MODEL_FILENAME, 1);
+
+            double squaredError = 0;
+            for (size_t i = 0; i < words.size(); ++i) {
+                auto embedding = reader.wordEmbedding(words[i]);
+                for (size_t j = 0; j < DIM; ++j) {
+                    squaredError += (embedding[j] - vectors[i][j]) * (embedding[j] - vectors[i][j]);
+                }
+            }
+
+            auto name = boost::str(boost::format("%1% bits, %2% codebooks (%3$.2f MB, MSE %4$.4f)") %
+                bitsPerWeight % blocks % (fileSize(BENCHMARK_MODEL_FILENAME) / 1048576.0) %
+                (squaredError / (words.size() * DIM)));
+            reportThroughput(name, WORDS_COUNT, decodeAllSeconds(reader), "vectors");
+        }
+    }
+}
+
+BOOST_AUTO_TEST_CASE(embeddingRanges)
+{
+    for (size_t checkpointInterval : {0, 30, 60}) {
+        CompressionOptions options;
+        options.checkpointInterval = checkpointInterval;
+        createBenchmarkModel(BENCHMARK_MODEL_FILENAME, WORDS_COUNT, DIM, "trained", 4, options);
+        Reader reader(BENCHMARK_MODEL_FILENAME, 1);
+
+        auto name = boost::str(boost::format("checkpoints every %1% (%2$.2f MB), whole vectors") %
+            checkpointInterval % (fileSize(BENCHMARK_MODEL_FILENAME) / 1048576.0));
+        reportThroughput(name, WORDS_COUNT, decodeAllSeconds(reader), "vectors");
+
+        for (auto range : {std::make_pair(0, 50), std::make_pair(120, 180), std::make_pair(240, 300)}) {
+            std::vector<float> buffer(range.second - range.first);
+            auto seconds = measureSeconds(
+                [&]()
+                {
+                    for (int64_t wordId = 0; wordId < static_cast<int64_t>(reader.size()); ++wordId) {
+                        reader.batchEmbeddingRangeByIdsToBuffer(
+                            &wordId, 1, range.first, range.second, buffer.data());
+                    }
+                });
+
+            auto name = boost::str(boost::format("checkpoints every %1%, dimensions [%2%, %3%)") %
+                checkpointInterval % range.first % range.second);
+            reportThroughput(name, WORDS_COUNT, seconds, "vectors");
+        }
+    }
+}
+
+// Shapes models are usually shipped with, the baseline
+// for any decoder specialized for them
+BOOST_AUTO_TEST_CASE(shippedShapes)
+{
+    const size_t wordsCount = 20000;
+    for (size_t dim : {100, 200, 300, 768}) {
+        createBenchmarkModel(BENCHMARK_MODEL_FILENAME, wordsCount, dim, "trained", 4);
+        for (size_t decodeTableBits : {8, 10, 12}) {
+            ReaderOptions options;
+            options.numThreads = 1;
+            options.decoding.decodeTableBits = decodeTableBits;
+            Reader reader(BENCHMARK_MODEL_FILENAME, options);
+
+            auto name = boost::str(boost::format("dim %1%, %2%-bit table") % dim % decodeTableBits);
+            reportThroughput(name, wordsCount * dim, decodeAllSeconds(reader), "symbols");
+        }
+    }
+}
+
+BOOST_AUTO_TEST_CASE(readerStartup)
+{
+    const size_t readersCount = 200;
+    for (size_t bitsPerWeight : {4, 8}) {
+        for (size_t codebookBlocks : {1, 30}) {
+            for (size_t decodeTableBits : {8, 12}) {
+                for (bool storedTables : {false, true}) {
+                    CompressionOptions compressionOptions;
+                    compressionOptions.codebookBlocks = codebookBlocks;
+                    compressionOptions.decodeTableBits = storedTables ? decodeTableBits : 0;
+                    createBenchmarkModel(
+                        BENCHMARK_MODEL_FILENAME, WORDS_COUNT, DIM, "trained", bitsPerWeight, compressionOptions);
+
+                    ReaderOptions options;
+                    options.numThreads = 1;
+                    options.decoding.decodeTableBits = decodeTableBits;
+                    double seconds = measureSeconds(
+                        [&]()
+                        {
+                            for (size_t i = 0; i < readersCount; ++i) {
+                                Reader reader(BENCHMARK_MODEL_FILENAME, options);
+                            }
+                        });
+
+                    auto name = boost::str(boost::format("%1% bits, %2% codebooks, %3%-bit table, %4%") %
+                        bitsPerWeight % codebookBlocks % decodeTableBits % (storedTables ? "stored" : "built"));
+                    std::cout << std::left << std::setw(48) << name << " "
+                        << std::fixed << std::setprecision(1) << seconds / readersCount * 1e6
+                        << " us per reader" << std::endl;
+                }
+            }
+        }
+    }
+}
+
+BOOST_AUTO_TEST_CASE(multiSymbolTables)
+{
+    for (size_t bitsPerWeight : {4, 6}) {
+        createBenchmarkModel(BENCHMARK_MODEL_FILENAME, WORDS_COUNT, DIM, "trained", bitsPerWeight);
+        for (size_t decodeTableBits : {10, 12}) {
+            for (size_t symbolsPerLookup : {1, 2, 3, 4}) {
+                ReaderOptions options;
+                options.numThreads = 1;
+                options.decoding.decodeTableBits = decodeTableBits;
+                options.decoding.symbolsPerLookup = symbolsPerLookup;
+                Reader reader(BENCHMARK_MODEL_FILENAME, options);
+
+                auto name = boost::str(boost::format("%1% bits, %2%-bit table, %3% symbols per lookup") %
+                    bitsPerWeight % decodeTableBits % symbolsPerLookup);
+                reportThroughput(name, WORDS_COUNT, decodeAllSeconds(reader), "vectors");
+            }
+        }
+    }
+}
+
+BOOST_AUTO_TEST_CASE(bitStreamReaders)
+{
+    // Fields of Huffman code lengths of 4-bit symbols
+    std::mt19937 generator(42);
+    std::uniform_int_distribution<size_t> lengthDistribution(2, 7);
+    std::vector<uint8_t> lengths;
+    BitStream bitStream;
+    for (size_t i = 0; i < SYMBOLS_COUNT; ++i) {
+        lengths.push_back(lengthDistribution(generator));
+        bitStream.push({static_cast<uint16_t>(i & ((1U << lengths.back()) - 1)), lengths.back()});
+    }
+    auto data = bitStream.data();
+    data.resize(data.size() + BitStreamReader::PADDING_BYTES, 0);
+
+    size_t byteWiseChecksum = 0;
+    double byteWiseSeconds = measureSeconds(
+        [&]()
+        {
+            ByteWiseBitStreamReader reader(data.data(), data.data() + data.size());
+            for (auto length : lengths) {
+                byteWiseChecksum += reader.pull(length) & ((1U << length) - 1);
+            }
+        });
+    reportThroughput("byte-wise refill", SYMBOLS_COUNT, byteWiseSeconds, "symbols");
+
+    size_t checksum = 0;
+    double seconds = measureSeconds(
+        [&]()
+        {
+            BitStreamReader reader(data.data());
+            for (auto length : lengths) {
+                reader.refill();
+                checksum += reader.peek(length);
+                reader.consume(length);
+            }
+        });
+    reportThroughput("64-bit refill", SYMBOLS_COUNT, seconds, "symbols");
+
+    BOOST_CHECK_EQUAL(checksum, byteWiseChecksum);
+}
+
+BOOST_AUTO_TEST_CASE(huffmanSymbols)
+{
+    for (size_t bitsPerSymbol : {4, 8}) {
+        auto symbols = gaussianSymbols(SYMBOLS_COUNT, bitsPerSymbol);
+        HuffmanEncoderBuilder encoderBuilder;
+        encoderBuilder.updateFrequencies(symbols);
+        auto encoder = encoderBuilder.createEncoder();
+        auto decoder = encoder.createDecoder().createTableDecoder(
+            DecodingOptions().decodeTableBits);
+
+        auto encoded = encoder.encode(symbols);
+        encoded.resize(encoded.size() + BitStreamReader::PADDING_BYTES, 0);
+
+        size_t checksum = 0;
+        double seconds = measureSeconds(
+            [&]()
+            {
+                auto state = decoder.decode(encoded.data());
+                for (size_t i = 0; i < SYMBOLS_COUNT; ++i) {
+                    checksum += decoder.next(state);
+                }
+            });
+        BOOST_CHECK_EQUAL(checksum, std::accumulate(symbols.begin(), symbols.end(), size_t(0)));
+
+        auto name = boost::str(boost::format("%1% bits per symbol") % bitsPerSymbol);
+        reportThroughput(name, SYMBOLS_COUNT, seconds, "symbols");
+    }
+}
+
+BOOST_AUTO_TEST_SUITE_END()
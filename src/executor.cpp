@@ -0,0 +1,114 @@
+#include "executor.h"
+
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <exception>
+#include <memory>
+#include <mutex>
+
+namespace memb {
+
+namespace {
+
+// Several jobs per participant keep threads busy when jobs are uneven
+const size_t JOBS_PER_THREAD = 4;
+
+struct ParallelForState {
+    ParallelForState(
+            size_t count,
+            size_t jobSize,
+            const std::function<void(size_t, size_t)>& function):
+        count(count),
+        jobSize(jobSize),
+        jobsCount((count + jobSize - 1) / jobSize),
+        function(function),
+        nextJob(0),
+        finishedJobs(0)
+    {}
+
+    // Returns false when there are no jobs left
+    bool runJob()
+    {
+        size_t job = nextJob++;
+        if (job >= jobsCount) {
+            return false;
+        }
+
+        try {
+            function(job * jobSize, std::min(count, (job + 1) * jobSize));
+        } catch (...) {
+            std::lock_guard<std::mutex> lock(mutex);
+            if (!exception) {
+                exception = std::current_exception();
+            }
+        }
+
+        if (++finishedJobs == jobsCount) {
+            std::lock_guard<std::mutex> lock(mutex);
+            finished.notify_all();
+        }
+
+        return true;
+    }
+
+    const size_t count;
+    const size_t jobSize;
+    const size_t jobsCount;
+    const std::function<void(size_t, size_t)>& function;
+
+    std::atomic<size_t> nextJob;
+    std::atomic<size_t> finishedJobs;
+    std::mutex mutex;
+    std::condition_variable finished;
+    std::exception_ptr exception;
+};
+
+} // namespace
+
+void parallelFor(
+    Executor* executor,
+    size_t count,
+    size_t minJobSize,
+    const std::function<void(size_t, size_t)>& function)
+{
+    minJobSize = std::max<size_t>(minJobSize, 1);
+    if (!executor || count <= minJobSize || executor->concurrency() == 0) {
+        function(0, count);
+        return;
+    }
+
+    size_t threadsCount = executor->concurrency() + 1;
+    size_t jobSize = std::max(minJobSize, count / (threadsCount * JOBS_PER_THREAD));
+
+    // Helpers may start after all jobs are done, so the state
+    // is shared with them instead of living on this stack frame.
+    // The function reference is only used by claimed jobs, which
+    // always finish before this call returns.
+    auto state = std::make_shared<ParallelForState>(count, jobSize, function);
+
+    size_t helpersCount = std::min(threadsCount - 1, state->jobsCount - 1);
+    for (size_t i = 0; i < helpersCount; ++i) {
+        executor->submit(
+            [state]
+            {
+                while (state->runJob()) {}
+            });
+    }
+
+    while (state->runJob()) {}
+
+    std::unique_lock<std::mutex> lock(state->mutex);
+    state->finished.wait(
+        lock,
+        [&state]
+        {
+            return state->finishedJobs == state->jobsCount;
+        });
+
+    if (state->exception) {
+        std::rethrow_exception(state->exception);
+    }
+}
+
+}
@@ -0,0 +1,31 @@
+#pragma once
+
+#include <cstddef>
+#include <functional>
+
+namespace memb {
+
+// Runs tasks asynchronously. Implement it to make Reader
+// share threads with the embedding application (TBB, service pools, etc).
+class Executor {
+public:
+    virtual ~Executor() = default;
+
+    virtual void submit(std::function<void()> task) = 0;
+
+    // Number of tasks that may run simultaneously
+    virtual size_t concurrency() const = 0;
+};
+
+// Calls function(begin, end) for consecutive ranges covering [0, count).
+// Ranges are at least minJobSize long and are claimed dynamically by the
+// calling thread and by up to executor->concurrency() submitted helpers,
+// so the call never blocks waiting for a busy executor.
+// Null executor means that everything runs in the calling thread.
+void parallelFor(
+    Executor* executor,
+    size_t count,
+    size_t minJobSize,
+    const std::function<void(size_t, size_t)>& function);
+
+}
@@ -1,5 +1,7 @@
 #include "full_compression.h"
 
+#include <algorithm>
+
 namespace memb {
 
 FullCompressor::FullCompressor(flatbuffers::FlatBufferBuilder& builder):
@@ -9,7 +11,8 @@ FullCompressor::FullCompressor(flatbuffers::FlatBufferBuilder& builder):
 void FullCompressor::add(
     const std::string& word,
     const float* source,
-    size_t dim)
+    size_t dim,
+    double)
 {
     embeddings_.emplace(
         word,
@@ -34,38 +37,59 @@ FullCompressedStorage::FullCompressedStorage(const void* flatStorage):
     flatStorage_(static_cast<const wire::Full*>(flatStorage))
 {}
 
-bool FullCompressedStorage::extract(const std::string& word, float* destination) const
+int64_t FullCompressedStorage::wordId(const std::string& word) const
 {
-    auto resultNode = flatStorage_->nodes()->LookupByKey(word.c_str());
-    if (resultNode) {
-        auto values = resultNode->values();
-        std::copy(values->begin(), values->end(), destination);
-        return true;
+    auto nodes = flatStorage_->nodes();
+    auto resultIt = std::lower_bound(
+        nodes->begin(),
+        nodes->end(),
+        word.c_str(),
+        [](const wire::FullNode* node, const char* word)
+        {
+            return node->KeyCompareWithValue(word) < 0;
+        });
+
+    if (resultIt != nodes->end() && resultIt->KeyCompareWithValue(word.c_str()) == 0) {
+        return resultIt - nodes->begin();
     } else {
-        return false;
+        return MISSING_WORD;
     }
 }
 
-std::vector<std::string> FullCompressedStorage::keys() const
+size_t FullCompressedStorage::size() const
 {
-    std::vector<std::string> result;
-    result.reserve(flatStorage_->nodes()->size());
+    return flatStorage_->nodes()->size();
+}
 
-    for (const auto& node : *flatStorage_->nodes()) {
-        result.emplace_back(node->word()->begin(), node->word()->end());
-    }
+void FullCompressedStorage::extractById(size_t wordId, float* destination) const
+{
+    auto values = flatStorage_->nodes()->Get(wordId)->values();
+    std::copy(values->begin(), values->end(), destination);
+}
 
-    return result;
+void FullCompressedStorage::extractRangeById(
+    size_t wordId, size_t, size_t begin, size_t end, float* destination) const
+{
+    auto values = flatStorage_->nodes()->Get(wordId)->values();
+    std::copy(values->begin() + begin, values->begin() + end, destination);
+}
+
+boost::string_view FullCompressedStorage::word(size_t wordId) const
+{
+    auto word = flatStorage_->nodes()->Get(wordId)->word();
+    return boost::string_view(word->c_str(), word->size());
 }
 
 std::shared_ptr<Compressor> FullCompressionStrategy::createCompressor(
-    flatbuffers::FlatBufferBuilder& builder, size_t /*bitsPerWeight*/) const
+    flatbuffers::FlatBufferBuilder& builder,
+    size_t /*bitsPerWeight*/,
+    const CompressionOptions& /*options*/) const
 {
     return std::make_shared<FullCompressor>(builder);
 }
 
 std::shared_ptr<CompressedStorage> FullCompressionStrategy::createCompressedStorage(
-    const void* flatStorage, size_t /*dim*/) const
+    const void* flatStorage, size_t /*dim*/, const DecodingOptions& /*options*/) const
 {
     return std::make_shared<FullCompressedStorage>(flatStorage);
 }
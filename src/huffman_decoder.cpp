@@ -2,15 +2,17 @@
 
 namespace memb {
 
+const size_t HuffmanTableDecoder::MAX_SYMBOLS_PER_LOOKUP;
+
 HuffmanDecoder::HuffmanDecoder(const std::vector<uint8_t>& keys, const std::vector<uint32_t>& offsets):
     keys_(keys),
     sizeOffsets_(offsets)
 {}
 
 HuffmanTableDecoder HuffmanDecoder::createTableDecoder(
-    size_t maxDirectDecodeBitLength) const
+    size_t maxDirectDecodeBitLength, size_t symbolsPerLookup) const
 {
-    return HuffmanTableDecoder(keys_, sizeOffsets_, maxDirectDecodeBitLength);
+    return HuffmanTableDecoder(keys_, sizeOffsets_, maxDirectDecodeBitLength, symbolsPerLookup);
 }
 
 flatbuffers::Offset<wire::HuffmanDecoder> HuffmanDecoder::save(
@@ -11,7 +11,8 @@ class HuffmanDecoder {
 public:
     HuffmanDecoder(const std::vector<uint8_t>& keys, const std::vector<uint32_t>& offsets);
 
-    HuffmanTableDecoder createTableDecoder(size_t maxDirectDecodeBitLength) const;
+    HuffmanTableDecoder createTableDecoder(
+        size_t maxDirectDecodeBitLength, size_t symbolsPerLookup = 1) const;
 
     flatbuffers::Offset<wire::HuffmanDecoder> save(flatbuffers::FlatBufferBuilder& builder) const;
     static HuffmanDecoder load(const wire::HuffmanDecoder* serialized);
@@ -90,12 +90,17 @@ HuffmanEncoder::HuffmanEncoder(const std::unordered_map<uint8_t, size_t>& counts
 std::vector<uint8_t> HuffmanEncoder::encode(const std::vector<uint8_t>& data) const
 {
     BitStream valuesStream;
-    for (const auto& value : data) {
-        valuesStream.push(codebook_.at(value));
-    }
+    encode(data, &valuesStream);
 
     return valuesStream.data();
 }
+
+void HuffmanEncoder::encode(const std::vector<uint8_t>& data, BitStream* stream) const
+{
+    for (const auto& value : data) {
+        stream->push(codebook_.at(value));
+    }
+}
     
 HuffmanDecoder HuffmanEncoder::createDecoder() const
 {
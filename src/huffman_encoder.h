@@ -5,11 +5,15 @@
 
 namespace memb {
 
+class BitStream;
+
 class HuffmanEncoder {
 public:
     HuffmanEncoder(const std::unordered_map<uint8_t, size_t>& counts);
 
     std::vector<uint8_t> encode(const std::vector<uint8_t>& data) const;
+    // Appends codes to the stream, so that several codebooks can share it
+    void encode(const std::vector<uint8_t>& data, BitStream* stream) const;
     
     HuffmanDecoder createDecoder() const;
 
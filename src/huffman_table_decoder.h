@@ -1,8 +1,13 @@
 #pragma once
 
 #include "bit_stream_reader.h"
+#include "huffman_decoder_generated.h"
 #include "prefix_code.h"
 
+#include <algorithm>
+#include <array>
+#include <memory>
+#include <stdexcept>
 #include <vector>
 #include <unordered_map>
 
@@ -10,20 +15,25 @@ namespace memb {
 
 class HuffmanTableDecoder {
 public:
+    static const size_t MAX_SYMBOLS_PER_LOOKUP = 4;
+
     struct DecodeState {
         BitStreamReader reader;
-        size_t bitsToPull;
+        size_t lookupsBeforeRefill;
     };
 
+    // With symbolsPerLookup > 1 a second table of the same size maps every
+    // maxDirectDecodeBitLength bit window to all codes it contains completely
     HuffmanTableDecoder(
             const std::vector<uint8_t>& keys,
             const std::vector<uint32_t>& sizeOffsets,
-            size_t maxDirectDecodeBitLength):
-        maxDirectDecodeBitLength_(maxDirectDecodeBitLength),
-        decodeTableBitMask_((1U << maxDirectDecodeBitLength_) - 1)
+            size_t maxDirectDecodeBitLength,
+            size_t symbolsPerLookup = 1):
+        maxDirectDecodeBitLength_(maxDirectDecodeBitLength)
     {
+        auto tables = std::make_shared<Tables>();
         size_t decodeTableSize = 1U << maxDirectDecodeBitLength_;
-        decodeTable_.reserve(decodeTableSize);
+        tables->direct.reserve(decodeTableSize);
 
         std::vector<CodeInfo> codeLengths;
         codeLengths.reserve(keys.size());
@@ -35,6 +45,11 @@ public:
             }
             codeLengths.push_back({keys[keyIndex], currentSize});
         }
+        size_t maxLookupBits = std::max<size_t>(currentSize, 1);
+        if (symbolsPerLookup > 1) {
+            maxLookupBits = std::max(maxLookupBits, maxDirectDecodeBitLength_);
+        }
+        lookupsPerRefill_ = BitStreamReader::REFILL_BITS / maxLookupBits;
 
         auto codes = createCanonicalPrefixCodes(codeLengths);
         size_t directTableSize = (sizeOffsets.size() > maxDirectDecodeBitLength_)
@@ -45,13 +60,11 @@ public:
             auto key = keys[keyIndex];
             auto currentSize = codes[key].bitsCount;
 
-            DirectDecodeData tableEntry{
-                key,
-                static_cast<uint8_t>(currentSize)};
+            wire::HuffmanTableEntry tableEntry(key, static_cast<uint8_t>(currentSize));
 
             auto decodeTableRepeats = 1U << (maxDirectDecodeBitLength_ - currentSize);
             for (size_t repeat = 0; repeat < decodeTableRepeats; ++repeat) {
-                decodeTable_.push_back(tableEntry);
+                tables->direct.push_back(tableEntry);
             }
         }
 
@@ -77,68 +90,219 @@ public:
                 auto currentMaxBits = maxBits[currentBaseOffset - minIndirectOffset];
                 if (currentBaseOffset != previousBaseOffset) {
                     previousBaseOffset = currentBaseOffset;
-                    indirectOffsetsTable_.push_back({
-                        indirectDecodeTable_.size(),
-                        static_cast<uint8_t>(currentMaxBits - maxDirectDecodeBitLength_)});
+                    tables->indirectOffsets.emplace_back(
+                        static_cast<uint32_t>(tables->indirect.size()),
+                        static_cast<uint8_t>(currentMaxBits - maxDirectDecodeBitLength_));
                 }
 
-                DirectDecodeData tableEntry{
+                wire::HuffmanTableEntry tableEntry(
                     key,
-                    static_cast<uint8_t>(currentCode.bitsCount - maxDirectDecodeBitLength_)};
+                    static_cast<uint8_t>(currentCode.bitsCount - maxDirectDecodeBitLength_));
 
                 for (size_t repeat = 0; repeat < 1U << (currentMaxBits - currentCode.bitsCount); ++repeat) {
-                    indirectDecodeTable_.push_back(tableEntry);
+                    tables->indirect.push_back(tableEntry);
                 }
             }
         }
+
+        decodeTable_ = tables->direct.data();
+        decodeTableSize_ = tables->direct.size();
+        indirectOffsetsTable_ = tables->indirectOffsets.data();
+        indirectDecodeTable_ = tables->indirect.data();
+        indirectDecodeTableSize_ = tables->indirect.size();
+        ownedTables_ = tables;
+
+        if (symbolsPerLookup > 1) {
+            createMultiSymbolTable(std::min(symbolsPerLookup, MAX_SYMBOLS_PER_LOOKUP));
+        }
     }
 
-    DecodeState decode(const uint8_t* source, size_t sourceSize) const
+    // Tables are used in place, so the serialized data has to outlive
+    // the decoder and its copies. No lookup may read past the tables
+    // or consume more bits than the longest code of the decoder they
+    // were built for, which keeps refills within the stream padding.
+    HuffmanTableDecoder(const wire::HuffmanDecodeTables* serialized, size_t maxCodeLength)
     {
-        return DecodeState{
-            BitStreamReader(source, source + sourceSize), maxDirectDecodeBitLength_};
+        auto direct = serialized->direct();
+        auto indirectOffsets = serialized->indirect_offsets();
+        auto indirect = serialized->indirect();
+        size_t tableBits = serialized->table_bits();
+        bool consistent = direct && indirectOffsets && indirect &&
+            tableBits > 0 && tableBits <= MAX_TABLE_BITS &&
+            maxCodeLength > 0 && maxCodeLength <= MAX_TABLE_BITS &&
+            direct->size() + indirectOffsets->size() == 1U << tableBits;
+
+        size_t maxDirectBits = std::min(tableBits, maxCodeLength);
+        for (size_t i = 0; consistent && i < direct->size(); ++i) {
+            auto bitsCount = direct->Get(i)->bits_count();
+            consistent = bitsCount > 0 && bitsCount <= maxDirectBits;
+        }
+
+        size_t maxIndirectBits = maxCodeLength > tableBits ? maxCodeLength - tableBits : 0;
+        for (size_t i = 0; consistent && i < indirectOffsets->size(); ++i) {
+            auto offset = indirectOffsets->Get(i);
+            consistent = offset->max_bits_count() <= maxIndirectBits &&
+                offset->offset() + (size_t(1) << offset->max_bits_count()) <= indirect->size();
+        }
+        for (size_t i = 0; consistent && i < indirect->size(); ++i) {
+            consistent = indirect->Get(i)->bits_count() <= maxIndirectBits;
+        }
+
+        if (!consistent) {
+            throw std::runtime_error("Serialized Huffman decode tables are inconsistent");
+        }
+
+        maxDirectDecodeBitLength_ = tableBits;
+        lookupsPerRefill_ = BitStreamReader::REFILL_BITS / maxCodeLength;
+        decodeTable_ = reinterpret_cast<const wire::HuffmanTableEntry*>(direct->Data());
+        decodeTableSize_ = direct->size();
+        indirectOffsetsTable_ = reinterpret_cast<const wire::HuffmanIndirectOffset*>(indirectOffsets->Data());
+        indirectDecodeTable_ = reinterpret_cast<const wire::HuffmanTableEntry*>(indirect->Data());
+        indirectDecodeTableSize_ = indirect->size();
     }
 
+    // Multi-symbol tables are not serialized
+    flatbuffers::Offset<wire::HuffmanDecodeTables> save(flatbuffers::FlatBufferBuilder& builder) const
+    {
+        return wire::CreateHuffmanDecodeTables(
+            builder,
+            maxDirectDecodeBitLength_,
+            builder.CreateVectorOfStructs(decodeTable_, decodeTableSize_),
+            builder.CreateVectorOfStructs(indirectOffsetsTable_, (1U << maxDirectDecodeBitLength_) - decodeTableSize_),
+            builder.CreateVectorOfStructs(indirectDecodeTable_, indirectDecodeTableSize_));
+    }
+
+    // Source must be followed by BitStreamReader::PADDING_BYTES readable bytes
+    DecodeState decode(const uint8_t* source) const
+    {
+        return DecodeState{BitStreamReader(source), 0};
+    }
+
+    bool hasMultiSymbolTable() const
+    {
+        return !multiSymbolTable_.empty();
+    }
+
+    // One refill covers several lookups, which keeps the load
+    // off the dependency chain of most of them
     uint8_t next(DecodeState& state) const
     {
-        size_t offset = state.reader.pull(state.bitsToPull) & decodeTableBitMask_;
+        refillIfNeeded(state);
+        return decodeSymbol(state);
+    }
 
-        if (offset < decodeTable_.size()) {
+    // Calls consume(index, key) for count symbols, emitting several
+    // symbols per lookup when the multi-symbol table is enabled
+    template <typename Consumer>
+    void decodeSymbols(DecodeState& state, size_t count, Consumer&& consume) const
+    {
+        size_t index = 0;
+        if (!multiSymbolTable_.empty()) {
+            while (index + MAX_SYMBOLS_PER_LOOKUP <= count) {
+                refillIfNeeded(state);
+                const auto& entry = multiSymbolTable_[state.reader.peek(maxDirectDecodeBitLength_)];
+                if (entry.symbolsCount == 0) {
+                    consume(index++, decodeSymbol(state));
+                    continue;
+                }
+
+                state.reader.consume(entry.bitsCount);
+                for (size_t i = 0; i < entry.symbolsCount; ++i) {
+                    consume(index + i, entry.keys[i]);
+                }
+                index += entry.symbolsCount;
+            }
+        }
+
+        for (; index < count; ++index) {
+            consume(index, next(state));
+        }
+    }
+
+private:
+    void refillIfNeeded(DecodeState& state) const
+    {
+        if (state.lookupsBeforeRefill == 0) {
+            state.reader.refill();
+            state.lookupsBeforeRefill = lookupsPerRefill_;
+        }
+        --state.lookupsBeforeRefill;
+    }
+
+    // Codes are at most 16 bits long, so they never exceed a refill
+    uint8_t decodeSymbol(DecodeState& state) const
+    {
+        size_t offset = state.reader.peek(maxDirectDecodeBitLength_);
+
+        if (offset < decodeTableSize_) {
             auto entry = decodeTable_[offset];
-            state.bitsToPull = entry.bitsCount;
-            return entry.key;
+            state.reader.consume(entry.bits_count());
+            return entry.key();
         } else {
-            auto indirectEntry = indirectOffsetsTable_[offset - decodeTable_.size()];
-            size_t bitMask = (1U << indirectEntry.maxBitsCount) - 1;
-            auto indirectKey = state.reader.pull(indirectEntry.maxBitsCount) & bitMask;
-            auto entry = indirectDecodeTable_[indirectEntry.offset + indirectKey];
-            state.bitsToPull = maxDirectDecodeBitLength_ - indirectEntry.maxBitsCount + entry.bitsCount;
-            return entry.key;
+            auto indirectEntry = indirectOffsetsTable_[offset - decodeTableSize_];
+            size_t bitMask = (1U << indirectEntry.max_bits_count()) - 1;
+            auto indirectKey = state.reader.peek(
+                maxDirectDecodeBitLength_ + indirectEntry.max_bits_count()) & bitMask;
+            auto entry = indirectDecodeTable_[indirectEntry.offset() + indirectKey];
+            state.reader.consume(maxDirectDecodeBitLength_ + entry.bits_count());
+            return entry.key();
+        }
+    }
+
+    // Windows starting with a long code get empty entries
+    // and are decoded one symbol at a time
+    void createMultiSymbolTable(size_t symbolsPerLookup)
+    {
+        size_t tableSize = 1U << maxDirectDecodeBitLength_;
+        multiSymbolTable_.resize(tableSize);
+
+        for (size_t window = 0; window < tableSize; ++window) {
+            auto& entry = multiSymbolTable_[window];
+            while (entry.symbolsCount < symbolsPerLookup) {
+                size_t offset = (window << entry.bitsCount) & (tableSize - 1);
+                if (offset >= decodeTableSize_ ||
+                        entry.bitsCount + decodeTable_[offset].bits_count() > maxDirectDecodeBitLength_) {
+                    break;
+                }
+                entry.keys[entry.symbolsCount++] = decodeTable_[offset].key();
+                entry.bitsCount += decodeTable_[offset].bits_count();
+            }
         }
     }
 
-private:
     uint16_t baseOffset(const std::unordered_map<uint8_t, PrefixCode>& codes, uint8_t key)
     {
         auto code = codes.at(key);
         return code.code >> (code.bitsCount - maxDirectDecodeBitLength_);
     }
     
-    struct DirectDecodeData {
-        uint8_t key;
-        uint8_t bitsCount;
+    struct MultiSymbolDecodeData {
+        std::array<uint8_t, MAX_SYMBOLS_PER_LOOKUP> keys;
+        uint8_t symbolsCount = 0;
+        uint8_t bitsCount = 0;
     };
 
-    struct IndirectDecodeData {
-        size_t offset;
-        uint8_t maxBitsCount;
+    struct Tables {
+        std::vector<wire::HuffmanTableEntry> direct;
+        std::vector<wire::HuffmanIndirectOffset> indirectOffsets;
+        std::vector<wire::HuffmanTableEntry> indirect;
     };
 
+    // Longest lookups that still fit into the 16-bit codes
+    static const size_t MAX_TABLE_BITS = 16;
+
     size_t maxDirectDecodeBitLength_;
-    uint64_t decodeTableBitMask_;
-    std::vector<DirectDecodeData> decodeTable_;
-    std::vector<IndirectDecodeData> indirectOffsetsTable_;
-    std::vector<DirectDecodeData> indirectDecodeTable_;
+    // Lookups that fit into BitStreamReader::REFILL_BITS in the worst case
+    size_t lookupsPerRefill_;
+    // Point either to ownedTables_ or to serialized tables, copies
+    // of the decoder share the tables
+    const wire::HuffmanTableEntry* decodeTable_;
+    size_t decodeTableSize_;
+    const wire::HuffmanIndirectOffset* indirectOffsetsTable_;
+    const wire::HuffmanTableEntry* indirectDecodeTable_;
+    size_t indirectDecodeTableSize_;
+    std::shared_ptr<const Tables> ownedTables_;
+    std::vector<MultiSymbolDecodeData> multiSymbolTable_;
 };
 
 }
@@ -0,0 +1,249 @@
+#include "ivf_index.h"
+#include "compression_strategy.h"
+
+#include <boost/format.hpp>
+
+#include <algorithm>
+#include <functional>
+#include <limits>
+#include <numeric>
+#include <random>
+
+namespace memb {
+
+namespace {
+
+const size_t KMEANS_ITERATIONS = 10;
+const size_t SAMPLE_VECTORS_PER_LIST = 64;
+const size_t ASSIGNMENT_JOB_SIZE = 256;
+
+uint32_t nearestCentroid(const float* vector, const float* centroids, size_t centroidsCount, size_t dim)
+{
+    uint32_t result = 0;
+    float bestDistance = std::numeric_limits<float>::max();
+
+    for (size_t centroid = 0; centroid < centroidsCount; ++centroid) {
+        const float* centroidValues = centroids + centroid * dim;
+        float distance = 0;
+        for (size_t i = 0; i < dim; ++i) {
+            float difference = vector[i] - centroidValues[i];
+            distance += difference * difference;
+        }
+
+        if (distance < bestDistance) {
+            bestDistance = distance;
+            result = centroid;
+        }
+    }
+
+    return result;
+}
+
+std::vector<uint32_t> assignVectors(
+    const float* vectors,
+    size_t vectorsCount,
+    const std::vector<float>& centroids,
+    size_t dim,
+    Executor* executor)
+{
+    std::vector<uint32_t> result(vectorsCount);
+    parallelFor(
+        executor,
+        vectorsCount,
+        ASSIGNMENT_JOB_SIZE,
+        [&](size_t begin, size_t end)
+        {
+            for (size_t i = begin; i < end; ++i) {
+                result[i] = nearestCentroid(vectors + i * dim, centroids.data(), centroids.size() / dim, dim);
+            }
+        });
+
+    return result;
+}
+
+} // namespace
+
+IvfIndexBuilder::IvfIndexBuilder(size_t dim, size_t listsCount):
+    dim_(dim),
+    listsCount_(listsCount)
+{}
+
+void IvfIndexBuilder::fit(const std::vector<float>& vectors, Executor* executor)
+{
+    size_t vectorsCount = vectors.size() / dim_;
+    size_t listsCount = std::min(listsCount_, vectorsCount);
+
+    std::vector<size_t> sampleIds(vectorsCount);
+    std::iota(sampleIds.begin(), sampleIds.end(), 0);
+    std::shuffle(sampleIds.begin(), sampleIds.end(), std::mt19937(42));
+    sampleIds.resize(std::min(vectorsCount, listsCount * SAMPLE_VECTORS_PER_LIST));
+
+    std::vector<float> sample;
+    sample.reserve(sampleIds.size() * dim_);
+    for (auto id : sampleIds) {
+        sample.insert(sample.end(), vectors.begin() + id * dim_, vectors.begin() + (id + 1) * dim_);
+    }
+
+    centroids_.assign(sample.begin(), sample.begin() + listsCount * dim_);
+    for (size_t iteration = 0; iteration < KMEANS_ITERATIONS; ++iteration) {
+        auto assignments = assignVectors(sample.data(), sampleIds.size(), centroids_, dim_, executor);
+
+        std::vector<float> sums(centroids_.size(), 0.0f);
+        std::vector<size_t> counts(listsCount, 0);
+        for (size_t i = 0; i < assignments.size(); ++i) {
+            ++counts[assignments[i]];
+            for (size_t j = 0; j < dim_; ++j) {
+                sums[assignments[i] * dim_ + j] += sample[i * dim_ + j];
+            }
+        }
+
+        // Empty clusters keep their previous centroids
+        for (size_t list = 0; list < listsCount; ++list) {
+            if (counts[list] > 0) {
+                for (size_t j = 0; j < dim_; ++j) {
+                    centroids_[list * dim_ + j] = sums[list * dim_ + j] / counts[list];
+                }
+            }
+        }
+    }
+
+    auto assignments = assignVectors(vectors.data(), vectorsCount, centroids_, dim_, executor);
+
+    listOffsets_.assign(listsCount + 1, 0);
+    for (auto list : assignments) {
+        ++listOffsets_[list + 1];
+    }
+    std::partial_sum(listOffsets_.begin(), listOffsets_.end(), listOffsets_.begin());
+
+    wordIds_.resize(vectorsCount);
+    auto positions = listOffsets_;
+    for (size_t wordId = 0; wordId < vectorsCount; ++wordId) {
+        wordIds_[positions[assignments[wordId]]++] = wordId;
+    }
+}
+
+flatbuffers::Offset<wire::IvfIndex> IvfIndexBuilder::save(flatbuffers::FlatBufferBuilder& builder) const
+{
+    return wire::CreateIvfIndex(
+        builder,
+        builder.CreateVector(centroids_),
+        builder.CreateVector(listOffsets_),
+        builder.CreateVector(wordIds_));
+}
+
+IvfIndex::IvfIndex(const wire::IvfIndex* flatIndex, size_t dim, size_t vocabularySize):
+    flatIndex_(flatIndex),
+    dim_(dim)
+{
+    auto listOffsets = flatIndex_->list_offsets();
+    auto wordIds = flatIndex_->word_ids();
+    auto centroids = flatIndex_->centroids();
+    if (!listOffsets || listOffsets->size() == 0 || !wordIds || !centroids) {
+        throw std::runtime_error("Nearest neighbour index is incomplete");
+    }
+
+    for (size_t list = 0; list < listsCount(); ++list) {
+        if (listOffsets->Get(list) > listOffsets->Get(list + 1)) {
+            throw std::runtime_error("Nearest neighbour index lists are not ordered");
+        }
+    }
+    if (listOffsets->Get(0) != 0 || listOffsets->Get(listsCount()) != wordIds->size()) {
+        throw std::runtime_error(boost::str(
+            boost::format("Nearest neighbour index lists do not cover its %1% word ids") % wordIds->size()));
+    }
+
+    for (auto wordId : *wordIds) {
+        if (wordId >= vocabularySize) {
+            throw std::runtime_error(boost::str(
+                boost::format("Word id %1% of nearest neighbour index is out of range, vocabulary size is %2%") %
+                    wordId % vocabularySize));
+        }
+    }
+
+    if (centroids->size() != listsCount() * dim_) {
+        throw std::runtime_error(boost::str(
+            boost::format("%1% centroid values do not match %2% lists of %3% dimensions") %
+                centroids->size() % listsCount() % dim_));
+    }
+    for (size_t list = 0; list < listsCount(); ++list) {
+        const float* centroid = centroids->data() + list * dim_;
+        centroidSquaredNorms_.push_back(std::inner_product(centroid, centroid + dim_, centroid, 0.0f));
+    }
+}
+
+size_t IvfIndex::listsCount() const
+{
+    return flatIndex_->list_offsets()->size() - 1;
+}
+
+std::vector<std::vector<Neighbour>> IvfIndex::findMostSimilar(
+    const CompressedStorage& storage,
+    Executor* executor,
+    const float* queries,
+    size_t queriesCount,
+    size_t k,
+    size_t nprobe,
+    SimilarityMetric metric) const
+{
+    auto preparedQueries = prepareQueries(queries, queriesCount, dim_, metric);
+    auto listOffsets = flatIndex_->list_offsets();
+    auto wordIds = flatIndex_->word_ids()->data();
+
+    std::vector<std::vector<Neighbour>> result(queriesCount);
+    parallelFor(
+        executor,
+        queriesCount,
+        1,
+        [&](size_t beginQuery, size_t endQuery)
+        {
+            std::vector<float> scores;
+            for (size_t query = beginQuery; query < endQuery; ++query) {
+                const float* queryValues = preparedQueries.data() + query * dim_;
+                auto scoringQuery = storage.prepareScoring(queryValues, 1, dim_);
+                TopK topK(k);
+
+                for (auto list : nearestLists(queryValues, nprobe, metric)) {
+                    size_t listBegin = listOffsets->Get(list);
+                    size_t listSize = listOffsets->Get(list + 1) - listBegin;
+                    scores.resize(listSize);
+                    storage.scoreBatch(scoringQuery, metric, wordIds + listBegin, listSize, scores.data());
+
+                    topK.pushBatch(wordIds + listBegin, scores.data(), listSize);
+                }
+
+                result[query] = topK.result(metric);
+            }
+        });
+
+    return result;
+}
+
+std::vector<uint32_t> IvfIndex::nearestLists(const float* query, size_t nprobe, SimilarityMetric metric) const
+{
+    auto centroids = flatIndex_->centroids()->data();
+    float querySquaredNorm = std::inner_product(query, query + dim_, query, 0.0f);
+
+    std::vector<std::pair<float, uint32_t>> listScores;
+    for (size_t list = 0; list < listsCount(); ++list) {
+        const float* centroid = centroids + list * dim_;
+        float dot = std::inner_product(query, query + dim_, centroid, 0.0f);
+        listScores.emplace_back(
+            similarityScore(metric, dot, querySquaredNorm, centroidSquaredNorms_[list]), list);
+    }
+
+    nprobe = std::min(nprobe, listScores.size());
+    std::partial_sort(
+        listScores.begin(),
+        listScores.begin() + nprobe,
+        listScores.end(),
+        std::greater<std::pair<float, uint32_t>>());
+
+    std::vector<uint32_t> result;
+    for (size_t i = 0; i < nprobe; ++i) {
+        result.push_back(listScores[i].second);
+    }
+
+    return result;
+}
+
+}
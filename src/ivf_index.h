@@ -0,0 +1,58 @@
+#pragma once
+
+#include "ivf_index_generated.h"
+#include "similarity.h"
+
+#include <vector>
+
+namespace memb {
+
+class CompressedStorage;
+
+// Clusters vectors with k-means and stores word ids of every cluster
+// as a separate list, so queries only have to scan a few lists
+class IvfIndexBuilder {
+public:
+    IvfIndexBuilder(size_t dim, size_t listsCount);
+
+    // Vectors are stored row by row in the order of word ids
+    void fit(const std::vector<float>& vectors, Executor* executor);
+
+    flatbuffers::Offset<wire::IvfIndex> save(flatbuffers::FlatBufferBuilder& builder) const;
+
+private:
+    size_t dim_;
+    size_t listsCount_;
+    std::vector<float> centroids_;
+    std::vector<uint32_t> listOffsets_;
+    std::vector<uint32_t> wordIds_;
+};
+
+class IvfIndex {
+public:
+    // Lists are scanned without bound checks,
+    // so indexes that do not fit the vocabulary are rejected here
+    IvfIndex(const wire::IvfIndex* flatIndex, size_t dim, size_t vocabularySize);
+
+    size_t listsCount() const;
+
+    // Scans nprobe lists with centroids most similar to every query,
+    // nprobe equal to listsCount() gives exact results
+    std::vector<std::vector<Neighbour>> findMostSimilar(
+        const CompressedStorage& storage,
+        Executor* executor,
+        const float* queries,
+        size_t queriesCount,
+        size_t k,
+        size_t nprobe,
+        SimilarityMetric metric) const;
+
+private:
+    std::vector<uint32_t> nearestLists(const float* query, size_t nprobe, SimilarityMetric metric) const;
+
+    const wire::IvfIndex* flatIndex_;
+    size_t dim_;
+    std::vector<float> centroidSquaredNorms_;
+};
+
+}
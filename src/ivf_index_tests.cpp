@@ -0,0 +1,153 @@
+#include "ivf_index.h"
+#include "reader.h"
+#include "test_utils.h"
+
+#include <boost/test/unit_test.hpp>
+
+#include <random>
+#include <unordered_set>
+
+using namespace memb;
+
+namespace {
+
+const std::string IVF_MODEL_FILENAME = temporaryPath("ivf.bin");
+const size_t CLUSTERS_COUNT = 20;
+const size_t WORDS_COUNT = 2000;
+const size_t LISTS_COUNT = 16;
+const size_t DIM = 16;
+const size_t K = 10;
+
+// Points scattered around random centers, so the index has a structure to find
+std::vector<float> clusteredVectors(size_t count, std::mt19937& generator)
+{
+    std::normal_distribution<float> distribution;
+    std::vector<float> centers(CLUSTERS_COUNT * DIM);
+    for (auto& value : centers) {
+        value = 4 * distribution(generator);
+    }
+
+    std::vector<float> result(count * DIM);
+    for (size_t i = 0; i < count; ++i) {
+        size_t cluster = generator() % CLUSTERS_COUNT;
+        for (size_t j = 0; j < DIM; ++j) {
+            result[i * DIM + j] = centers[cluster * DIM + j] + distribution(generator);
+        }
+    }
+
+    return result;
+}
+
+void buildIndexedModel(const std::vector<float>& vectors, size_t listsCount)
+{
+    CompressionOptions options;
+    options.ivfListsCount = listsCount;
+
+    Builder builder(DIM, "trained", 8, options);
+    for (size_t i = 0; i < vectors.size() / DIM; ++i) {
+        builder.addWord(
+            "word" + std::to_string(i),
+            std::vector<float>(vectors.begin() + i * DIM, vectors.begin() + (i + 1) * DIM));
+    }
+    builder.save(IVF_MODEL_FILENAME);
+}
+
+} // namespace
+
+BOOST_AUTO_TEST_SUITE(ivfIndex)
+
+BOOST_AUTO_TEST_CASE(probingAllListsIsExact)
+{
+    std::mt19937 generator(42);
+    buildIndexedModel(clusteredVectors(WORDS_COUNT, generator), LISTS_COUNT);
+    auto queries = clusteredVectors(5, generator);
+
+    Reader reader(IVF_MODEL_FILENAME, 4);
+    BOOST_REQUIRE(reader.hasAnnIndex());
+
+    for (auto metric : {SimilarityMetric::Dot, SimilarityMetric::Cosine, SimilarityMetric::L2}) {
+        auto expected = reader.batchMostSimilar(queries.data(), 5, K, metric);
+        auto neighbours = reader.batchApproximateMostSimilar(queries.data(), 5, K, LISTS_COUNT, metric);
+        BOOST_REQUIRE(neighbours.size() == 5);
+
+        for (size_t query = 0; query < 5; ++query) {
+            BOOST_REQUIRE(neighbours[query].size() == K);
+            for (size_t i = 0; i < K; ++i) {
+                BOOST_CHECK_EQUAL(neighbours[query][i].wordId, expected[query][i].wordId);
+                BOOST_CHECK_CLOSE_FRACTION(neighbours[query][i].score, expected[query][i].score, 1e-5);
+            }
+        }
+    }
+}
+
+BOOST_AUTO_TEST_CASE(fewProbesGiveGoodRecall)
+{
+    std::mt19937 generator(43);
+    buildIndexedModel(clusteredVectors(WORDS_COUNT, generator), LISTS_COUNT);
+    auto queries = clusteredVectors(20, generator);
+
+    Reader reader(IVF_MODEL_FILENAME, 1);
+    auto expected = reader.batchMostSimilar(queries.data(), 20, K, SimilarityMetric::L2);
+    auto neighbours = reader.batchApproximateMostSimilar(queries.data(), 20, K, 3, SimilarityMetric::L2);
+
+    size_t found = 0;
+    for (size_t query = 0; query < 20; ++query) {
+        std::unordered_set<int64_t> expectedIds;
+        for (const auto& neighbour : expected[query]) {
+            expectedIds.insert(neighbour.wordId);
+        }
+        for (const auto& neighbour : neighbours[query]) {
+            found += expectedIds.count(neighbour.wordId);
+        }
+    }
+
+    BOOST_CHECK_GE(found, 20 * K * 9 / 10);
+}
+
+BOOST_AUTO_TEST_CASE(listsAreLimitedByVocabularySize)
+{
+    std::mt19937 generator(44);
+    buildIndexedModel(clusteredVectors(5, generator), LISTS_COUNT);
+
+    Reader reader(IVF_MODEL_FILENAME, 1);
+    auto query = reader.embeddingById(2);
+    auto neighbours = reader.approximateMostSimilar(query.data(), K, LISTS_COUNT, SimilarityMetric::L2);
+    BOOST_REQUIRE(neighbours.size() == 5);
+    BOOST_CHECK_EQUAL(neighbours.front().wordId, 2);
+}
+
+BOOST_AUTO_TEST_CASE(missingIndexThrows)
+{
+    std::mt19937 generator(45);
+    buildIndexedModel(clusteredVectors(100, generator), 0);
+
+    Reader reader(IVF_MODEL_FILENAME, 1);
+    BOOST_CHECK(!reader.hasAnnIndex());
+
+    auto query = reader.embeddingById(0);
+    BOOST_CHECK_THROW(reader.approximateMostSimilar(query.data(), K, 1), std::runtime_error);
+}
+
+BOOST_AUTO_TEST_CASE(malformedIndexThrows)
+{
+    auto checkIndex = [](std::vector<uint32_t> listOffsets, std::vector<uint32_t> wordIds)
+    {
+        flatbuffers::FlatBufferBuilder builder;
+        auto centroids = std::vector<float>(listOffsets.empty() ? 0 : listOffsets.size() - 1, 1.0f);
+        builder.Finish(wire::CreateIvfIndex(
+            builder,
+            builder.CreateVector(centroids),
+            builder.CreateVector(listOffsets),
+            builder.CreateVector(wordIds)));
+
+        IvfIndex(flatbuffers::GetRoot<wire::IvfIndex>(builder.GetBufferPointer()), 1, 3);
+    };
+
+    checkIndex({0, 1, 3}, {2, 0, 1});
+    BOOST_CHECK_THROW(checkIndex({}, {}), std::runtime_error);
+    BOOST_CHECK_THROW(checkIndex({0, 2, 1}, {0, 1}), std::runtime_error);
+    BOOST_CHECK_THROW(checkIndex({0, 1}, {0, 1}), std::runtime_error);
+    BOOST_CHECK_THROW(checkIndex({0, 2}, {0, 3}), std::runtime_error);
+}
+
+BOOST_AUTO_TEST_SUITE_END()
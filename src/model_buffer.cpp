@@ -0,0 +1,101 @@
+#include "model_buffer.h"
+
+#include <boost/format.hpp>
+#include <boost/iostreams/device/mapped_file.hpp>
+
+#include <cerrno>
+#include <cstdint>
+#include <cstring>
+#include <stdexcept>
+
+#ifndef _WIN32
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+namespace memb {
+
+namespace {
+
+std::runtime_error systemError(const std::string& operation)
+{
+    return std::runtime_error(boost::str(
+        boost::format("%1% failed: %2%") % operation % std::strerror(errno)));
+}
+
+} // namespace
+
+ModelBuffer::ModelBuffer(const void* data, size_t size, std::shared_ptr<const void> owner):
+    data_(static_cast<const char*>(data)),
+    size_(size),
+    owner_(std::move(owner))
+{}
+
+ModelBuffer ModelBuffer::fromFile(const std::string& filename)
+{
+    auto mappedFile = std::make_shared<boost::iostreams::mapped_file_source>(filename);
+
+    return ModelBuffer(mappedFile->data(), mappedFile->size(), mappedFile);
+}
+
+ModelBuffer ModelBuffer::fromMemory(const void* data, size_t size, std::shared_ptr<const void> owner)
+{
+    return ModelBuffer(data, size, std::move(owner));
+}
+
+ModelBuffer ModelBuffer::fromFileDescriptor(int fd, size_t offset, size_t size)
+{
+#ifndef _WIN32
+    struct stat fileStat;
+    if (fstat(fd, &fileStat) != 0) {
+        throw systemError("fstat");
+    }
+    size_t fileSize = fileStat.st_size;
+    if (fileSize <= offset) {
+        throw std::runtime_error(boost::str(
+            boost::format("Offset %1% is beyond the end of file of size %2%") % offset % fileSize));
+    }
+
+    // Pages past the end of file cannot be read from the mapping
+    if (size == 0) {
+        size = fileSize - offset;
+    } else if (size > fileSize - offset) {
+        throw std::runtime_error(boost::str(
+            boost::format("Range of %1% bytes at offset %2% is beyond the end of file of size %3%") %
+                size % offset % fileSize));
+    }
+
+    // mmap offsets have to be page aligned
+    size_t alignedOffset = offset & ~(static_cast<size_t>(sysconf(_SC_PAGESIZE)) - 1);
+    size_t mappedSize = size + offset - alignedOffset;
+
+    void* mapping = mmap(nullptr, mappedSize, PROT_READ, MAP_SHARED, fd, alignedOffset);
+    if (mapping == MAP_FAILED) {
+        throw systemError("mmap");
+    }
+
+    std::shared_ptr<const void> owner(
+        mapping,
+        [mappedSize](const void* data)
+        {
+            munmap(const_cast<void*>(data), mappedSize);
+        });
+
+    return ModelBuffer(static_cast<const char*>(mapping) + offset - alignedOffset, size, std::move(owner));
+#else
+    throw std::runtime_error("Reading models from file descriptors is not supported on this platform");
+#endif
+}
+
+const char* ModelBuffer::data() const
+{
+    return data_;
+}
+
+size_t ModelBuffer::size() const
+{
+    return size_;
+}
+
+}
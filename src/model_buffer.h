@@ -0,0 +1,38 @@
+#pragma once
+
+#include <cstddef>
+#include <memory>
+#include <string>
+
+namespace memb {
+
+// Bytes of a serialized model. The memory is either mapped by the buffer
+// itself or borrowed from the caller, copies share the same memory.
+class ModelBuffer {
+public:
+    static ModelBuffer fromFile(const std::string& filename);
+
+    // The memory must stay valid while the buffer or readers created from it
+    // are alive, either by caller's discipline or through the owner
+    static ModelBuffer fromMemory(
+        const void* data,
+        size_t size,
+        std::shared_ptr<const void> owner = nullptr);
+
+    // Maps size bytes starting at offset, zero size means up to the end of
+    // the file, and ranges past the end are rejected. Works for memfd and any
+    // other mappable descriptor, which can be closed once the buffer is created.
+    static ModelBuffer fromFileDescriptor(int fd, size_t offset = 0, size_t size = 0);
+
+    const char* data() const;
+    size_t size() const;
+
+private:
+    ModelBuffer(const void* data, size_t size, std::shared_ptr<const void> owner);
+
+    const char* data_;
+    size_t size_;
+    std::shared_ptr<const void> owner_;
+};
+
+}
@@ -0,0 +1,192 @@
+#include "packed_compression.h"
+#include "bit_stream.h"
+#include "bit_stream_reader.h"
+
+#include <boost/format.hpp>
+
+#include <algorithm>
+#include <stdexcept>
+
+namespace memb {
+
+namespace {
+
+const size_t MAX_BITS_PER_CODE = 8;
+// Groups of that many codes take whole bytes for any code width
+const size_t CODES_PER_GROUP = 8;
+
+size_t clampBitsPerCode(size_t bitsPerWeight)
+{
+    return std::min(MAX_BITS_PER_CODE, std::max<size_t>(1, bitsPerWeight));
+}
+
+// Code width is a template argument, so shifts and masks are constants and
+// the loop over a whole group is unrolled into straight-line code. Only the
+// first and the last group of a range check bounds.
+template <size_t Bits, typename Consumer>
+void unpackCodes(const uint8_t* data, size_t begin, size_t end, Consumer&& consume)
+{
+    const uint64_t mask = (uint64_t(1) << Bits) - 1;
+
+    for (size_t groupBegin = begin / CODES_PER_GROUP * CODES_PER_GROUP; groupBegin < end;
+            groupBegin += CODES_PER_GROUP) {
+        uint64_t group = loadBigEndian64(data + groupBegin / CODES_PER_GROUP * Bits);
+        if (groupBegin >= begin && groupBegin + CODES_PER_GROUP <= end) {
+            for (size_t i = 0; i < CODES_PER_GROUP; ++i) {
+                consume(groupBegin + i, static_cast<uint8_t>((group >> (64 - (i + 1) * Bits)) & mask));
+            }
+        } else {
+            for (size_t i = 0; i < CODES_PER_GROUP; ++i) {
+                if (groupBegin + i >= begin && groupBegin + i < end) {
+                    consume(groupBegin + i, static_cast<uint8_t>((group >> (64 - (i + 1) * Bits)) & mask));
+                }
+            }
+        }
+    }
+}
+
+} // namespace
+
+PackedCompressor::PackedCompressor(
+        flatbuffers::FlatBufferBuilder& builder,
+        size_t bitsPerWeight,
+        const CompressionOptions& options):
+    CentroidCompressor(builder, clampBitsPerCode(bitsPerWeight), options),
+    bitsPerCode_(clampBitsPerCode(bitsPerWeight))
+{}
+
+void PackedCompressor::fitCoder(const std::vector<std::vector<uint8_t>>&)
+{}
+
+std::vector<uint8_t> PackedCompressor::encodeCodes(const std::vector<uint8_t>& codes) const
+{
+    BitStream bitStream;
+    for (auto code : codes) {
+        bitStream.push({code, bitsPerCode_});
+    }
+
+    return bitStream.data();
+}
+
+flatbuffers::Offset<void> PackedCompressor::createStorage(const StorageParts& parts)
+{
+    return wire::CreatePacked(
+        builder_,
+        parts.wordOffsets,
+        parts.valueOffsets,
+        parts.packedWords,
+        parts.packedValues,
+        bitsPerCode_,
+        parts.clusterizer,
+        parts.perfectHash,
+        parts.searchTree,
+        parts.squaredNorms
+    ).Union();
+}
+
+PackedCompressedStorage::PackedCompressedStorage(const void* flatStorage, size_t dim):
+    CentroidCompressedStorage(static_cast<const wire::Packed*>(flatStorage), dim, true),
+    flatStorage_(static_cast<const wire::Packed*>(flatStorage))
+{
+    size_t bitsPerCode = flatStorage_->bits_per_code();
+    if (bitsPerCode == 0 || bitsPerCode > MAX_BITS_PER_CODE) {
+        throw std::runtime_error(boost::str(boost::format(
+            "Packed storage codes must take 1 to %1% bits, got %2%") % MAX_BITS_PER_CODE % bitsPerCode));
+    }
+}
+
+template <typename Consumer>
+void PackedCompressedStorage::decodeVector(
+    size_t wordId, size_t begin, size_t end, Consumer&& consume) const
+{
+    const uint8_t* data = packedValues(wordId);
+
+    switch (flatStorage_->bits_per_code()) {
+    case 1:
+        unpackCodes<1>(data, begin, end, consume);
+        break;
+    case 2:
+        unpackCodes<2>(data, begin, end, consume);
+        break;
+    case 3:
+        unpackCodes<3>(data, begin, end, consume);
+        break;
+    case 4:
+        unpackCodes<4>(data, begin, end, consume);
+        break;
+    case 5:
+        unpackCodes<5>(data, begin, end, consume);
+        break;
+    case 6:
+        unpackCodes<6>(data, begin, end, consume);
+        break;
+    case 7:
+        unpackCodes<7>(data, begin, end, consume);
+        break;
+    case 8:
+        unpackCodes<8>(data, begin, end, consume);
+        break;
+    }
+}
+
+void PackedCompressedStorage::extractById(size_t wordId, float* destination) const
+{
+    extractRangeById(wordId, dim_, 0, dim_, destination);
+}
+
+void PackedCompressedStorage::extractRangeById(
+    size_t wordId, size_t, size_t begin, size_t end, float* destination) const
+{
+    const float* centroids = centroids_;
+    decodeVector(
+        wordId,
+        begin,
+        end,
+        [centroids, begin, destination](size_t index, uint8_t code)
+        {
+            destination[index - begin] = centroids[code];
+        });
+}
+
+void PackedCompressedStorage::decodeCodes(size_t wordId, uint8_t* codes) const
+{
+    decodeVector(
+        wordId,
+        0,
+        dim_,
+        [codes](size_t index, uint8_t code)
+        {
+            codes[index] = code;
+        });
+}
+
+std::vector<MemoryRange> PackedCompressedStorage::memoryRanges() const
+{
+    return commonMemoryRanges(flatStorage_);
+}
+
+std::shared_ptr<Compressor> PackedCompressionStrategy::createCompressor(
+    flatbuffers::FlatBufferBuilder& builder,
+    size_t bitsPerWeight,
+    const CompressionOptions& options) const
+{
+    return std::make_shared<PackedCompressor>(builder, bitsPerWeight, options);
+}
+
+std::shared_ptr<CompressedStorage> PackedCompressionStrategy::createCompressedStorage(
+    const void* flatStorage, size_t dim, const DecodingOptions& /*options*/) const
+{
+    return std::make_shared<PackedCompressedStorage>(flatStorage, dim);
+}
+
+std::string PackedCompressionStrategy::storageName() const
+{
+    return "packed";
+}
+
+wire::Storage PackedCompressionStrategy::storageType() const
+{
+    return wire::Storage_Packed;
+}
+
+}
@@ -0,0 +1,60 @@
+#pragma once
+
+#include "centroid_compression.h"
+
+namespace memb {
+
+// Same quantization as trained storage, with every code stored in a fixed
+// number of bits. Files are larger, but decoding has no data-dependent
+// branches and any dimension range is addressed directly.
+class PackedCompressedStorage : public CentroidCompressedStorage {
+public:
+    PackedCompressedStorage(const void* flatStorage, size_t dim);
+    virtual void extractById(size_t wordId, float* destination) const override;
+    virtual void extractRangeById(
+        size_t wordId, size_t dim, size_t begin, size_t end, float* destination) const override;
+    virtual std::vector<MemoryRange> memoryRanges() const override;
+
+protected:
+    virtual void decodeCodes(size_t wordId, uint8_t* codes) const override;
+
+private:
+    // Calls consume(index, code) for codes in [begin, end)
+    template <typename Consumer>
+    void decodeVector(size_t wordId, size_t begin, size_t end, Consumer&& consume) const;
+
+    const wire::Packed* flatStorage_;
+};
+
+class PackedCompressor : public CentroidCompressor {
+public:
+    PackedCompressor(
+        flatbuffers::FlatBufferBuilder& builder,
+        size_t bitsPerWeight,
+        const CompressionOptions& options);
+
+protected:
+    virtual void fitCoder(const std::vector<std::vector<uint8_t>>& codes) override;
+    virtual std::vector<uint8_t> encodeCodes(const std::vector<uint8_t>& codes) const override;
+    virtual flatbuffers::Offset<void> createStorage(const StorageParts& parts) override;
+
+private:
+    size_t bitsPerCode_;
+};
+
+class PackedCompressionStrategy : public CompressionStrategy {
+public:
+    virtual std::shared_ptr<Compressor> createCompressor(
+        flatbuffers::FlatBufferBuilder& builder,
+        size_t bitsPerWeight,
+        const CompressionOptions& options) const override;
+
+    virtual std::shared_ptr<CompressedStorage> createCompressedStorage(
+        const void* flatStorage, size_t dim, const DecodingOptions& options) const override;
+
+    virtual std::string storageName() const override;
+
+    virtual wire::Storage storageType() const override;
+};
+
+}
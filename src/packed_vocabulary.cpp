@@ -0,0 +1,114 @@
+#include "packed_vocabulary.h"
+
+#include <algorithm>
+#include <cstring>
+
+namespace memb {
+
+const int64_t PackedVocabulary::MISSING_WORD;
+
+PackedVocabulary::PackedVocabulary(
+        const flatbuffers::Vector<uint32_t>* wordOffsets,
+        const flatbuffers::String* packedWords,
+        const wire::PerfectHashIndex* perfectHash,
+        const flatbuffers::Vector<const wire::SearchTreeNode*>* searchTree):
+    wordOffsets_(wordOffsets),
+    packedWords_(packedWords->c_str()),
+    perfectHash_(perfectHash ? std::make_shared<PerfectHashIndex>(perfectHash) : nullptr),
+    searchTree_(searchTree ? std::make_shared<SearchTree>(searchTree, wordOffsets, packedWords_) : nullptr)
+{}
+
+int64_t PackedVocabulary::find(const std::string& word) const
+{
+    if (!perfectHash_) {
+        return searchTree_ ? searchTree_->find(word) : binarySearch(word);
+    }
+
+    auto candidate = perfectHash_->candidate(word.c_str(), word.size());
+    if (candidate != PerfectHashIndex::MISSING_WORD && strcmp(this->word(candidate), word.c_str()) == 0) {
+        return candidate;
+    }
+
+    return MISSING_WORD;
+}
+
+std::vector<int64_t> PackedVocabulary::findSorted(const std::vector<const std::string*>& words) const
+{
+    std::vector<int64_t> result;
+    result.reserve(words.size());
+
+    if (perfectHash_) {
+        for (auto word : words) {
+            result.push_back(find(*word));
+        }
+        return result;
+    }
+
+    size_t begin = 0;
+    for (auto word : words) {
+        begin = lowerBound(*word, begin);
+        if (begin < size() && strcmp(this->word(begin), word->c_str()) == 0) {
+            result.push_back(begin);
+        } else {
+            result.push_back(MISSING_WORD);
+        }
+    }
+
+    return result;
+}
+
+size_t PackedVocabulary::size() const
+{
+    return wordOffsets_->size();
+}
+
+const char* PackedVocabulary::word(size_t id) const
+{
+    return packedWords_ + wordOffsets_->Get(id);
+}
+
+size_t PackedVocabulary::lowerBound(const std::string& word, size_t begin) const
+{
+    size_t low = begin;
+    size_t high = begin;
+    size_t step = 1;
+    while (high < size() && strcmp(this->word(high), word.c_str()) < 0) {
+        low = high + 1;
+        high = begin + step;
+        step *= 2;
+    }
+    high = std::min(high, size());
+
+    auto wordData = packedWords_;
+    auto resultIt = std::lower_bound(
+        wordOffsets_->begin() + low,
+        wordOffsets_->begin() + high,
+        word.c_str(),
+        [wordData](uint32_t offset, const char* word)
+        {
+            return strcmp(wordData + offset, word) < 0;
+        });
+
+    return resultIt - wordOffsets_->begin();
+}
+
+int64_t PackedVocabulary::binarySearch(const std::string& word) const
+{
+    auto wordData = packedWords_;
+    auto resultIt = std::lower_bound(
+        wordOffsets_->begin(),
+        wordOffsets_->end(),
+        word.c_str(),
+        [wordData](uint32_t offset, const char* word)
+        {
+            return strcmp(wordData + offset, word) < 0;
+        });
+
+    if (resultIt != wordOffsets_->end() && strcmp(wordData + *resultIt, word.c_str()) == 0) {
+        return resultIt - wordOffsets_->begin();
+    }
+
+    return MISSING_WORD;
+}
+
+}
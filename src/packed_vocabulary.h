@@ -0,0 +1,39 @@
+#pragma once
+
+#include "perfect_hash.h"
+#include "search_tree.h"
+
+#include <memory>
+
+namespace memb {
+
+class PackedVocabulary {
+public:
+    static const int64_t MISSING_WORD = -1;
+
+    PackedVocabulary(
+        const flatbuffers::Vector<uint32_t>* wordOffsets,
+        const flatbuffers::String* packedWords,
+        const wire::PerfectHashIndex* perfectHash,
+        const flatbuffers::Vector<const wire::SearchTreeNode*>* searchTree);
+
+    int64_t find(const std::string& word) const;
+
+    // Resolves words sorted in ascending order. Without perfect hash index
+    // they are found in a single monotone pass over the vocabulary.
+    std::vector<int64_t> findSorted(const std::vector<const std::string*>& words) const;
+
+    size_t size() const;
+    const char* word(size_t id) const;
+
+private:
+    int64_t binarySearch(const std::string& word) const;
+    size_t lowerBound(const std::string& word, size_t begin) const;
+
+    const flatbuffers::Vector<uint32_t>* wordOffsets_;
+    const char* packedWords_;
+    std::shared_ptr<PerfectHashIndex> perfectHash_;
+    std::shared_ptr<SearchTree> searchTree_;
+};
+
+}
@@ -0,0 +1,82 @@
+#include "packed_vocabulary.h"
+#include "trained_compression_generated.h"
+
+#include <boost/test/unit_test.hpp>
+
+using namespace memb;
+
+namespace {
+
+const std::vector<std::string> SORTED_WORDS = {
+    "a", "abc", "abcdefg", "abcdefgh", "abcdefghi", "abcdefghij", "abcdefgz", "b", "longer than prefix"};
+
+const std::vector<std::string> MISSING_WORDS = {
+    "", "ab", "abcdefgha", "abcdefgi", "c", "longer than prefiz", "0"};
+
+void packedVocabularyTestImpl(bool perfectHashIndex, bool searchTree)
+{
+    std::string packedWords;
+    std::vector<uint32_t> wordOffsets;
+    for (const auto& word : SORTED_WORDS) {
+        wordOffsets.push_back(packedWords.size());
+        packedWords.insert(packedWords.size(), word.c_str(), word.size() + 1);
+    }
+
+    flatbuffers::FlatBufferBuilder builder;
+    auto flatWordOffsets = builder.CreateVector(wordOffsets);
+    auto flatPackedWords = builder.CreateString(packedWords);
+    auto flatPerfectHash = perfectHashIndex
+        ? PerfectHashIndexBuilder(SORTED_WORDS).save(builder)
+        : flatbuffers::Offset<wire::PerfectHashIndex>();
+    auto flatSearchTree = searchTree
+        ? SearchTreeBuilder(SORTED_WORDS).save(builder)
+        : flatbuffers::Offset<flatbuffers::Vector<const wire::SearchTreeNode*>>();
+    builder.Finish(wire::CreateTrained(
+        builder,
+        flatWordOffsets,
+        0,
+        flatPackedWords,
+        0,
+        0,
+        0,
+        flatPerfectHash,
+        flatSearchTree));
+
+    auto trained = flatbuffers::GetRoot<wire::Trained>(builder.GetBufferPointer());
+    PackedVocabulary vocabulary(
+        trained->word_offsets(),
+        trained->packed_words(),
+        trained->perfect_hash(),
+        trained->search_tree());
+
+    BOOST_REQUIRE_EQUAL(vocabulary.size(), SORTED_WORDS.size());
+    for (size_t i = 0; i < SORTED_WORDS.size(); ++i) {
+        BOOST_CHECK_EQUAL(vocabulary.find(SORTED_WORDS[i]), i);
+        BOOST_CHECK_EQUAL(vocabulary.word(i), SORTED_WORDS[i]);
+    }
+
+    for (const auto& missingWord : MISSING_WORDS) {
+        BOOST_CHECK_EQUAL(vocabulary.find(missingWord), PackedVocabulary::MISSING_WORD);
+    }
+}
+
+} // namespace
+
+BOOST_AUTO_TEST_SUITE(packedVocabulary)
+
+BOOST_AUTO_TEST_CASE(binarySearchWorks)
+{
+    packedVocabularyTestImpl(false, false);
+}
+
+BOOST_AUTO_TEST_CASE(searchTreeWorks)
+{
+    packedVocabularyTestImpl(false, true);
+}
+
+BOOST_AUTO_TEST_CASE(perfectHashLookupWorks)
+{
+    packedVocabularyTestImpl(true, false);
+}
+
+BOOST_AUTO_TEST_SUITE_END()
@@ -0,0 +1,153 @@
+#include "perfect_hash.h"
+
+#include <algorithm>
+#include <limits>
+#include <stdexcept>
+
+namespace memb {
+
+namespace {
+
+const size_t AVERAGE_BUCKET_SIZE = 4;
+const uint64_t FNV_OFFSET_BASIS = 14695981039346656037ULL;
+const uint64_t FNV_PRIME = 1099511628211ULL;
+const uint64_t SEED_MULTIPLIER = 0x9e3779b97f4a7c15ULL;
+const std::string SEED_SEARCH_FAILED_MESSAGE = "Failed to build perfect hash index";
+
+uint64_t mix(uint64_t value)
+{
+    value = (value ^ (value >> 30)) * 0xbf58476d1ce4e5b9ULL;
+    value = (value ^ (value >> 27)) * 0x94d049bb133111ebULL;
+    return value ^ (value >> 31);
+}
+
+size_t bucketIndex(uint64_t hash, size_t bucketsCount)
+{
+    return (hash >> 32) % bucketsCount;
+}
+
+size_t slotIndex(uint64_t hash, uint32_t seed, size_t slotsCount)
+{
+    return mix(hash ^ (seed * SEED_MULTIPLIER)) % slotsCount;
+}
+
+uint32_t fingerprint(uint64_t hash)
+{
+    return static_cast<uint32_t>(hash);
+}
+
+} // namespace
+
+uint64_t hashWord(const char* word, size_t size)
+{
+    uint64_t result = FNV_OFFSET_BASIS;
+    for (size_t i = 0; i < size; ++i) {
+        result ^= static_cast<uint8_t>(word[i]);
+        result *= FNV_PRIME;
+    }
+
+    return mix(result);
+}
+
+PerfectHashIndexBuilder::PerfectHashIndexBuilder(const std::vector<std::string>& words):
+    bucketSeeds_(std::max<size_t>(1, (words.size() + AVERAGE_BUCKET_SIZE - 1) / AVERAGE_BUCKET_SIZE), 0),
+    slots_(words.size())
+{
+    std::vector<uint64_t> hashes;
+    hashes.reserve(words.size());
+    for (const auto& word : words) {
+        hashes.push_back(hashWord(word.c_str(), word.size()));
+    }
+
+    std::vector<std::vector<uint32_t>> buckets(bucketSeeds_.size());
+    for (size_t wordId = 0; wordId < hashes.size(); ++wordId) {
+        buckets[bucketIndex(hashes[wordId], buckets.size())].push_back(wordId);
+    }
+
+    std::vector<size_t> bucketsOrder(buckets.size());
+    for (size_t i = 0; i < bucketsOrder.size(); ++i) {
+        bucketsOrder[i] = i;
+    }
+    std::stable_sort(
+        bucketsOrder.begin(),
+        bucketsOrder.end(),
+        [&buckets](size_t lhs, size_t rhs)
+        {
+            return buckets[lhs].size() > buckets[rhs].size();
+        });
+
+    std::vector<bool> takenSlots(words.size(), false);
+    std::vector<size_t> bucketSlots;
+
+    for (auto bucket : bucketsOrder) {
+        const auto& wordIds = buckets[bucket];
+        if (wordIds.empty()) {
+            break;
+        }
+
+        uint32_t seed = 0;
+        while (true) {
+            bucketSlots.clear();
+            for (auto wordId : wordIds) {
+                auto slot = slotIndex(hashes[wordId], seed, slots_.size());
+                if (takenSlots[slot] ||
+                        std::find(bucketSlots.begin(), bucketSlots.end(), slot) != bucketSlots.end()) {
+                    break;
+                }
+                bucketSlots.push_back(slot);
+            }
+
+            if (bucketSlots.size() == wordIds.size()) {
+                break;
+            }
+
+            if (seed == std::numeric_limits<uint32_t>::max()) {
+                throw std::runtime_error(SEED_SEARCH_FAILED_MESSAGE);
+            }
+            ++seed;
+        }
+
+        bucketSeeds_[bucket] = seed;
+        for (size_t i = 0; i < wordIds.size(); ++i) {
+            takenSlots[bucketSlots[i]] = true;
+            slots_[bucketSlots[i]] = wire::PerfectHashSlot(
+                wordIds[i], fingerprint(hashes[wordIds[i]]));
+        }
+    }
+}
+
+flatbuffers::Offset<wire::PerfectHashIndex> PerfectHashIndexBuilder::save(
+    flatbuffers::FlatBufferBuilder& builder) const
+{
+    return wire::CreatePerfectHashIndex(
+        builder,
+        builder.CreateVector(bucketSeeds_),
+        builder.CreateVectorOfStructs(slots_));
+}
+
+const int64_t PerfectHashIndex::MISSING_WORD;
+
+PerfectHashIndex::PerfectHashIndex(const wire::PerfectHashIndex* flatIndex):
+    flatIndex_(flatIndex)
+{}
+
+int64_t PerfectHashIndex::candidate(const char* word, size_t size) const
+{
+    auto slots = flatIndex_->slots();
+    if (slots->size() == 0) {
+        return MISSING_WORD;
+    }
+
+    auto hash = hashWord(word, size);
+    auto bucketSeeds = flatIndex_->bucket_seeds();
+    auto seed = bucketSeeds->Get(bucketIndex(hash, bucketSeeds->size()));
+    auto slot = slots->Get(slotIndex(hash, seed, slots->size()));
+
+    if (slot->fingerprint() != fingerprint(hash)) {
+        return MISSING_WORD;
+    }
+
+    return slot->word_id();
+}
+
+}
@@ -0,0 +1,37 @@
+#pragma once
+
+#include "perfect_hash_generated.h"
+
+#include <string>
+#include <vector>
+
+namespace memb {
+
+uint64_t hashWord(const char* word, size_t size);
+
+class PerfectHashIndexBuilder {
+public:
+    PerfectHashIndexBuilder(const std::vector<std::string>& words);
+
+    flatbuffers::Offset<wire::PerfectHashIndex> save(flatbuffers::FlatBufferBuilder& builder) const;
+
+private:
+    std::vector<uint32_t> bucketSeeds_;
+    std::vector<wire::PerfectHashSlot> slots_;
+};
+
+class PerfectHashIndex {
+public:
+    static const int64_t MISSING_WORD = -1;
+
+    PerfectHashIndex(const wire::PerfectHashIndex* flatIndex);
+
+    // Returns the only word id that can match the query or MISSING_WORD if the
+    // stored fingerprint rejects it. Callers still have to compare the words.
+    int64_t candidate(const char* word, size_t size) const;
+
+private:
+    const wire::PerfectHashIndex* flatIndex_;
+};
+
+}
@@ -0,0 +1,47 @@
+#include "perfect_hash.h"
+
+#include <boost/test/unit_test.hpp>
+
+#include <set>
+
+using namespace memb;
+
+BOOST_AUTO_TEST_SUITE(perfectHash)
+
+BOOST_AUTO_TEST_CASE(perfectHashWorks)
+{
+    const size_t WORDS_COUNT = 10000;
+
+    std::vector<std::string> words;
+    for (size_t i = 0; i < WORDS_COUNT; ++i) {
+        words.push_back("word" + std::to_string(i));
+    }
+
+    flatbuffers::FlatBufferBuilder builder;
+    builder.Finish(PerfectHashIndexBuilder(words).save(builder));
+    PerfectHashIndex index(flatbuffers::GetRoot<wire::PerfectHashIndex>(builder.GetBufferPointer()));
+
+    for (size_t i = 0; i < WORDS_COUNT; ++i) {
+        BOOST_REQUIRE_EQUAL(index.candidate(words[i].c_str(), words[i].size()), i);
+    }
+
+    size_t falsePositives = 0;
+    for (size_t i = 0; i < WORDS_COUNT; ++i) {
+        auto missingWord = "missing" + std::to_string(i);
+        if (index.candidate(missingWord.c_str(), missingWord.size()) != PerfectHashIndex::MISSING_WORD) {
+            ++falsePositives;
+        }
+    }
+    BOOST_CHECK_LE(falsePositives, 1);
+}
+
+BOOST_AUTO_TEST_CASE(emptyPerfectHashWorks)
+{
+    flatbuffers::FlatBufferBuilder builder;
+    builder.Finish(PerfectHashIndexBuilder({}).save(builder));
+    PerfectHashIndex index(flatbuffers::GetRoot<wire::PerfectHashIndex>(builder.GetBufferPointer()));
+
+    BOOST_CHECK_EQUAL(index.candidate("the", 3), PerfectHashIndex::MISSING_WORD);
+}
+
+BOOST_AUTO_TEST_SUITE_END()
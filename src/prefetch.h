@@ -0,0 +1,18 @@
+#pragma once
+
+#if defined(_MSC_VER)
+#include <xmmintrin.h>
+#endif
+
+namespace memb {
+
+inline void prefetch(const void* address)
+{
+#if defined(__GNUC__)
+    __builtin_prefetch(address);
+#elif defined(_MSC_VER)
+    _mm_prefetch(static_cast<const char*>(address), _MM_HINT_T0);
+#endif
+}
+
+} // namespace memb
@@ -1,33 +1,167 @@
 #include "reader.h"
+#include "thread_pool.h"
 
-#include <future>
+#include <boost/format.hpp>
+
+#include <numeric>
 
 namespace memb {
 
 namespace {
 
-const size_t THREADED_DECODER_THRESHOLD = 1024;
+const std::string MISSING_ANN_INDEX_MESSAGE =
+    "Model was built without approximate nearest neighbour index";
+
+// Batch words grouped by value: each unique word is decoded once
+// and then copied to every position it occupies in the batch.
+struct SortedBatch {
+    std::vector<size_t> positions;
+    std::vector<const std::string*> uniqueWords;
+    std::vector<size_t> groupOffsets;
+};
+
+SortedBatch sortBatch(const std::vector<std::string>& words)
+{
+    SortedBatch result;
+    result.positions.resize(words.size());
+    std::iota(result.positions.begin(), result.positions.end(), 0);
+    std::sort(
+        result.positions.begin(),
+        result.positions.end(),
+        [&words](size_t lhs, size_t rhs)
+        {
+            return words[lhs] < words[rhs];
+        });
+
+    for (size_t i = 0; i < result.positions.size(); ++i) {
+        const auto& word = words[result.positions[i]];
+        if (result.uniqueWords.empty() || *result.uniqueWords.back() != word) {
+            result.uniqueWords.push_back(&word);
+            result.groupOffsets.push_back(i);
+        }
+    }
+    result.groupOffsets.push_back(result.positions.size());
+
+    return result;
+}
+
+void decodeSortedBatch(
+    const CompressedStorage& storage,
+    size_t dim,
+    const SortedBatch& batch,
+    size_t beginGroup,
+    size_t endGroup,
+    bool prefetch,
+    float* buffer)
+{
+    std::vector<const std::string*> words(
+        batch.uniqueWords.begin() + beginGroup, batch.uniqueWords.begin() + endGroup);
+    auto wordIds = storage.sortedWordIds(words);
+
+    if (prefetch) {
+        storage.prefetch(wordIds);
+    }
+
+    for (size_t group = beginGroup; group < endGroup; ++group) {
+        float* source = buffer + dim * batch.positions[batch.groupOffsets[group]];
+        auto wordId = wordIds[group - beginGroup];
+        if (wordId != CompressedStorage::MISSING_WORD) {
+            storage.extractById(wordId, source);
+        } else {
+            std::fill(source, source + dim, 0);
+        }
+
+        for (size_t i = batch.groupOffsets[group] + 1; i < batch.groupOffsets[group + 1]; ++i) {
+            std::copy(source, source + dim, buffer + dim * batch.positions[i]);
+        }
+    }
+}
+
+ReaderOptions threadsOptions(size_t numThreads)
+{
+    ReaderOptions result;
+    result.numThreads = numThreads;
+
+    return result;
+}
 
 } // namespace
 
+std::shared_ptr<Executor> createReaderExecutor(const ReaderOptions& options)
+{
+    if (options.executor) {
+        return options.executor;
+    }
+
+    if (options.numThreads == 0) {
+        return ThreadPool::shared();
+    }
+
+    // The calling thread takes part in decoding too
+    if (options.numThreads > 1) {
+        return std::make_shared<ThreadPool>(options.numThreads - 1);
+    }
+
+    return nullptr;
+}
+
+Reader::Reader(const ModelBuffer& buffer,
+               std::shared_ptr<CompressionStrategy> compressionStrategy,
+               const ReaderOptions& options):
+    executor_(createReaderExecutor(options)),
+    buffer_(buffer),
+    flatIndex_(getIndexChecked()),
+    compressedStorage_(createCompressedStorage(compressionStrategy, options.decoding)),
+    prefetchBatches_(options.residency.prefetchBatches)
+{
+    applyResidency(options.residency);
+
+    if (options.cacheBytes > 0) {
+        cachedStorage_ = std::make_shared<CachedCompressedStorage>(
+            compressedStorage_, dim(), options.cacheBytes);
+        compressedStorage_ = cachedStorage_;
+    }
+
+    if (flatIndex_->ann_index()) {
+        annIndex_ = std::make_shared<IvfIndex>(flatIndex_->ann_index(), dim(), size());
+    }
+}
+
+Reader::Reader(const ModelBuffer& buffer, const ReaderOptions& options):
+    Reader(buffer, nullptr, options)
+{}
+
+Reader::Reader(const std::string& filename,
+               std::shared_ptr<CompressionStrategy> compressionStrategy,
+               const ReaderOptions& options):
+    Reader(ModelBuffer::fromFile(filename), compressionStrategy, options)
+{}
+
 Reader::Reader(const std::string& filename,
                std::shared_ptr<CompressionStrategy> compressionStrategy,
                size_t numThreads):
-    numThreads_(adjustedNumThreads(numThreads)),
-    mappedFile_(filename),
-    flatIndex_(getIndexChecked()),
-    compressedStorage_(compressionStrategy->createCompressedStorage(
-        flatIndex_->storage(), flatIndex_->dim()))
+    Reader(filename, compressionStrategy, threadsOptions(numThreads))
+{}
+
+Reader::Reader(const std::string& filename, const ReaderOptions& options):
+    Reader(filename, nullptr, options)
 {}
 
 Reader::Reader(const std::string& filename, size_t numThreads):
-    numThreads_(adjustedNumThreads(numThreads)),
-    mappedFile_(filename),
-    flatIndex_(getIndexChecked()),
-    compressedStorage_(createCompressionStrategy(flatIndex_->storage_type())->createCompressedStorage(
-        flatIndex_->storage(), flatIndex_->dim()))
+    Reader(filename, nullptr, threadsOptions(numThreads))
 {}
 
+Reader::~Reader()
+{
+    std::unique_lock<std::mutex> lock(pendingRequests_.mutex);
+    pendingRequests_.done.wait(
+        lock,
+        [this]
+        {
+            return pendingRequests_.count == 0;
+        });
+}
+
 size_t Reader::dim() const
 {
     return flatIndex_->dim();
@@ -38,6 +172,11 @@ std::vector<std::string> Reader::keys() const
     return compressedStorage_->keys();
 }
 
+VocabularyView Reader::vocabulary() const
+{
+    return VocabularyView(compressedStorage_.get());
+}
+
 void Reader::wordEmbeddingToBuffer(const std::string& word, float* buffer) const
 {
     auto extractResult = compressedStorage_->extract(word, buffer);
@@ -46,45 +185,365 @@ void Reader::wordEmbeddingToBuffer(const std::string& word, float* buffer) const
     }
 }
 
-void Reader::batchEmbeddingToBufferImpl(
-    boost::iterator_range<std::vector<std::string>::const_iterator> words,
-    float* buffer) const
+void Reader::batchEmbeddingToBuffer(const std::vector<std::string>& words, float* buffer) const
+{
+    auto batch = sortBatch(words);
+
+    parallelFor(
+        executor_.get(),
+        batch.uniqueWords.size(),
+        minJobSize(),
+        [this, &batch, buffer](size_t startIndex, size_t endIndex)
+        {
+            decodeSortedBatch(
+                *compressedStorage_, dim(), batch, startIndex, endIndex, prefetchBatches_, buffer);
+        });
+}
+
+void Reader::batchEmbeddingAsync(
+    std::vector<std::string> words,
+    float* buffer,
+    std::function<void(std::exception_ptr)> callback) const
 {
-    size_t stride = flatIndex_->dim();
-    for (size_t idx = 0; idx < words.size(); ++idx) {
-        wordEmbeddingToBuffer(words[idx], buffer + stride * idx);
+    // Readers decoding in the calling thread still need somewhere to run requests
+    auto executor = executor_ ? executor_ : ThreadPool::shared();
+
+    {
+        std::lock_guard<std::mutex> lock(pendingRequests_.mutex);
+        ++pendingRequests_.count;
     }
+
+    executor->submit(
+        [this, words = std::move(words), buffer, callback]
+        {
+            std::exception_ptr error;
+            try {
+                batchEmbeddingToBuffer(words, buffer);
+            } catch (...) {
+                error = std::current_exception();
+            }
+
+            // The reader may be destroyed as soon as the lock is released
+            {
+                std::lock_guard<std::mutex> lock(pendingRequests_.mutex);
+                --pendingRequests_.count;
+                pendingRequests_.done.notify_all();
+            }
+
+            callback(error);
+        });
 }
 
-void Reader::batchEmbeddingToBuffer(const std::vector<std::string>& words, float* buffer) const
+std::future<void> Reader::batchEmbeddingAsync(std::vector<std::string> words, float* buffer) const
+{
+    auto promise = std::make_shared<std::promise<void>>();
+    auto result = promise->get_future();
+
+    batchEmbeddingAsync(
+        std::move(words),
+        buffer,
+        [promise](std::exception_ptr error)
+        {
+            if (error) {
+                promise->set_exception(error);
+            } else {
+                promise->set_value();
+            }
+        });
+
+    return result;
+}
+
+size_t Reader::size() const
+{
+    return compressedStorage_->size();
+}
+
+int64_t Reader::wordId(const std::string& word) const
 {
-    if (words.size() < THREADED_DECODER_THRESHOLD || numThreads_ == 1) {
-        batchEmbeddingToBufferImpl(
-            boost::make_iterator_range(words.begin(), words.end()), buffer);
-    } else {
-        size_t jobSize = (words.size() + numThreads_ - 1) / numThreads_;
-
-        size_t startIndex = 0;
-        std::vector<std::future<void>> results;
-        while (startIndex < words.size()) {
-            size_t endIndex = std::min(startIndex + jobSize, words.size());
-            auto request = boost::make_iterator_range(
-                words.begin() + startIndex, words.begin() + endIndex);
-            float* bufferOffset = buffer + startIndex * flatIndex_->dim();
-            results.push_back(std::async(
-                [this, request, bufferOffset]
-                {
-                    batchEmbeddingToBufferImpl(request, bufferOffset);
-                }));
-            startIndex += jobSize;
+    return compressedStorage_->wordId(word);
+}
+
+void Reader::batchWordIdsToBuffer(const std::vector<std::string>& words, int64_t* buffer) const
+{
+    auto batch = sortBatch(words);
+    auto wordIds = compressedStorage_->sortedWordIds(batch.uniqueWords);
+
+    for (size_t group = 0; group < wordIds.size(); ++group) {
+        for (size_t i = batch.groupOffsets[group]; i < batch.groupOffsets[group + 1]; ++i) {
+            buffer[batch.positions[i]] = wordIds[group];
         }
+    }
+}
 
-        for (auto& future : results) {
-            future.get();
+std::vector<int64_t> Reader::batchWordIds(const std::vector<std::string>& words) const
+{
+    std::vector<int64_t> result(words.size());
+    batchWordIdsToBuffer(words, result.data());
+
+    return result;
+}
+
+void Reader::embeddingByIdToBuffer(int64_t wordId, float* buffer) const
+{
+    batchEmbeddingByIdsImpl(&wordId, 1, buffer, dim(), false, 1);
+}
+
+void Reader::batchEmbeddingByIdsToBuffer(const int32_t* wordIds, size_t count, float* buffer) const
+{
+    batchEmbeddingByIdsImpl(wordIds, count, buffer, dim(), false, 1);
+}
+
+void Reader::batchEmbeddingByIdsToBuffer(const int64_t* wordIds, size_t count, float* buffer) const
+{
+    batchEmbeddingByIdsImpl(wordIds, count, buffer, dim(), false, 1);
+}
+
+void Reader::batchEmbeddingByIdsToBuffer(
+    const int64_t* wordIds, size_t count, float* buffer, size_t stride) const
+{
+    batchEmbeddingByIdsImpl(wordIds, count, buffer, stride, false, 1);
+}
+
+void Reader::accumulateBatchEmbeddingByIds(
+    const int64_t* wordIds, size_t count, float weight, float* buffer, size_t stride) const
+{
+    batchEmbeddingByIdsImpl(wordIds, count, buffer, stride, true, weight);
+}
+
+std::vector<float> Reader::embeddingById(int64_t wordId) const
+{
+    std::vector<float> result(flatIndex_->dim());
+    embeddingByIdToBuffer(wordId, result.data());
+
+    return result;
+}
+
+std::vector<float> Reader::batchEmbeddingByIds(const std::vector<int64_t>& wordIds) const
+{
+    std::vector<float> result(flatIndex_->dim() * wordIds.size());
+    batchEmbeddingByIdsToBuffer(wordIds.data(), wordIds.size(), result.data());
+
+    return result;
+}
+
+void Reader::batchEmbeddingRangeByIdsToBuffer(
+    const int64_t* wordIds, size_t count, size_t begin, size_t end, float* buffer) const
+{
+    if (begin > end || end > dim()) {
+        throw std::runtime_error(boost::str(
+            boost::format("Invalid dimension range [%1%, %2%) of %3% dimensions") % begin % end % dim()));
+    }
+    checkWordIds(wordIds, count);
+
+    size_t width = end - begin;
+    parallelFor(
+        executor_.get(),
+        count,
+        std::max<size_t>(1, MIN_JOB_VALUES / std::max<size_t>(width, 1)),
+        [&](size_t startIndex, size_t endIndex)
+        {
+            for (size_t i = startIndex; i < endIndex; ++i) {
+                float* destination = buffer + width * i;
+                if (wordIds[i] < 0) {
+                    std::fill(destination, destination + width, 0);
+                } else if (width > 0) {
+                    compressedStorage_->extractRangeById(wordIds[i], dim(), begin, end, destination);
+                }
+            }
+        });
+}
+
+std::vector<float> Reader::embeddingRangeById(int64_t wordId, size_t begin, size_t end) const
+{
+    std::vector<float> result(end > begin ? end - begin : 0);
+    batchEmbeddingRangeByIdsToBuffer(&wordId, 1, begin, end, result.data());
+
+    return result;
+}
+
+std::vector<Neighbour> Reader::mostSimilar(const float* query, size_t k, SimilarityMetric metric) const
+{
+    return batchMostSimilar(query, 1, k, metric).front();
+}
+
+std::vector<Neighbour> Reader::mostSimilar(const std::string& word, size_t k, SimilarityMetric metric) const
+{
+    auto id = wordId(word);
+    if (id == CompressedStorage::MISSING_WORD) {
+        return {};
+    }
+
+    auto result = mostSimilar(embeddingById(id).data(), k + 1, metric);
+    auto wordIt = std::find_if(
+        result.begin(),
+        result.end(),
+        [id](const Neighbour& neighbour)
+        {
+            return neighbour.wordId == id;
+        });
+
+    if (wordIt != result.end()) {
+        result.erase(wordIt);
+    } else if (result.size() > k) {
+        result.pop_back();
+    }
+
+    return result;
+}
+
+std::vector<std::vector<Neighbour>> Reader::batchMostSimilar(
+    const float* queries,
+    size_t queriesCount,
+    size_t k,
+    SimilarityMetric metric) const
+{
+    return findMostSimilar(*compressedStorage_, executor_.get(), queries, queriesCount, dim(), k, metric);
+}
+
+float Reader::similarity(const std::string& first, const std::string& second, SimilarityMetric metric) const
+{
+    return similarityById(wordId(first), wordId(second), metric);
+}
+
+float Reader::similarityById(int64_t firstId, int64_t secondId, SimilarityMetric metric) const
+{
+    float result;
+    batchSimilarityByIdsToBuffer(&firstId, &secondId, 1, &result, metric);
+
+    return result;
+}
+
+void Reader::batchSimilarityByIdsToBuffer(
+    const int64_t* firstIds,
+    const int64_t* secondIds,
+    size_t count,
+    float* buffer,
+    SimilarityMetric metric) const
+{
+    checkWordIds(firstIds, count);
+    checkWordIds(secondIds, count);
+
+    // A pair costs about as much as decoding two vectors
+    parallelFor(
+        executor_.get(),
+        count,
+        (minJobSize() + 1) / 2,
+        [&](size_t begin, size_t end)
+        {
+            compressedStorage_->scorePairs(
+                dim(), metric, firstIds + begin, secondIds + begin, end - begin, buffer + begin);
+        });
+}
+
+std::vector<float> Reader::batchSimilarity(
+    const std::vector<std::string>& firstWords,
+    const std::vector<std::string>& secondWords,
+    SimilarityMetric metric) const
+{
+    if (firstWords.size() != secondWords.size()) {
+        throw std::runtime_error(boost::str(
+            boost::format("Pair lists have different sizes: %1% and %2%") %
+                firstWords.size() % secondWords.size()));
+    }
+
+    auto firstIds = batchWordIds(firstWords);
+    auto secondIds = batchWordIds(secondWords);
+
+    std::vector<float> result(firstWords.size());
+    batchSimilarityByIdsToBuffer(firstIds.data(), secondIds.data(), result.size(), result.data(), metric);
+
+    return result;
+}
+
+bool Reader::hasAnnIndex() const
+{
+    return static_cast<bool>(annIndex_);
+}
+
+std::vector<Neighbour> Reader::approximateMostSimilar(
+    const float* query,
+    size_t k,
+    size_t nprobe,
+    SimilarityMetric metric) const
+{
+    return batchApproximateMostSimilar(query, 1, k, nprobe, metric).front();
+}
+
+std::vector<std::vector<Neighbour>> Reader::batchApproximateMostSimilar(
+    const float* queries,
+    size_t queriesCount,
+    size_t k,
+    size_t nprobe,
+    SimilarityMetric metric) const
+{
+    if (!annIndex_) {
+        throw std::runtime_error(MISSING_ANN_INDEX_MESSAGE);
+    }
+
+    return annIndex_->findMostSimilar(
+        *compressedStorage_, executor_.get(), queries, queriesCount, k, nprobe, metric);
+}
+
+CacheStatistics Reader::cacheStatistics() const
+{
+    if (cachedStorage_) {
+        return cachedStorage_->statistics();
+    }
+
+    return CacheStatistics();
+}
+
+template <typename WordId>
+void Reader::checkWordIds(const WordId* wordIds, size_t count) const
+{
+    auto vocabularySize = static_cast<int64_t>(size());
+    for (size_t i = 0; i < count; ++i) {
+        if (static_cast<int64_t>(wordIds[i]) >= vocabularySize) {
+            throw std::runtime_error(boost::str(
+                boost::format("Word id %1% is out of range, vocabulary size is %2%") %
+                    wordIds[i] % vocabularySize));
         }
     }
 }
 
+template <typename WordId>
+void Reader::batchEmbeddingByIdsImpl(
+    const WordId* wordIds,
+    size_t count,
+    float* buffer,
+    size_t stride,
+    bool accumulate,
+    float weight) const
+{
+    checkWordIds(wordIds, count);
+
+    parallelFor(
+        executor_.get(),
+        count,
+        minJobSize(),
+        [&](size_t startIndex, size_t endIndex)
+        {
+            size_t dimension = dim();
+            std::vector<float> values(accumulate ? dimension : 0);
+            for (size_t i = startIndex; i < endIndex; ++i) {
+                float* destination = buffer + stride * i;
+                if (accumulate) {
+                    if (wordIds[i] >= 0) {
+                        compressedStorage_->extractById(wordIds[i], values.data());
+                        for (size_t j = 0; j < dimension; ++j) {
+                            destination[j] += weight * values[j];
+                        }
+                    }
+                } else if (wordIds[i] < 0) {
+                    std::fill(destination, destination + dimension, 0);
+                } else {
+                    compressedStorage_->extractById(wordIds[i], destination);
+                }
+            }
+        });
+}
+
 std::vector<float> Reader::wordEmbedding(const std::string& word) const
 {
     std::vector<float> result(flatIndex_->dim());
@@ -103,20 +562,51 @@ std::vector<float> Reader::batchEmbedding(const std::vector<std::string>& words)
 
 const wire::Index* Reader::getIndexChecked() const
 {
-    if (mappedFile_.size() < 8 || !wire::IndexBufferHasIdentifier(mappedFile_.data())) {
+    if (buffer_.size() < 8 || !wire::IndexBufferHasIdentifier(buffer_.data())) {
         throw std::runtime_error("File format verification failed");
     }
 
-    return wire::GetIndex(mappedFile_.data());
+    return wire::GetIndex(buffer_.data());
+}
+
+std::shared_ptr<CompressedStorage> Reader::createCompressedStorage(
+    std::shared_ptr<CompressionStrategy> compressionStrategy,
+    const DecodingOptions& decodingOptions) const
+{
+    if (!compressionStrategy) {
+        compressionStrategy = createCompressionStrategy(flatIndex_->storage_type());
+    }
+
+    return compressionStrategy->createCompressedStorage(
+        flatIndex_->storage(), flatIndex_->dim(), decodingOptions);
 }
 
-size_t Reader::adjustedNumThreads(size_t numThreads) const
+void Reader::applyResidency(const ResidencyOptions& options) const
 {
-    if (numThreads > 0) {
-        return numThreads;
+    auto ranges = compressedStorage_->memoryRanges();
+    if (ranges.empty()) {
+        applyResidencyPolicy(buffer_.data(), buffer_.size(), options.values);
+        return;
     }
 
-    return std::max(std::thread::hardware_concurrency(), 2u);
+    for (const auto& range : ranges) {
+        switch (range.section) {
+        case StorageSection::Vocabulary:
+            applyResidencyPolicy(range.data, range.size, options.vocabulary);
+            break;
+        case StorageSection::Decoder:
+            applyResidencyPolicy(range.data, range.size, options.decoder);
+            break;
+        case StorageSection::Values:
+            applyResidencyPolicy(range.data, range.size, options.values);
+            break;
+        }
+    }
+}
+
+size_t Reader::minJobSize() const
+{
+    return std::max<size_t>(1, MIN_JOB_VALUES / dim());
 }
 
 }
@@ -2,41 +2,208 @@
 
 #include "embeddings_generated.h"
 #include "compression_strategy.h"
+#include "executor.h"
+#include "ivf_index.h"
+#include "model_buffer.h"
+#include "residency.h"
+#include "vector_cache.h"
+#include "vocabulary_view.h"
 
-#include <boost/iostreams/device/mapped_file.hpp>
-#include <boost/range/iterator_range.hpp>
+#include <condition_variable>
+#include <exception>
+#include <functional>
+#include <future>
+#include <mutex>
 
 namespace memb {
 
+// Batches are split between threads in jobs of at least that many values,
+// decoding less in a separate thread does not pay off
+const size_t MIN_JOB_VALUES = 1 << 14;
+
+struct ReaderOptions {
+    // Threads used to decode large batches, 0 means sharing a process-wide
+    // pool with a thread per core
+    size_t numThreads = 0;
+    // Runs decoding jobs instead of the pool chosen by numThreads
+    std::shared_ptr<Executor> executor;
+    // Page cache policies for the parts of the model file
+    ResidencyOptions residency;
+    // Memory budget for decoded vectors of frequent words, 0 disables the cache
+    size_t cacheBytes = 0;
+    // Lookup table layout of compressed storages, trading memory for speed
+    DecodingOptions decoding;
+};
+
+// Executor given in the options or the pool chosen by numThreads
+std::shared_ptr<Executor> createReaderExecutor(const ReaderOptions& options);
+
 class Reader {
 public:
     Reader(const std::string& filename, size_t numThreads = 0);
+    Reader(const std::string& filename, const ReaderOptions& options);
     Reader(
         const std::string& filename,
         std::shared_ptr<CompressionStrategy> compressionStrategy,
         size_t numThreads = 0);
+    Reader(
+        const std::string& filename,
+        std::shared_ptr<CompressionStrategy> compressionStrategy,
+        const ReaderOptions& options);
+    // The reader keeps a copy of the buffer, so buffers with an owner
+    // stay alive as long as the reader needs them
+    Reader(const ModelBuffer& buffer, const ReaderOptions& options = ReaderOptions());
+    Reader(
+        const ModelBuffer& buffer,
+        std::shared_ptr<CompressionStrategy> compressionStrategy,
+        const ReaderOptions& options);
+    // Waits for the pending asynchronous requests
+    ~Reader();
 
     size_t dim() const;
+    size_t size() const;
 
     std::vector<std::string> keys() const;
+    // Words in the order of their ids, without copying
+    VocabularyView vocabulary() const;
+
+    // Word ids are stable for a given model file and lie in [0, size()),
+    // unknown words are mapped to CompressedStorage::MISSING_WORD
+    int64_t wordId(const std::string& word) const;
+    void batchWordIdsToBuffer(const std::vector<std::string>& words, int64_t* buffer) const;
+    std::vector<int64_t> batchWordIds(const std::vector<std::string>& words) const;
+
+    // Negative ids produce zero vectors, ids not less than size() are rejected
+    void embeddingByIdToBuffer(int64_t wordId, float* buffer) const;
+    void batchEmbeddingByIdsToBuffer(const int32_t* wordIds, size_t count, float* buffer) const;
+    void batchEmbeddingByIdsToBuffer(const int64_t* wordIds, size_t count, float* buffer) const;
+    // Rows are written stride floats apart, so that several readers
+    // can fill column slices of one matrix
+    void batchEmbeddingByIdsToBuffer(const int64_t* wordIds, size_t count, float* buffer, size_t stride) const;
+    // Adds decoded vectors multiplied by weight to the rows instead of overwriting them
+    void accumulateBatchEmbeddingByIds(
+        const int64_t* wordIds, size_t count, float weight, float* buffer, size_t stride) const;
+
+    std::vector<float> embeddingById(int64_t wordId) const;
+    std::vector<float> batchEmbeddingByIds(const std::vector<int64_t>& wordIds) const;
+
+    // Dimensions [begin, end) of the vectors written as rows of end - begin floats.
+    // Models built with checkpoints decode only the codes from the closest
+    // checkpoint before begin, others stop decoding at end at best.
+    void batchEmbeddingRangeByIdsToBuffer(
+        const int64_t* wordIds, size_t count, size_t begin, size_t end, float* buffer) const;
+    std::vector<float> embeddingRangeById(int64_t wordId, size_t begin, size_t end) const;
+
+    // Exhaustive search over the whole vocabulary, queries are stored row by row.
+    // The word version skips the word itself and returns nothing for unknown words.
+    std::vector<Neighbour> mostSimilar(
+        const float* query, size_t k, SimilarityMetric metric = SimilarityMetric::Cosine) const;
+    std::vector<Neighbour> mostSimilar(
+        const std::string& word, size_t k, SimilarityMetric metric = SimilarityMetric::Cosine) const;
+    std::vector<std::vector<Neighbour>> batchMostSimilar(
+        const float* queries,
+        size_t queriesCount,
+        size_t k,
+        SimilarityMetric metric = SimilarityMetric::Cosine) const;
+
+    // Similarity of word pairs computed without decoding vectors to floats
+    // where the storage supports it. Unknown words and negative ids are
+    // treated as zero vectors, cosine similarity with them is zero.
+    float similarity(
+        const std::string& first,
+        const std::string& second,
+        SimilarityMetric metric = SimilarityMetric::Cosine) const;
+    float similarityById(
+        int64_t firstId,
+        int64_t secondId,
+        SimilarityMetric metric = SimilarityMetric::Cosine) const;
+    void batchSimilarityByIdsToBuffer(
+        const int64_t* firstIds,
+        const int64_t* secondIds,
+        size_t count,
+        float* buffer,
+        SimilarityMetric metric = SimilarityMetric::Cosine) const;
+    std::vector<float> batchSimilarity(
+        const std::vector<std::string>& firstWords,
+        const std::vector<std::string>& secondWords,
+        SimilarityMetric metric = SimilarityMetric::Cosine) const;
+
+    // Search restricted to nprobe clusters of the index stored in the file,
+    // throws when the model was built without the index
+    bool hasAnnIndex() const;
+    std::vector<Neighbour> approximateMostSimilar(
+        const float* query,
+        size_t k,
+        size_t nprobe,
+        SimilarityMetric metric = SimilarityMetric::Cosine) const;
+    std::vector<std::vector<Neighbour>> batchApproximateMostSimilar(
+        const float* queries,
+        size_t queriesCount,
+        size_t k,
+        size_t nprobe,
+        SimilarityMetric metric = SimilarityMetric::Cosine) const;
+
+    // All zeros when the cache is disabled
+    CacheStatistics cacheStatistics() const;
 
     void wordEmbeddingToBuffer(const std::string& word, float* buffer) const;
     void batchEmbeddingToBuffer(const std::vector<std::string>& words, float* buffer) const;
 
+    // Decode on the reader executor and return immediately. The buffer must
+    // outlive the request, the reader waits for its requests on destruction.
+    // The callback receives a null pointer on success and is invoked from
+    // a decoding thread after the request is done with the reader, so it
+    // may release the reader but must not throw.
+    void batchEmbeddingAsync(
+        std::vector<std::string> words,
+        float* buffer,
+        std::function<void(std::exception_ptr)> callback) const;
+    std::future<void> batchEmbeddingAsync(std::vector<std::string> words, float* buffer) const;
+
     std::vector<float> wordEmbedding(const std::string& word) const;
     std::vector<float> batchEmbedding(const std::vector<std::string>& words) const;
 
 private:
-    void batchEmbeddingToBufferImpl(
-        boost::iterator_range<std::vector<std::string>::const_iterator> words,
-        float* buffer) const;
+    template <typename WordId>
+    void batchEmbeddingByIdsImpl(
+        const WordId* wordIds,
+        size_t count,
+        float* buffer,
+        size_t stride,
+        bool accumulate,
+        float weight) const;
+
+    template <typename WordId>
+    void checkWordIds(const WordId* wordIds, size_t count) const;
+
     const wire::Index* getIndexChecked() const;
-    size_t adjustedNumThreads(size_t numThreads) const;
+    std::shared_ptr<CompressedStorage> createCompressedStorage(
+        std::shared_ptr<CompressionStrategy> compressionStrategy,
+        const DecodingOptions& decodingOptions) const;
+    void applyResidency(const ResidencyOptions& options) const;
+    size_t minJobSize() const;
 
-    size_t numThreads_;
-    boost::iostreams::mapped_file_source mappedFile_;
+    std::shared_ptr<Executor> executor_;
+    ModelBuffer buffer_;
     const wire::Index* flatIndex_;
     std::shared_ptr<CompressedStorage> compressedStorage_;
+    std::shared_ptr<CachedCompressedStorage> cachedStorage_;
+    std::shared_ptr<IvfIndex> annIndex_;
+    bool prefetchBatches_;
+
+    // Requests refer to the reader they were made to,
+    // so copies of the reader start with none
+    struct PendingRequests {
+        PendingRequests() = default;
+        PendingRequests(const PendingRequests&) {}
+        PendingRequests& operator=(const PendingRequests&) { return *this; }
+
+        std::mutex mutex;
+        std::condition_variable done;
+        size_t count = 0;
+    };
+
+    mutable PendingRequests pendingRequests_;
 };
 
 }
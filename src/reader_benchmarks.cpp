@@ -0,0 +1,131 @@
+#include "benchmark.h"
+#include "reader.h"
+
+#include <boost/test/unit_test.hpp>
+
+#include <algorithm>
+
+#ifndef _WIN32
+#include <fcntl.h>
+#include <unistd.h>
+#endif
+
+using namespace memb;
+
+namespace {
+
+const std::string BENCHMARK_MODEL_FILENAME = "benchmark.bin";
+const size_t WORDS_COUNT = 50000;
+const size_t DIM = 300;
+const size_t TOKENS_COUNT = 200000;
+
+#ifndef _WIN32
+// Evicts clean pages of the file from the page cache, so that
+// the next reader starts as it would right after a deploy
+void dropPageCache(const std::string& filename)
+{
+    int fd = open(filename.c_str(), O_RDONLY);
+    if (fd >= 0) {
+        posix_fadvise(fd, 0, 0, POSIX_FADV_DONTNEED);
+        close(fd);
+    }
+}
+#endif
+
+} // namespace
+
+BOOST_AUTO_TEST_SUITE(readerBatch)
+
+BOOST_AUTO_TEST_CASE(zipfBatch)
+{
+    createBenchmarkModel(BENCHMARK_MODEL_FILENAME, WORDS_COUNT, DIM);
+    Reader reader(BENCHMARK_MODEL_FILENAME, 1);
+    auto tokens = zipfTokens(benchmarkWords(WORDS_COUNT), TOKENS_COUNT);
+    std::vector<float> buffer(tokens.size() * reader.dim());
+
+    auto wordSeconds = measureSeconds(
+        [&]()
+        {
+            for (size_t i = 0; i < tokens.size(); ++i) {
+                reader.wordEmbeddingToBuffer(tokens[i], buffer.data() + i * reader.dim());
+            }
+        });
+    reportThroughput("word by word (zipf tokens)", tokens.size(), wordSeconds, "words");
+
+    auto batchSeconds = measureSeconds(
+        [&]()
+        {
+            reader.batchEmbeddingToBuffer(tokens, buffer.data());
+        });
+    reportThroughput("batch (zipf tokens)", tokens.size(), batchSeconds, "words");
+}
+
+BOOST_AUTO_TEST_CASE(zipfCachedWords)
+{
+    createBenchmarkModel(BENCHMARK_MODEL_FILENAME, WORDS_COUNT, DIM);
+    auto tokens = zipfTokens(benchmarkWords(WORDS_COUNT), TOKENS_COUNT);
+    std::vector<float> buffer(DIM);
+
+    for (size_t cacheBytes : {0, 1 << 20, 16 << 20}) {
+        ReaderOptions options;
+        options.numThreads = 1;
+        options.cacheBytes = cacheBytes;
+        Reader reader(BENCHMARK_MODEL_FILENAME, options);
+
+        auto seconds = measureSeconds(
+            [&]()
+            {
+                for (const auto& token : tokens) {
+                    reader.wordEmbeddingToBuffer(token, buffer.data());
+                }
+            });
+
+        auto statistics = reader.cacheStatistics();
+        reportThroughput(
+            "word by word, cache " + std::to_string(cacheBytes >> 20) + " MB, hit rate " +
+                std::to_string(statistics.hits * 100 / std::max<size_t>(1, statistics.hits + statistics.misses)) + "%",
+            tokens.size(),
+            seconds,
+            "words");
+    }
+}
+
+#ifndef _WIN32
+BOOST_AUTO_TEST_CASE(coldStartLatency)
+{
+    const size_t QUERIES_COUNT = 2000;
+
+    createBenchmarkModel(BENCHMARK_MODEL_FILENAME, WORDS_COUNT, DIM);
+    auto tokens = zipfTokens(benchmarkWords(WORDS_COUNT), QUERIES_COUNT);
+    std::vector<float> buffer(DIM);
+
+    for (const auto& policyName : {"default", "willneed", "populate"}) {
+        dropPageCache(BENCHMARK_MODEL_FILENAME);
+
+        ReaderOptions options;
+        options.numThreads = 1;
+        options.residency.vocabulary = parseResidencyPolicy(policyName);
+        options.residency.values = parseResidencyPolicy(policyName);
+
+        std::vector<double> latencies;
+        auto openSeconds = measureSeconds(
+            [&]()
+            {
+                Reader reader(BENCHMARK_MODEL_FILENAME, options);
+                for (const auto& token : tokens) {
+                    latencies.push_back(measureSeconds(
+                        [&]()
+                        {
+                            reader.wordEmbeddingToBuffer(token, buffer.data());
+                        }));
+                }
+            });
+
+        std::sort(latencies.begin(), latencies.end());
+        std::cout << "cold start, " << policyName << ": total " << openSeconds * 1e3
+            << " ms, p99 " << latencies[latencies.size() * 99 / 100] * 1e6 << " us" << std::endl;
+    }
+}
+#endif
+
+BOOST_AUTO_TEST_SUITE_END()
@@ -0,0 +1,148 @@
+#include "readers_union.h"
+
+#include <boost/format.hpp>
+
+#include <algorithm>
+#include <stdexcept>
+
+namespace memb {
+
+namespace {
+
+bool sameVocabulary(const Reader& first, const Reader& second)
+{
+    auto firstVocabulary = first.vocabulary();
+    auto secondVocabulary = second.vocabulary();
+
+    return firstVocabulary.size() == secondVocabulary.size() && std::equal(
+        firstVocabulary.begin(), firstVocabulary.end(), secondVocabulary.begin());
+}
+
+} // namespace
+
+UnionMode parseUnionMode(const std::string& name)
+{
+    if (name == "average") {
+        return UnionMode::Average;
+    } else if (name == "concatenate") {
+        return UnionMode::Concatenate;
+    }
+
+    throw std::runtime_error(boost::str(
+        boost::format("Mode %1% is not supported. Available modes are average and concatenate") % name));
+}
+
+ReadersUnion::ReadersUnion(std::vector<std::shared_ptr<Reader>> readers, UnionMode mode, size_t numThreads):
+    readers_(std::move(readers)),
+    mode_(mode)
+{
+    if (readers_.size() < 2) {
+        throw std::runtime_error("You must pass at least 2 readers to create a union");
+    }
+
+    ReaderOptions options;
+    options.numThreads = numThreads;
+    executor_ = createReaderExecutor(options);
+
+    for (size_t i = 0; i < readers_.size(); ++i) {
+        if (mode_ == UnionMode::Average && readers_[i]->dim() != readers_[0]->dim()) {
+            throw std::runtime_error("Dimensions of all readers must be equal for average mode");
+        }
+
+        size_t lookupReader = 0;
+        while (lookupReader < i && !sameVocabulary(*readers_[lookupReader], *readers_[i])) {
+            ++lookupReader;
+        }
+        lookupReaders_.push_back(lookupReader);
+    }
+}
+
+size_t ReadersUnion::dim() const
+{
+    if (mode_ == UnionMode::Average) {
+        return readers_.front()->dim();
+    }
+
+    size_t result = 0;
+    for (const auto& reader : readers_) {
+        result += reader->dim();
+    }
+
+    return result;
+}
+
+std::vector<std::string> ReadersUnion::keys() const
+{
+    std::vector<std::string> result;
+    for (size_t i = 0; i < readers_.size(); ++i) {
+        if (lookupReaders_[i] == i) {
+            for (auto word : readers_[i]->vocabulary()) {
+                result.push_back(word.to_string());
+            }
+        }
+    }
+
+    std::sort(result.begin(), result.end());
+    result.erase(std::unique(result.begin(), result.end()), result.end());
+
+    return result;
+}
+
+void ReadersUnion::wordEmbeddingToBuffer(const std::string& word, float* buffer) const
+{
+    batchEmbeddingToBuffer({word}, buffer);
+}
+
+void ReadersUnion::batchEmbeddingToBuffer(const std::vector<std::string>& words, float* buffer) const
+{
+    // Lookups of different vocabularies are independent
+    std::vector<std::vector<int64_t>> wordIds(readers_.size());
+    parallelFor(
+        executor_.get(),
+        readers_.size(),
+        1,
+        [&](size_t begin, size_t end)
+        {
+            for (size_t i = begin; i < end; ++i) {
+                if (lookupReaders_[i] == i) {
+                    wordIds[i] = readers_[i]->batchWordIds(words);
+                }
+            }
+        });
+
+    size_t dimension = dim();
+    if (mode_ == UnionMode::Average) {
+        std::fill(buffer, buffer + words.size() * dimension, 0);
+    }
+
+    size_t offset = 0;
+    for (size_t i = 0; i < readers_.size(); ++i) {
+        const auto& readerWordIds = wordIds[lookupReaders_[i]];
+        if (mode_ == UnionMode::Average) {
+            readers_[i]->accumulateBatchEmbeddingByIds(
+                readerWordIds.data(), words.size(), 1.0f / readers_.size(), buffer, dimension);
+        } else {
+            readers_[i]->batchEmbeddingByIdsToBuffer(
+                readerWordIds.data(), words.size(), buffer + offset, dimension);
+            offset += readers_[i]->dim();
+        }
+    }
+}
+
+std::vector<float> ReadersUnion::wordEmbedding(const std::string& word) const
+{
+    std::vector<float> result(dim());
+    wordEmbeddingToBuffer(word, result.data());
+
+    return result;
+}
+
+std::vector<float> ReadersUnion::batchEmbedding(const std::vector<std::string>& words) const
+{
+    std::vector<float> result(dim() * words.size());
+    batchEmbeddingToBuffer(words, result.data());
+
+    return result;
+}
+
+}
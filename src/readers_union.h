@@ -0,0 +1,47 @@
+#pragma once
+
+#include "reader.h"
+
+#include <memory>
+#include <string>
+#include <vector>
+
+namespace memb {
+
+enum class UnionMode {
+    // Mean of the vectors, readers must have equal dimensions
+    Average,
+    // Vectors of the readers one after another
+    Concatenate
+};
+
+UnionMode parseUnionMode(const std::string& name);
+
+// Makes several readers behave like one. Readers decode straight into
+// their column slices of the output (concatenate) or add their share to
+// it (average), so no intermediate matrices are allocated.
+class ReadersUnion {
+public:
+    ReadersUnion(std::vector<std::shared_ptr<Reader>> readers, UnionMode mode, size_t numThreads = 0);
+
+    size_t dim() const;
+
+    // Sorted union of the vocabularies
+    std::vector<std::string> keys() const;
+
+    void wordEmbeddingToBuffer(const std::string& word, float* buffer) const;
+    void batchEmbeddingToBuffer(const std::vector<std::string>& words, float* buffer) const;
+
+    std::vector<float> wordEmbedding(const std::string& word) const;
+    std::vector<float> batchEmbedding(const std::vector<std::string>& words) const;
+
+private:
+    std::vector<std::shared_ptr<Reader>> readers_;
+    UnionMode mode_;
+    std::shared_ptr<Executor> executor_;
+    // Index of the first reader with the same vocabulary, words are
+    // looked up once for every group of readers sharing a vocabulary
+    std::vector<size_t> lookupReaders_;
+};
+
+}
@@ -0,0 +1,92 @@
+#include "readers_union.h"
+#include "test_utils.h"
+
+#include <boost/test/unit_test.hpp>
+
+using namespace memb;
+
+namespace {
+
+std::shared_ptr<Reader> createReader(
+    const std::string& filename, size_t dim, size_t wordsCount, size_t seed)
+{
+    auto path = temporaryPath(filename);
+    buildModel(randomModel(dim, wordsCount, seed), path, "trained", 8);
+
+    return std::make_shared<Reader>(path, 2);
+}
+
+std::vector<std::string> testBatch()
+{
+    std::vector<std::string> result;
+    for (size_t i = 0; i < 300; i += 7) {
+        result.push_back("word" + std::to_string(i));
+    }
+    result.push_back("missing");
+
+    return result;
+}
+
+} // namespace
+
+BOOST_AUTO_TEST_SUITE(readersUnion)
+
+BOOST_AUTO_TEST_CASE(concatenationWorks)
+{
+    auto first = createReader("union_first.bin", 4, 200, 1);
+    auto second = createReader("union_second.bin", 3, 300, 2);
+    ReadersUnion readersUnion({first, second}, UnionMode::Concatenate);
+    BOOST_CHECK_EQUAL(readersUnion.dim(), 7);
+    BOOST_CHECK_EQUAL(readersUnion.keys().size(), 300);
+
+    auto batch = testBatch();
+    auto vectors = readersUnion.batchEmbedding(batch);
+    auto firstVectors = first->batchEmbedding(batch);
+    auto secondVectors = second->batchEmbedding(batch);
+
+    for (size_t i = 0; i < batch.size(); ++i) {
+        std::vector<float> expected(firstVectors.begin() + i * 4, firstVectors.begin() + (i + 1) * 4);
+        expected.insert(expected.end(), secondVectors.begin() + i * 3, secondVectors.begin() + (i + 1) * 3);
+        BOOST_CHECK(std::vector<float>(vectors.begin() + i * 7, vectors.begin() + (i + 1) * 7) == expected);
+    }
+
+    BOOST_CHECK(readersUnion.wordEmbedding(batch[1]) == std::vector<float>(vectors.begin() + 7, vectors.begin() + 14));
+}
+
+BOOST_AUTO_TEST_CASE(averageWorks)
+{
+    auto first = createReader("union_first.bin", 4, 300, 1);
+    auto second = createReader("union_second.bin", 4, 300, 2);
+    auto third = createReader("union_third.bin", 4, 200, 3);
+    // Shares the vocabulary of the first reader
+    auto fourth = createReader("union_fourth.bin", 4, 300, 4);
+    ReadersUnion readersUnion({first, second, third, fourth}, UnionMode::Average, 4);
+    BOOST_CHECK_EQUAL(readersUnion.dim(), 4);
+
+    auto batch = testBatch();
+    auto vectors = readersUnion.batchEmbedding(batch);
+
+    std::vector<float> expected(batch.size() * 4, 0.0f);
+    for (const auto& reader : {first, second, third, fourth}) {
+        auto readerVectors = reader->batchEmbedding(batch);
+        for (size_t i = 0; i < expected.size(); ++i) {
+            expected[i] += readerVectors[i] / 4;
+        }
+    }
+
+    for (size_t i = 0; i < expected.size(); ++i) {
+        BOOST_CHECK_SMALL(vectors[i] - expected[i], 1e-5f);
+    }
+}
+
+BOOST_AUTO_TEST_CASE(invalidUnionThrows)
+{
+    auto first = createReader("union_first.bin", 4, 10, 1);
+    auto second = createReader("union_second.bin", 3, 10, 2);
+
+    BOOST_CHECK_THROW(ReadersUnion({first}, UnionMode::Concatenate), std::runtime_error);
+    BOOST_CHECK_THROW(ReadersUnion({first, second}, UnionMode::Average), std::runtime_error);
+    BOOST_CHECK_THROW(parseUnionMode("sum"), std::runtime_error);
+}
+
+BOOST_AUTO_TEST_SUITE_END()
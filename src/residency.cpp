@@ -0,0 +1,159 @@
+#include "residency.h"
+
+#include <boost/format.hpp>
+
+#include <algorithm>
+#include <cstdint>
+#include <cstring>
+#include <stdexcept>
+
+#ifndef _WIN32
+#include <sys/mman.h>
+#include <unistd.h>
+#include <cerrno>
+#endif
+
+namespace memb {
+
+namespace {
+
+const size_t FALLBACK_PAGE_SIZE = 4096;
+// Reading a few extra pages is cheaper than an additional system call
+const size_t MAX_PREFETCH_GAP_PAGES = 8;
+
+size_t pageSize()
+{
+#ifndef _WIN32
+    static const size_t result = sysconf(_SC_PAGESIZE);
+    return result;
+#else
+    return FALLBACK_PAGE_SIZE;
+#endif
+}
+
+// madvise and mlock require page aligned addresses
+void alignToPages(const void*& data, size_t& size)
+{
+    auto begin = reinterpret_cast<uintptr_t>(data);
+    auto alignedBegin = begin & ~(pageSize() - 1);
+    size += begin - alignedBegin;
+    data = reinterpret_cast<const void*>(alignedBegin);
+}
+
+void advise(const void* data, size_t size, int advice)
+{
+#ifndef _WIN32
+    madvise(const_cast<void*>(data), size, advice);
+#endif
+}
+
+void touchPages(const void* data, size_t size)
+{
+    auto bytes = static_cast<const volatile uint8_t*>(data);
+    for (size_t offset = 0; offset < size; offset += pageSize()) {
+        bytes[offset];
+    }
+}
+
+} // namespace
+
+ResidencyPolicy parseResidencyPolicy(const std::string& name)
+{
+    if (name == "default") {
+        return ResidencyPolicy::Default;
+    } else if (name == "random") {
+        return ResidencyPolicy::Random;
+    } else if (name == "willneed") {
+        return ResidencyPolicy::WillNeed;
+    } else if (name == "hugepages") {
+        return ResidencyPolicy::HugePages;
+    } else if (name == "populate") {
+        return ResidencyPolicy::Populate;
+    } else if (name == "lock") {
+        return ResidencyPolicy::Lock;
+    }
+
+    throw std::runtime_error(boost::str(
+        boost::format("Unknown residency policy %1%") % name));
+}
+
+void applyResidencyPolicy(const void* data, size_t size, ResidencyPolicy policy)
+{
+    if (size == 0 || policy == ResidencyPolicy::Default) {
+        return;
+    }
+
+    alignToPages(data, size);
+
+    switch (policy) {
+#ifndef _WIN32
+    case ResidencyPolicy::Random:
+        advise(data, size, MADV_RANDOM);
+        break;
+    case ResidencyPolicy::WillNeed:
+        advise(data, size, MADV_WILLNEED);
+        break;
+    case ResidencyPolicy::HugePages:
+#ifdef MADV_HUGEPAGE
+        advise(data, size, MADV_HUGEPAGE);
+#endif
+        break;
+    case ResidencyPolicy::Populate:
+        advise(data, size, MADV_WILLNEED);
+        touchPages(data, size);
+        break;
+    case ResidencyPolicy::Lock:
+        if (mlock(data, size) != 0) {
+            throw std::runtime_error(boost::str(
+                boost::format("Failed to lock %1% bytes in memory: %2%") % size % std::strerror(errno)));
+        }
+        break;
+#else
+    case ResidencyPolicy::Populate:
+    case ResidencyPolicy::Lock:
+        touchPages(data, size);
+        break;
+#endif
+    default:
+        break;
+    }
+}
+
+void prefetchPages(const void* data, size_t size, std::vector<size_t> offsets)
+{
+#ifndef _WIN32
+    if (offsets.empty()) {
+        return;
+    }
+
+    auto base = reinterpret_cast<uintptr_t>(data);
+    auto end = base + size;
+    for (auto& offset : offsets) {
+        offset = (base + offset) / pageSize();
+    }
+    std::sort(offsets.begin(), offsets.end());
+
+    size_t firstPage = offsets[0];
+    size_t lastPage = offsets[0];
+    for (size_t i = 1; i <= offsets.size(); ++i) {
+        if (i < offsets.size() && offsets[i] <= lastPage + MAX_PREFETCH_GAP_PAGES) {
+            lastPage = std::max(lastPage, offsets[i]);
+            continue;
+        }
+
+        // Pages past the end of data may be outside of the mapping
+        auto rangeEnd = std::min<uintptr_t>((lastPage + 1) * pageSize(), end);
+        advise(
+            reinterpret_cast<const void*>(firstPage * pageSize()),
+            rangeEnd - firstPage * pageSize(),
+            MADV_WILLNEED);
+
+        if (i < offsets.size()) {
+            firstPage = offsets[i];
+            lastPage = offsets[i];
+        }
+    }
+#endif
+}
+
+}
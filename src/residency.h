@@ -0,0 +1,47 @@
+#pragma once
+
+#include <cstddef>
+#include <string>
+#include <vector>
+
+namespace memb {
+
+// How pages of a mapped file section are kept in memory
+enum class ResidencyPolicy {
+    // Left to the kernel
+    Default,
+    // Disables readahead, which only wastes page cache on random lookups
+    Random,
+    // Starts asynchronous readahead of the whole section
+    WillNeed,
+    // Asks for transparent huge pages where the kernel supports them for files
+    HugePages,
+    // Reads the whole section before the reader is returned, like MAP_POPULATE
+    Populate,
+    // Reads the section and pins it in memory, requires RLIMIT_MEMLOCK headroom
+    Lock
+};
+
+struct ResidencyOptions {
+    // Word lookup structures
+    ResidencyPolicy vocabulary = ResidencyPolicy::Default;
+    // Decoding tables, copied to the heap by most storages
+    ResidencyPolicy decoder = ResidencyPolicy::Default;
+    // Encoded vectors, the whole file for storages without separate sections
+    ResidencyPolicy values = ResidencyPolicy::Default;
+    // Request readahead for the values of every batch job before decoding it
+    bool prefetchBatches = false;
+};
+
+ResidencyPolicy parseResidencyPolicy(const std::string& name);
+
+// Advice failures are ignored because the policies are only hints,
+// failure to lock memory is reported with an exception
+void applyResidencyPolicy(const void* data, size_t size, ResidencyPolicy policy);
+
+// Requests asynchronous readahead of the pages containing data + offsets[i]
+// within the size bytes of data, nearby pages are merged to keep the number
+// of system calls low
+void prefetchPages(const void* data, size_t size, std::vector<size_t> offsets);
+
+}
@@ -0,0 +1,111 @@
+#include "search_tree.h"
+#include "prefetch.h"
+
+#include <cstring>
+
+namespace memb {
+
+namespace {
+
+const size_t PREFIX_SIZE = sizeof(uint64_t);
+
+uint64_t wordPrefix(const char* word, size_t size)
+{
+    uint64_t result = 0;
+    for (size_t i = 0; i < PREFIX_SIZE; ++i) {
+        result <<= 8;
+        if (i < size) {
+            result += static_cast<uint8_t>(word[i]);
+        }
+    }
+
+    return result;
+}
+
+} // namespace
+
+SearchTreeBuilder::SearchTreeBuilder(const std::vector<std::string>& sortedWords):
+    nodes_(sortedWords.size() + 1)
+{
+    fill(sortedWords, 1, 0);
+}
+
+size_t SearchTreeBuilder::fill(const std::vector<std::string>& sortedWords, size_t node, size_t wordId)
+{
+    if (node < nodes_.size()) {
+        wordId = fill(sortedWords, 2 * node, wordId);
+
+        const auto& word = sortedWords[wordId];
+        nodes_[node] = wire::SearchTreeNode(wordPrefix(word.c_str(), word.size()), wordId);
+        ++wordId;
+
+        wordId = fill(sortedWords, 2 * node + 1, wordId);
+    }
+
+    return wordId;
+}
+
+flatbuffers::Offset<flatbuffers::Vector<const wire::SearchTreeNode*>> SearchTreeBuilder::save(
+    flatbuffers::FlatBufferBuilder& builder) const
+{
+    return builder.CreateVectorOfStructs(nodes_);
+}
+
+const int64_t SearchTree::MISSING_WORD;
+
+SearchTree::SearchTree(
+        const flatbuffers::Vector<const wire::SearchTreeNode*>* nodes,
+        const flatbuffers::Vector<uint32_t>* wordOffsets,
+        const char* packedWords):
+    nodes_(reinterpret_cast<const wire::SearchTreeNode*>(nodes->Data())),
+    size_(nodes->size() > 0 ? nodes->size() - 1 : 0),
+    wordOffsets_(wordOffsets),
+    packedWords_(packedWords)
+{}
+
+int64_t SearchTree::find(const std::string& word) const
+{
+    auto prefix = wordPrefix(word.c_str(), word.size());
+
+    size_t node = 1;
+    while (node <= size_) {
+        // Four grandchildren of a node are adjacent. Flatbuffers aligns the nodes
+        // to 8 bytes only, so they may span two cache lines: prefetching the first
+        // and the last one covers two levels ahead.
+        prefetch(nodes_ + 4 * node);
+        prefetch(nodes_ + 4 * node + 3);
+        node = 2 * node + less(nodes_ + node, prefix, word);
+    }
+
+    while (node & 1) {
+        node >>= 1;
+    }
+    node >>= 1;
+
+    if (node == 0 || nodes_[node].prefix() != prefix) {
+        return MISSING_WORD;
+    }
+
+    auto wordId = nodes_[node].word_id();
+    if (word.size() >= PREFIX_SIZE && strcmp(packedWords_ + wordOffsets_->Get(wordId), word.c_str()) != 0) {
+        return MISSING_WORD;
+    }
+
+    return wordId;
+}
+
+bool SearchTree::less(const wire::SearchTreeNode* node, uint64_t prefix, const std::string& word) const
+{
+    if (node->prefix() != prefix) {
+        return node->prefix() < prefix;
+    }
+
+    // Words shorter than the prefix are fully contained in it and can only be equal here
+    if (word.size() < PREFIX_SIZE) {
+        return false;
+    }
+
+    return strcmp(packedWords_ + wordOffsets_->Get(node->word_id()), word.c_str()) < 0;
+}
+
+}
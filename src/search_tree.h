@@ -0,0 +1,45 @@
+#pragma once
+
+#include "search_tree_generated.h"
+
+#include <string>
+#include <vector>
+
+namespace memb {
+
+// Eytzinger-ordered copy of a sorted vocabulary. Each node keeps the first
+// 8 bytes of its word, so most comparisons never leave the node's cache line.
+class SearchTreeBuilder {
+public:
+    SearchTreeBuilder(const std::vector<std::string>& sortedWords);
+
+    flatbuffers::Offset<flatbuffers::Vector<const wire::SearchTreeNode*>> save(
+        flatbuffers::FlatBufferBuilder& builder) const;
+
+private:
+    size_t fill(const std::vector<std::string>& sortedWords, size_t node, size_t wordId);
+
+    std::vector<wire::SearchTreeNode> nodes_;
+};
+
+class SearchTree {
+public:
+    static const int64_t MISSING_WORD = -1;
+
+    SearchTree(
+        const flatbuffers::Vector<const wire::SearchTreeNode*>* nodes,
+        const flatbuffers::Vector<uint32_t>* wordOffsets,
+        const char* packedWords);
+
+    int64_t find(const std::string& word) const;
+
+private:
+    bool less(const wire::SearchTreeNode* node, uint64_t prefix, const std::string& word) const;
+
+    const wire::SearchTreeNode* nodes_;
+    size_t size_;
+    const flatbuffers::Vector<uint32_t>* wordOffsets_;
+    const char* packedWords_;
+};
+
+}
@@ -0,0 +1,323 @@
+#include "sharded_reader.h"
+#include "perfect_hash.h"
+#include "thread_pool.h"
+
+#include <boost/format.hpp>
+#include <boost/property_tree/json_parser.hpp>
+#include <boost/property_tree/ptree.hpp>
+
+#include <algorithm>
+#include <stdexcept>
+
+namespace memb {
+
+namespace {
+
+const std::string HASH_PARTITIONING = "hash";
+const std::string RANGE_PARTITIONING = "range";
+
+const std::string INVALID_RANGES_MESSAGE =
+    "Range shards must start from an empty word and be sorted in ascending order";
+
+// Prefix of the filename including the trailing separator
+std::string directoryName(const std::string& filename)
+{
+    auto separator = filename.find_last_of('/');
+    return separator == std::string::npos ? "" : filename.substr(0, separator + 1);
+}
+
+std::string resolvePath(const std::string& manifestFilename, const std::string& path)
+{
+    if (!path.empty() && path.front() == '/') {
+        return path;
+    }
+
+    return directoryName(manifestFilename) + path;
+}
+
+std::string shardFilename(const std::string& manifestFilename, size_t shard)
+{
+    auto name = manifestFilename.substr(directoryName(manifestFilename).size());
+    auto extension = name.find_last_of('.');
+    if (extension != std::string::npos && extension > 0) {
+        name.resize(extension);
+    }
+
+    return boost::str(boost::format("%1%-%2%.memb") % name % shard);
+}
+
+ReaderOptions threadsOptions(size_t numThreads)
+{
+    ReaderOptions result;
+    result.numThreads = numThreads;
+
+    return result;
+}
+
+void checkManifest(const ShardManifest& manifest)
+{
+    if (manifest.paths.empty()) {
+        throw std::runtime_error("Manifest must contain at least one shard");
+    }
+
+    if (manifest.partitioning == ShardPartitioning::Range) {
+        const auto& firstWords = manifest.firstWords;
+        bool sorted = std::adjacent_find(
+            firstWords.begin(),
+            firstWords.end(),
+            std::greater_equal<std::string>()) == firstWords.end();
+
+        if (firstWords.size() != manifest.paths.size() || !firstWords.front().empty() || !sorted) {
+            throw std::runtime_error(INVALID_RANGES_MESSAGE);
+        }
+    }
+}
+
+} // namespace
+
+ShardManifest ShardManifest::load(const std::string& filename)
+{
+    boost::property_tree::ptree tree;
+    boost::property_tree::read_json(filename, tree);
+
+    ShardManifest result;
+    result.dim = tree.get<size_t>("dim");
+
+    auto partitioning = tree.get<std::string>("partitioning", HASH_PARTITIONING);
+    if (partitioning == HASH_PARTITIONING) {
+        result.partitioning = ShardPartitioning::Hash;
+    } else if (partitioning == RANGE_PARTITIONING) {
+        result.partitioning = ShardPartitioning::Range;
+    } else {
+        throw std::runtime_error(boost::str(
+            boost::format("Unknown shard partitioning %1%") % partitioning));
+    }
+
+    for (const auto& shard : tree.get_child("shards")) {
+        result.paths.push_back(resolvePath(filename, shard.second.get<std::string>("path")));
+        if (result.partitioning == ShardPartitioning::Range) {
+            result.firstWords.push_back(shard.second.get<std::string>("first_word"));
+        }
+    }
+
+    checkManifest(result);
+
+    return result;
+}
+
+void ShardManifest::save(const std::string& filename) const
+{
+    boost::property_tree::ptree shards;
+    for (size_t i = 0; i < paths.size(); ++i) {
+        boost::property_tree::ptree shard;
+        shard.put("path", paths[i]);
+        if (partitioning == ShardPartitioning::Range) {
+            shard.put("first_word", firstWords[i]);
+        }
+        shards.push_back(std::make_pair("", shard));
+    }
+
+    boost::property_tree::ptree tree;
+    tree.put("dim", dim);
+    tree.put("partitioning", partitioning == ShardPartitioning::Hash ? HASH_PARTITIONING : RANGE_PARTITIONING);
+    tree.add_child("shards", shards);
+
+    boost::property_tree::write_json(filename, tree);
+}
+
+size_t ShardManifest::shardIndex(const std::string& word) const
+{
+    if (partitioning == ShardPartitioning::Hash) {
+        return hashWord(word.data(), word.size()) % paths.size();
+    }
+
+    return std::upper_bound(firstWords.begin(), firstWords.end(), word) - firstWords.begin() - 1;
+}
+
+ShardedBuilder::ShardedBuilder(
+    size_t dim,
+    const std::string& storageType,
+    size_t bitsPerWeight,
+    size_t shardsCount,
+    const CompressionOptions& options)
+{
+    manifest_.dim = dim;
+    manifest_.partitioning = ShardPartitioning::Hash;
+    createBuilders(storageType, bitsPerWeight, shardsCount, options);
+}
+
+ShardedBuilder::ShardedBuilder(
+    size_t dim,
+    const std::string& storageType,
+    size_t bitsPerWeight,
+    const std::vector<std::string>& firstWords,
+    const CompressionOptions& options)
+{
+    manifest_.dim = dim;
+    manifest_.partitioning = ShardPartitioning::Range;
+    manifest_.firstWords = firstWords;
+    createBuilders(storageType, bitsPerWeight, firstWords.size(), options);
+}
+
+void ShardedBuilder::createBuilders(
+    const std::string& storageType,
+    size_t bitsPerWeight,
+    size_t shardsCount,
+    const CompressionOptions& options)
+{
+    manifest_.paths.resize(shardsCount);
+    checkManifest(manifest_);
+
+    for (size_t i = 0; i < shardsCount; ++i) {
+        builders_.emplace_back(new Builder(manifest_.dim, storageType, bitsPerWeight, options));
+    }
+}
+
+void ShardedBuilder::addWord(const std::string& word, const std::vector<float>& embedding, double frequency)
+{
+    builders_[manifest_.shardIndex(word)]->addWord(word, embedding, frequency);
+}
+
+void ShardedBuilder::save(const std::string& manifestFilename)
+{
+    for (size_t i = 0; i < builders_.size(); ++i) {
+        manifest_.paths[i] = shardFilename(manifestFilename, i);
+    }
+
+    // Shards are compressed independently, which is what makes building them slow
+    parallelFor(
+        ThreadPool::shared().get(),
+        builders_.size(),
+        1,
+        [&](size_t begin, size_t end)
+        {
+            for (size_t i = begin; i < end; ++i) {
+                builders_[i]->save(resolvePath(manifestFilename, manifest_.paths[i]));
+            }
+        });
+
+    manifest_.save(manifestFilename);
+}
+
+ShardedReader::ShardedReader(const std::string& manifestFilename, size_t numThreads):
+    ShardedReader(manifestFilename, threadsOptions(numThreads))
+{}
+
+ShardedReader::ShardedReader(const std::string& manifestFilename, const ReaderOptions& options):
+    executor_(createReaderExecutor(options)),
+    manifest_(ShardManifest::load(manifestFilename))
+{
+    ReaderOptions shardOptions = options;
+    shardOptions.executor = executor_;
+    shardOptions.cacheBytes = options.cacheBytes / manifest_.paths.size();
+
+    for (const auto& path : manifest_.paths) {
+        shards_.emplace_back(new Reader(path, shardOptions));
+        if (shards_.back()->dim() != manifest_.dim) {
+            throw std::runtime_error(boost::str(
+                boost::format("Shard %1% dimension (%2%) doesn't match manifest dimension (%3%)") %
+                    path % shards_.back()->dim() % manifest_.dim));
+        }
+    }
+}
+
+size_t ShardedReader::dim() const
+{
+    return manifest_.dim;
+}
+
+size_t ShardedReader::size() const
+{
+    size_t result = 0;
+    for (const auto& shard : shards_) {
+        result += shard->size();
+    }
+
+    return result;
+}
+
+size_t ShardedReader::shardsCount() const
+{
+    return shards_.size();
+}
+
+std::vector<std::string> ShardedReader::keys() const
+{
+    std::vector<std::string> result;
+    result.reserve(size());
+    for (const auto& shard : shards_) {
+        auto vocabulary = shard->vocabulary();
+        for (auto word : vocabulary) {
+            result.push_back(word.to_string());
+        }
+    }
+
+    // Range shards are already ordered
+    if (manifest_.partitioning == ShardPartitioning::Hash) {
+        std::sort(result.begin(), result.end());
+    }
+
+    return result;
+}
+
+void ShardedReader::wordEmbeddingToBuffer(const std::string& word, float* buffer) const
+{
+    shards_[manifest_.shardIndex(word)]->wordEmbeddingToBuffer(word, buffer);
+}
+
+void ShardedReader::batchEmbeddingToBuffer(const std::vector<std::string>& words, float* buffer) const
+{
+    std::vector<std::vector<size_t>> positions(shards_.size());
+    for (size_t i = 0; i < words.size(); ++i) {
+        positions[manifest_.shardIndex(words[i])].push_back(i);
+    }
+
+    size_t dimension = dim();
+    parallelFor(
+        executor_.get(),
+        shards_.size(),
+        1,
+        [&](size_t begin, size_t end)
+        {
+            for (size_t shard = begin; shard < end; ++shard) {
+                const auto& shardPositions = positions[shard];
+                if (shardPositions.empty()) {
+                    continue;
+                }
+
+                std::vector<std::string> shardWords;
+                shardWords.reserve(shardPositions.size());
+                for (auto position : shardPositions) {
+                    shardWords.push_back(words[position]);
+                }
+
+                std::vector<float> shardBuffer(shardWords.size() * dimension);
+                shards_[shard]->batchEmbeddingToBuffer(shardWords, shardBuffer.data());
+
+                for (size_t i = 0; i < shardPositions.size(); ++i) {
+                    std::copy(
+                        shardBuffer.begin() + i * dimension,
+                        shardBuffer.begin() + (i + 1) * dimension,
+                        buffer + shardPositions[i] * dimension);
+                }
+            }
+        });
+}
+
+std::vector<float> ShardedReader::wordEmbedding(const std::string& word) const
+{
+    std::vector<float> result(dim());
+    wordEmbeddingToBuffer(word, result.data());
+
+    return result;
+}
+
+std::vector<float> ShardedReader::batchEmbedding(const std::vector<std::string>& words) const
+{
+    std::vector<float> result(dim() * words.size());
+    batchEmbeddingToBuffer(words, result.data());
+
+    return result;
+}
+
+}
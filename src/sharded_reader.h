@@ -0,0 +1,96 @@
+#pragma once
+
+#include "builder.h"
+#include "reader.h"
+
+#include <memory>
+#include <string>
+#include <vector>
+
+namespace memb {
+
+enum class ShardPartitioning {
+    // Shard is chosen by a stable hash of the word
+    Hash,
+    // Every shard holds a contiguous range of sorted words
+    Range
+};
+
+// Manifest is a JSON file of the form
+// {"dim": 300, "partitioning": "hash", "shards": [{"path": "model-0.memb"}, ...]}.
+// Range shards also have "first_word", the smallest word they may hold,
+// ascending and starting from the empty string. Relative paths are
+// resolved against the directory of the manifest.
+struct ShardManifest {
+    size_t dim = 0;
+    ShardPartitioning partitioning = ShardPartitioning::Hash;
+    std::vector<std::string> paths;
+    std::vector<std::string> firstWords;
+
+    static ShardManifest load(const std::string& filename);
+    void save(const std::string& filename) const;
+
+    size_t shardIndex(const std::string& word) const;
+};
+
+// Distributes words over several builders and saves them in parallel
+// next to the manifest, shard files are named <manifest stem>-<index>.memb
+class ShardedBuilder {
+public:
+    // Hash partitioning
+    ShardedBuilder(
+        size_t dim,
+        const std::string& storageType,
+        size_t bitsPerWeight,
+        size_t shardsCount,
+        const CompressionOptions& options = CompressionOptions());
+    // Range partitioning, firstWords are described in ShardManifest
+    ShardedBuilder(
+        size_t dim,
+        const std::string& storageType,
+        size_t bitsPerWeight,
+        const std::vector<std::string>& firstWords,
+        const CompressionOptions& options = CompressionOptions());
+
+    void addWord(const std::string& word, const std::vector<float>& embedding, double frequency = 0.0);
+    void save(const std::string& manifestFilename);
+
+private:
+    void createBuilders(
+        const std::string& storageType,
+        size_t bitsPerWeight,
+        size_t shardsCount,
+        const CompressionOptions& options);
+
+    ShardManifest manifest_;
+    std::vector<std::unique_ptr<Builder>> builders_;
+};
+
+// Reader over the shards of a manifest. Lookups are routed to the shard
+// owning the word, batches are split by shard and decoded in parallel.
+class ShardedReader {
+public:
+    ShardedReader(const std::string& manifestFilename, size_t numThreads = 0);
+    // Executor and cache budget of the options are shared by all shards
+    ShardedReader(const std::string& manifestFilename, const ReaderOptions& options);
+
+    size_t dim() const;
+    size_t size() const;
+    size_t shardsCount() const;
+
+    // Sorted words of all shards
+    std::vector<std::string> keys() const;
+
+    void wordEmbeddingToBuffer(const std::string& word, float* buffer) const;
+    void batchEmbeddingToBuffer(const std::vector<std::string>& words, float* buffer) const;
+
+    std::vector<float> wordEmbedding(const std::string& word) const;
+    std::vector<float> batchEmbedding(const std::vector<std::string>& words) const;
+
+private:
+    std::shared_ptr<Executor> executor_;
+    ShardManifest manifest_;
+    std::vector<std::unique_ptr<Reader>> shards_;
+};
+
+}
@@ -0,0 +1,91 @@
+#include "sharded_reader.h"
+#include "test_utils.h"
+
+#include <boost/test/unit_test.hpp>
+
+#include <fstream>
+
+using namespace memb;
+
+namespace {
+
+const std::string MANIFEST_FILENAME = temporaryPath("sharded.json");
+const std::string SINGLE_MODEL_FILENAME = temporaryPath("single.bin");
+const size_t WORDS_COUNT = 1000;
+const size_t DIM = 8;
+
+void shardedReaderTestImpl(ShardedBuilder& shardedBuilder, size_t shardsCount)
+{
+    auto model = randomModel(DIM, WORDS_COUNT, 42);
+    const auto& words = model.words;
+
+    buildModel(model, SINGLE_MODEL_FILENAME, "full", 8);
+    for (size_t i = 0; i < WORDS_COUNT; ++i) {
+        shardedBuilder.addWord(words[i], model.vectors[i]);
+    }
+    shardedBuilder.save(MANIFEST_FILENAME);
+
+    Reader reader(SINGLE_MODEL_FILENAME);
+    auto batch = words;
+    batch.push_back("missing");
+    batch.push_back(words[3]);
+    auto expected = reader.batchEmbedding(batch);
+
+    for (size_t numThreads : {1, 4}) {
+        ShardedReader shardedReader(MANIFEST_FILENAME, numThreads);
+        BOOST_CHECK_EQUAL(shardedReader.dim(), DIM);
+        BOOST_CHECK_EQUAL(shardedReader.size(), WORDS_COUNT);
+        BOOST_CHECK_EQUAL(shardedReader.shardsCount(), shardsCount);
+        BOOST_CHECK(shardedReader.keys() == reader.keys());
+
+        BOOST_CHECK(shardedReader.batchEmbedding(batch) == expected);
+        BOOST_CHECK(shardedReader.wordEmbedding(words[7]) == reader.wordEmbedding(words[7]));
+        BOOST_CHECK(shardedReader.wordEmbedding("missing") == std::vector<float>(DIM, 0.0f));
+    }
+}
+
+} // namespace
+
+BOOST_AUTO_TEST_SUITE(shardedReader)
+
+BOOST_AUTO_TEST_CASE(hashShardsWork)
+{
+    ShardedBuilder builder(DIM, "full", 8, 3);
+    shardedReaderTestImpl(builder, 3);
+}
+
+BOOST_AUTO_TEST_CASE(rangeShardsWork)
+{
+    ShardedBuilder builder(DIM, "full", 8, std::vector<std::string>{"", "word3", "word6"});
+    shardedReaderTestImpl(builder, 3);
+
+    auto manifest = ShardManifest::load(MANIFEST_FILENAME);
+    BOOST_CHECK_EQUAL(manifest.shardIndex("a"), 0);
+    BOOST_CHECK_EQUAL(manifest.shardIndex("word3"), 1);
+    BOOST_CHECK_EQUAL(manifest.shardIndex("word700"), 2);
+}
+
+BOOST_AUTO_TEST_CASE(invalidManifestThrows)
+{
+    BOOST_CHECK_THROW(
+        ShardedBuilder(DIM, "full", 8, std::vector<std::string>{"a", "b"}),
+        std::runtime_error);
+    BOOST_CHECK_THROW(
+        ShardedBuilder(DIM, "full", 8, std::vector<std::string>{"", "b", "b"}),
+        std::runtime_error);
+    BOOST_CHECK_THROW(ShardedBuilder(DIM, "full", 8, 0), std::runtime_error);
+
+    {
+        std::ofstream f(MANIFEST_FILENAME);
+        f << R"({"dim": 8, "partitioning": "modulo", "shards": [{"path": "single.bin"}]})";
+    }
+    BOOST_CHECK_THROW(ShardedReader reader(MANIFEST_FILENAME), std::runtime_error);
+
+    {
+        std::ofstream f(MANIFEST_FILENAME);
+        f << R"({"dim": 16, "shards": [{"path": "single.bin"}]})";
+    }
+    BOOST_CHECK_THROW(ShardedReader reader(MANIFEST_FILENAME), std::runtime_error);
+}
+
+BOOST_AUTO_TEST_SUITE_END()
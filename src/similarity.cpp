@@ -0,0 +1,223 @@
+#include "similarity.h"
+#include "compression_strategy.h"
+
+#include <boost/format.hpp>
+
+#include <algorithm>
+#include <cmath>
+#include <limits>
+#include <mutex>
+#include <numeric>
+#include <stdexcept>
+
+#if defined(__SSE2__) || defined(_M_X64)
+#include <emmintrin.h>
+#endif
+
+namespace memb {
+
+namespace {
+
+const size_t SCAN_BLOCK_SIZE = 1024;
+
+} // namespace
+
+SimilarityMetric parseSimilarityMetric(const std::string& name)
+{
+    if (name == "dot") {
+        return SimilarityMetric::Dot;
+    } else if (name == "cosine") {
+        return SimilarityMetric::Cosine;
+    } else if (name == "l2") {
+        return SimilarityMetric::L2;
+    }
+
+    throw std::runtime_error(boost::str(
+        boost::format("Unknown similarity metric %1%") % name));
+}
+
+float similarityScore(SimilarityMetric metric, float dot, float querySquaredNorm, float vectorSquaredNorm)
+{
+    switch (metric) {
+    case SimilarityMetric::Cosine:
+        return vectorSquaredNorm > 0 ? dot / std::sqrt(vectorSquaredNorm) : 0;
+    case SimilarityMetric::L2:
+        return 2 * dot - querySquaredNorm - vectorSquaredNorm;
+    default:
+        return dot;
+    }
+}
+
+float pairSimilarity(SimilarityMetric metric, float dot, float firstSquaredNorm, float secondSquaredNorm)
+{
+    switch (metric) {
+    case SimilarityMetric::Cosine: {
+        float normsProduct = std::sqrt(firstSquaredNorm * secondSquaredNorm);
+        return normsProduct > 0 ? dot / normsProduct : 0;
+    }
+    case SimilarityMetric::L2:
+        return std::sqrt(std::max(firstSquaredNorm + secondSquaredNorm - 2 * dot, 0.0f));
+    default:
+        return dot;
+    }
+}
+
+TopK::TopK(size_t k):
+    k_(k),
+    threshold_(-std::numeric_limits<float>::infinity())
+{
+    candidates_.reserve(2 * k_);
+}
+
+float TopK::threshold() const
+{
+    return threshold_;
+}
+
+void TopK::push(int64_t wordId, float score)
+{
+    if (score <= threshold_ || k_ == 0) {
+        return;
+    }
+
+    candidates_.push_back({wordId, score});
+    if (candidates_.size() == 2 * k_) {
+        compact();
+    }
+}
+
+void TopK::pushBatch(const uint32_t* wordIds, const float* scores, size_t count)
+{
+    size_t i = 0;
+#if defined(__SSE2__) || defined(_M_X64)
+    // Once the threshold settles almost no score passes it, so eight
+    // scores are rejected with two comparisons and a single branch
+    for (; i + 8 <= count; i += 8) {
+        __m128 threshold = _mm_set1_ps(threshold_);
+        int mask = _mm_movemask_ps(_mm_cmpgt_ps(_mm_loadu_ps(scores + i), threshold)) |
+            (_mm_movemask_ps(_mm_cmpgt_ps(_mm_loadu_ps(scores + i + 4), threshold)) << 4);
+        for (size_t lane = 0; mask; ++lane, mask >>= 1) {
+            if (mask & 1) {
+                push(wordIds[i + lane], scores[i + lane]);
+            }
+        }
+    }
+#endif
+    for (; i < count; ++i) {
+        if (scores[i] > threshold_) {
+            push(wordIds[i], scores[i]);
+        }
+    }
+}
+
+void TopK::merge(const TopK& other)
+{
+    for (const auto& candidate : other.candidates_) {
+        push(candidate.wordId, candidate.score);
+    }
+}
+
+std::vector<Neighbour> TopK::result(SimilarityMetric metric) const
+{
+    auto result = candidates_;
+    std::sort(
+        result.begin(),
+        result.end(),
+        [](const Neighbour& lhs, const Neighbour& rhs)
+        {
+            return lhs.score > rhs.score || (lhs.score == rhs.score && lhs.wordId < rhs.wordId);
+        });
+    result.resize(std::min(result.size(), k_));
+
+    if (metric == SimilarityMetric::L2) {
+        for (auto& neighbour : result) {
+            neighbour.score = std::sqrt(std::max(-neighbour.score, 0.0f));
+        }
+    }
+
+    return result;
+}
+
+void TopK::compact()
+{
+    std::nth_element(
+        candidates_.begin(),
+        candidates_.begin() + k_ - 1,
+        candidates_.end(),
+        [](const Neighbour& lhs, const Neighbour& rhs)
+        {
+            return lhs.score > rhs.score;
+        });
+    candidates_.resize(k_);
+    threshold_ = candidates_.back().score;
+}
+
+std::vector<float> prepareQueries(
+    const float* queries, size_t queriesCount, size_t dim, SimilarityMetric metric)
+{
+    std::vector<float> result(queries, queries + queriesCount * dim);
+    if (metric == SimilarityMetric::Cosine) {
+        for (size_t query = 0; query < queriesCount; ++query) {
+            auto begin = result.begin() + query * dim;
+            auto norm = std::sqrt(std::inner_product(begin, begin + dim, begin, 0.0f));
+            if (norm > 0) {
+                std::transform(begin, begin + dim, begin, [norm](float value) { return value / norm; });
+            }
+        }
+    }
+
+    return result;
+}
+
+std::vector<std::vector<Neighbour>> findMostSimilar(
+    const CompressedStorage& storage,
+    Executor* executor,
+    const float* queries,
+    size_t queriesCount,
+    size_t dim,
+    size_t k,
+    SimilarityMetric metric)
+{
+    auto preparedQueries = prepareQueries(queries, queriesCount, dim, metric);
+    auto scoringQueries = storage.prepareScoring(preparedQueries.data(), queriesCount, dim);
+    std::vector<TopK> result(queriesCount, TopK(k));
+    std::mutex resultMutex;
+
+    parallelFor(
+        executor,
+        storage.size(),
+        SCAN_BLOCK_SIZE,
+        [&](size_t beginWordId, size_t endWordId)
+        {
+            std::vector<TopK> jobResult(queriesCount, TopK(k));
+            std::vector<float> scores(queriesCount * SCAN_BLOCK_SIZE);
+            std::vector<uint32_t> wordIds(SCAN_BLOCK_SIZE);
+
+            for (size_t blockBegin = beginWordId; blockBegin < endWordId; blockBegin += SCAN_BLOCK_SIZE) {
+                size_t blockSize = std::min(blockBegin + SCAN_BLOCK_SIZE, endWordId) - blockBegin;
+                std::iota(wordIds.begin(), wordIds.begin() + blockSize, blockBegin);
+                storage.scoreBatch(scoringQueries, metric, wordIds.data(), blockSize, scores.data());
+
+                for (size_t query = 0; query < queriesCount; ++query) {
+                    auto& topK = jobResult[query];
+                    const float* queryScores = scores.data() + query * blockSize;
+                    topK.pushBatch(wordIds.data(), queryScores, blockSize);
+                }
+            }
+
+            std::lock_guard<std::mutex> lock(resultMutex);
+            for (size_t query = 0; query < queriesCount; ++query) {
+                result[query].merge(jobResult[query]);
+            }
+        });
+
+    std::vector<std::vector<Neighbour>> neighbours;
+    neighbours.reserve(queriesCount);
+    for (const auto& topK : result) {
+        neighbours.push_back(topK.result(metric));
+    }
+
+    return neighbours;
+}
+
+}
@@ -0,0 +1,73 @@
+#pragma once
+
+#include "executor.h"
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+namespace memb {
+
+class CompressedStorage;
+
+enum class SimilarityMetric {
+    Dot,
+    Cosine,
+    L2
+};
+
+SimilarityMetric parseSimilarityMetric(const std::string& name);
+
+// Larger is more similar for every metric, L2 yields negated squared distance.
+// For cosine the query is expected to be normalized.
+float similarityScore(SimilarityMetric metric, float dot, float querySquaredNorm, float vectorSquaredNorm);
+
+// Metric value for a pair of vectors: dot product, cosine similarity
+// (zero if any vector is zero) or euclidean distance
+float pairSimilarity(SimilarityMetric metric, float dot, float firstSquaredNorm, float secondSquaredNorm);
+
+struct Neighbour {
+    int64_t wordId;
+    // Dot product, cosine similarity or euclidean distance
+    float score;
+};
+
+// Keeps k best scores seen so far. Scores below the current
+// threshold are rejected with a single comparison.
+class TopK {
+public:
+    explicit TopK(size_t k);
+
+    float threshold() const;
+    void push(int64_t wordId, float score);
+    // Pushes scores of a block of words, skipping whole groups of them below the threshold
+    void pushBatch(const uint32_t* wordIds, const float* scores, size_t count);
+    void merge(const TopK& other);
+
+    // Sorted from the most similar, scores converted back to metric values
+    std::vector<Neighbour> result(SimilarityMetric metric) const;
+
+private:
+    void compact();
+
+    size_t k_;
+    float threshold_;
+    std::vector<Neighbour> candidates_;
+};
+
+// Copy of the queries, normalized for cosine metric
+std::vector<float> prepareQueries(
+    const float* queries, size_t queriesCount, size_t dim, SimilarityMetric metric);
+
+// Exhaustive search of k most similar vectors for every query, queries are stored
+// row by row. Vocabulary is scanned in blocks that are distributed over the executor.
+std::vector<std::vector<Neighbour>> findMostSimilar(
+    const CompressedStorage& storage,
+    Executor* executor,
+    const float* queries,
+    size_t queriesCount,
+    size_t dim,
+    size_t k,
+    SimilarityMetric metric);
+
+}
@@ -0,0 +1,140 @@
+#include "benchmark.h"
+#include "reader.h"
+
+#include <boost/test/unit_test.hpp>
+
+#include <cmath>
+#include <numeric>
+#include <random>
+
+using namespace memb;
+
+namespace {
+
+const std::string BENCHMARK_MODEL_FILENAME = "benchmark.bin";
+const size_t WORDS_COUNT = 50000;
+const size_t DIM = 300;
+const size_t K = 10;
+
+} // namespace
+
+BOOST_AUTO_TEST_SUITE(similaritySearch)
+
+BOOST_AUTO_TEST_CASE(bruteForceTopK)
+{
+    createBenchmarkModel(BENCHMARK_MODEL_FILENAME, WORDS_COUNT, DIM);
+    Reader reader(BENCHMARK_MODEL_FILENAME, 1);
+
+    for (size_t queriesCount : {1, 16}) {
+        auto suffix = " (" + std::to_string(queriesCount) + " queries)";
+
+        std::vector<float> queries(queriesCount * DIM);
+        for (size_t query = 0; query < queriesCount; ++query) {
+            reader.embeddingByIdToBuffer(query * 997, queries.data() + query * DIM);
+        }
+
+        auto decodeSeconds = measureSeconds(
+            [&]()
+            {
+                std::vector<int64_t> wordIds(reader.size());
+                std::iota(wordIds.begin(), wordIds.end(), 0);
+                auto vectors = reader.batchEmbeddingByIds(wordIds);
+
+                for (size_t query = 0; query < queriesCount; ++query) {
+                    std::vector<float> scores(reader.size());
+                    for (size_t wordId = 0; wordId < reader.size(); ++wordId) {
+                        scores[wordId] = std::inner_product(
+                            queries.begin() + query * DIM,
+                            queries.begin() + (query + 1) * DIM,
+                            vectors.begin() + wordId * DIM,
+                            0.0f);
+                    }
+                    std::partial_sort(scores.begin(), scores.begin() + K, scores.end(), std::greater<float>());
+                }
+            });
+        reportThroughput("decode all, then dot products" + suffix, queriesCount * WORDS_COUNT, decodeSeconds, "scores");
+
+        auto tableSeconds = measureSeconds(
+            [&]()
+            {
+                reader.batchMostSimilar(queries.data(), queriesCount, K, SimilarityMetric::Dot);
+            });
+        reportThroughput("scan with product tables" + suffix, queriesCount * WORDS_COUNT, tableSeconds, "scores");
+    }
+}
+
+BOOST_AUTO_TEST_CASE(topKThreshold)
+{
+    const size_t scoresCount = 16 * WORDS_COUNT;
+    std::mt19937 generator(42);
+    std::normal_distribution<float> distribution;
+    std::vector<uint32_t> wordIds(scoresCount);
+    std::vector<float> scores(scoresCount);
+    for (size_t i = 0; i < scoresCount; ++i) {
+        wordIds[i] = static_cast<uint32_t>(i);
+        scores[i] = distribution(generator);
+    }
+
+    auto singleSeconds = measureSeconds(
+        [&]()
+        {
+            TopK topK(K);
+            for (size_t i = 0; i < scoresCount; ++i) {
+                if (scores[i] > topK.threshold()) {
+                    topK.push(wordIds[i], scores[i]);
+                }
+            }
+        });
+    reportThroughput("score by score", scoresCount, singleSeconds, "scores");
+
+    auto batchSeconds = measureSeconds(
+        [&]()
+        {
+            TopK topK(K);
+            topK.pushBatch(wordIds.data(), scores.data(), scoresCount);
+        });
+    reportThroughput("batches of scores", scoresCount, batchSeconds, "scores");
+}
+
+BOOST_AUTO_TEST_CASE(pairSimilarity)
+{
+    createBenchmarkModel(BENCHMARK_MODEL_FILENAME, WORDS_COUNT, DIM);
+    Reader reader(BENCHMARK_MODEL_FILENAME, 1);
+
+    const size_t pairsCount = 200000;
+    std::mt19937 generator(42);
+    std::vector<int64_t> firstIds(pairsCount);
+    std::vector<int64_t> secondIds(pairsCount);
+    for (size_t i = 0; i < pairsCount; ++i) {
+        firstIds[i] = generator() % WORDS_COUNT;
+        secondIds[i] = generator() % WORDS_COUNT;
+    }
+
+    auto decodeSeconds = measureSeconds(
+        [&]()
+        {
+            std::vector<float> first(DIM);
+            std::vector<float> second(DIM);
+            std::vector<float> scores(pairsCount);
+            for (size_t i = 0; i < pairsCount; ++i) {
+                reader.embeddingByIdToBuffer(firstIds[i], first.data());
+                reader.embeddingByIdToBuffer(secondIds[i], second.data());
+                float dot = std::inner_product(first.begin(), first.end(), second.begin(), 0.0f);
+                float firstNorm = std::inner_product(first.begin(), first.end(), first.begin(), 0.0f);
+                float secondNorm = std::inner_product(second.begin(), second.end(), second.begin(), 0.0f);
+                scores[i] = dot / std::sqrt(firstNorm * secondNorm);
+            }
+        });
+    reportThroughput("decode pairs, then cosine", pairsCount, decodeSeconds, "pairs");
+
+    auto codesSeconds = measureSeconds(
+        [&]()
+        {
+            std::vector<float> scores(pairsCount);
+            reader.batchSimilarityByIdsToBuffer(
+                firstIds.data(), secondIds.data(), pairsCount, scores.data(), SimilarityMetric::Cosine);
+        });
+    reportThroughput("centroid products and stored norms", pairsCount, codesSeconds, "pairs");
+}
+
+BOOST_AUTO_TEST_SUITE_END()
@@ -0,0 +1,236 @@
+#include "reader.h"
+#include "test_utils.h"
+
+#include <boost/test/unit_test.hpp>
+
+#include <algorithm>
+#include <cmath>
+#include <numeric>
+#include <random>
+
+using namespace memb;
+
+namespace {
+
+const std::string SIMILARITY_MODEL_FILENAME = temporaryPath("similarity.bin");
+const size_t WORDS_COUNT = 3000;
+const size_t DIM = 16;
+const size_t K = 10;
+
+// Straightforward computation over decoded vectors
+std::vector<Neighbour> expectedNeighbours(
+    const std::vector<float>& vectors, const float* query, SimilarityMetric metric)
+{
+    std::vector<Neighbour> result;
+    for (size_t wordId = 0; wordId < vectors.size() / DIM; ++wordId) {
+        const float* values = vectors.data() + wordId * DIM;
+        float dot = std::inner_product(values, values + DIM, query, 0.0f);
+        float squaredNorm = std::inner_product(values, values + DIM, values, 0.0f);
+        float querySquaredNorm = std::inner_product(query, query + DIM, query, 0.0f);
+
+        float score = dot;
+        if (metric == SimilarityMetric::Cosine) {
+            score = dot / std::sqrt(squaredNorm * querySquaredNorm);
+        } else if (metric == SimilarityMetric::L2) {
+            score = -std::sqrt(querySquaredNorm - 2 * dot + squaredNorm);
+        }
+        result.push_back({static_cast<int64_t>(wordId), score});
+    }
+
+    std::sort(
+        result.begin(),
+        result.end(),
+        [](const Neighbour& lhs, const Neighbour& rhs)
+        {
+            return lhs.score > rhs.score;
+        });
+    result.resize(K);
+
+    if (metric == SimilarityMetric::L2) {
+        for (auto& neighbour : result) {
+            neighbour.score = -neighbour.score;
+        }
+    }
+
+    return result;
+}
+
+void mostSimilarTestImpl(const std::string& storageName)
+{
+    buildModel(randomModel(DIM, WORDS_COUNT, 42), SIMILARITY_MODEL_FILENAME, storageName, 8);
+
+    std::vector<float> queries;
+    for (const auto& vector : randomModel(DIM, 5, 43).vectors) {
+        queries.insert(queries.end(), vector.begin(), vector.end());
+    }
+
+    for (size_t numThreads : {1, 4}) {
+        Reader reader(SIMILARITY_MODEL_FILENAME, numThreads);
+
+        std::vector<float> decodedVectors(reader.size() * DIM);
+        for (size_t wordId = 0; wordId < reader.size(); ++wordId) {
+            reader.embeddingByIdToBuffer(wordId, decodedVectors.data() + wordId * DIM);
+        }
+
+        for (auto metric : {SimilarityMetric::Dot, SimilarityMetric::Cosine, SimilarityMetric::L2}) {
+            auto neighbours = reader.batchMostSimilar(queries.data(), 5, K, metric);
+            BOOST_REQUIRE(neighbours.size() == 5);
+
+            for (size_t query = 0; query < 5; ++query) {
+                auto expected = expectedNeighbours(decodedVectors, queries.data() + query * DIM, metric);
+                BOOST_REQUIRE(neighbours[query].size() == K);
+                for (size_t i = 0; i < K; ++i) {
+                    BOOST_CHECK_EQUAL(neighbours[query][i].wordId, expected[i].wordId);
+                    BOOST_CHECK_CLOSE_FRACTION(neighbours[query][i].score, expected[i].score, 1e-3);
+                }
+            }
+        }
+
+        auto wordNeighbours = reader.mostSimilar("word7", K);
+        BOOST_CHECK_EQUAL(wordNeighbours.size(), K);
+        for (const auto& neighbour : wordNeighbours) {
+            BOOST_CHECK(neighbour.wordId != reader.wordId("word7"));
+        }
+        BOOST_CHECK(reader.mostSimilar("missing", K).empty());
+    }
+}
+
+void pairSimilarityTestImpl(const std::string& storageName)
+{
+    buildModel(randomModel(DIM, WORDS_COUNT, 43), SIMILARITY_MODEL_FILENAME, storageName, 8);
+
+    Reader reader(SIMILARITY_MODEL_FILENAME, 4);
+
+    std::mt19937 generator(43);
+
+    std::vector<std::string> firstWords;
+    std::vector<std::string> secondWords;
+    for (size_t i = 0; i < 500; ++i) {
+        firstWords.push_back("word" + std::to_string(generator() % WORDS_COUNT));
+        secondWords.push_back("word" + std::to_string(generator() % WORDS_COUNT));
+    }
+    secondWords.back() = "missing";
+
+    for (auto metric : {SimilarityMetric::Dot, SimilarityMetric::Cosine, SimilarityMetric::L2}) {
+        auto scores = reader.batchSimilarity(firstWords, secondWords, metric);
+        BOOST_REQUIRE(scores.size() == firstWords.size());
+
+        for (size_t i = 0; i < firstWords.size(); ++i) {
+            auto first = reader.wordEmbedding(firstWords[i]);
+            auto second = reader.wordEmbedding(secondWords[i]);
+            float dot = std::inner_product(first.begin(), first.end(), second.begin(), 0.0f);
+            float firstSquaredNorm = std::inner_product(first.begin(), first.end(), first.begin(), 0.0f);
+            float secondSquaredNorm = std::inner_product(second.begin(), second.end(), second.begin(), 0.0f);
+
+            float expected = dot;
+            if (metric == SimilarityMetric::Cosine) {
+                expected = secondSquaredNorm > 0 ? dot / std::sqrt(firstSquaredNorm * secondSquaredNorm) : 0;
+            } else if (metric == SimilarityMetric::L2) {
+                expected = std::sqrt(firstSquaredNorm - 2 * dot + secondSquaredNorm);
+            }
+            BOOST_CHECK_SMALL(scores[i] - expected, 1e-3f * std::max(1.0f, std::abs(expected)));
+        }
+    }
+
+    BOOST_CHECK_CLOSE_FRACTION(reader.similarity("word3", "word3"), 1.0f, 1e-5);
+    BOOST_CHECK_EQUAL(reader.similarity("word3", "missing"), 0.0f);
+    BOOST_CHECK_THROW(reader.similarityById(0, WORDS_COUNT), std::runtime_error);
+    BOOST_CHECK_THROW(reader.batchSimilarity({"word1"}, {}), std::runtime_error);
+}
+
+} // namespace
+
+BOOST_AUTO_TEST_SUITE(similarity)
+
+BOOST_AUTO_TEST_CASE(topKKeepsBestScores)
+{
+    TopK topK(3);
+    for (int64_t i = 0; i < 100; ++i) {
+        topK.push(i, static_cast<float>((i * 37) % 100));
+    }
+
+    auto result = topK.result(SimilarityMetric::Dot);
+    BOOST_REQUIRE(result.size() == 3);
+    BOOST_CHECK_EQUAL(result[0].score, 99);
+    BOOST_CHECK_EQUAL(result[1].score, 98);
+    BOOST_CHECK_EQUAL(result[2].score, 97);
+    BOOST_CHECK_EQUAL(result[0].wordId, 27);
+}
+
+BOOST_AUTO_TEST_CASE(topKBatchesMatchSinglePushes)
+{
+    std::mt19937 generator(42);
+    std::normal_distribution<float> distribution;
+    std::vector<uint32_t> wordIds(1003);
+    std::vector<float> scores(wordIds.size());
+    for (size_t i = 0; i < wordIds.size(); ++i) {
+        wordIds[i] = static_cast<uint32_t>(wordIds.size() - i);
+        scores[i] = distribution(generator);
+    }
+
+    TopK single(10);
+    TopK batched(10);
+    for (size_t i = 0; i < wordIds.size(); ++i) {
+        single.push(wordIds[i], scores[i]);
+    }
+    // Odd sizes leave scores for the scalar tail
+    for (size_t begin = 0; begin < wordIds.size(); begin += 101) {
+        size_t count = std::min<size_t>(101, wordIds.size() - begin);
+        batched.pushBatch(wordIds.data() + begin, scores.data() + begin, count);
+    }
+
+    auto expected = single.result(SimilarityMetric::Dot);
+    auto actual = batched.result(SimilarityMetric::Dot);
+    BOOST_REQUIRE_EQUAL(actual.size(), expected.size());
+    for (size_t i = 0; i < expected.size(); ++i) {
+        BOOST_CHECK_EQUAL(actual[i].wordId, expected[i].wordId);
+        BOOST_CHECK_EQUAL(actual[i].score, expected[i].score);
+    }
+}
+
+BOOST_AUTO_TEST_CASE(trainedMostSimilarWorks)
+{
+    mostSimilarTestImpl("trained");
+}
+
+BOOST_AUTO_TEST_CASE(ansMostSimilarWorks)
+{
+    mostSimilarTestImpl("ans");
+}
+
+BOOST_AUTO_TEST_CASE(packedMostSimilarWorks)
+{
+    mostSimilarTestImpl("packed");
+}
+
+BOOST_AUTO_TEST_CASE(fullMostSimilarWorks)
+{
+    mostSimilarTestImpl("full");
+}
+
+BOOST_AUTO_TEST_CASE(trainedPairSimilarityWorks)
+{
+    pairSimilarityTestImpl("trained");
+}
+
+BOOST_AUTO_TEST_CASE(ansPairSimilarityWorks)
+{
+    pairSimilarityTestImpl("ans");
+}
+
+BOOST_AUTO_TEST_CASE(packedPairSimilarityWorks)
+{
+    pairSimilarityTestImpl("packed");
+}
+
+BOOST_AUTO_TEST_CASE(fullPairSimilarityWorks)
+{
+    pairSimilarityTestImpl("full");
+}
+
+BOOST_AUTO_TEST_CASE(unknownMetricThrows)
+{
+    BOOST_CHECK_THROW(parseSimilarityMetric("manhattan"), std::runtime_error);
+}
+
+BOOST_AUTO_TEST_SUITE_END()
@@ -0,0 +1,61 @@
+#pragma once
+
+#include "builder.h"
+
+#include <cstdlib>
+#include <random>
+#include <string>
+#include <vector>
+
+namespace memb {
+
+// Files written by the tests go to the temporary directory
+inline std::string temporaryPath(const std::string& filename)
+{
+#ifdef _WIN32
+    const char* directory = std::getenv("TEMP");
+#else
+    const char* directory = std::getenv("TMPDIR");
+#endif
+    return std::string(directory ? directory : "/tmp") + "/" + filename;
+}
+
+struct TestModel {
+    size_t dim;
+    std::vector<std::string> words;
+    std::vector<std::vector<float>> vectors;
+};
+
+// Words "word0", "word1", ... with vectors of normally distributed values
+inline TestModel randomModel(size_t dim, size_t count, size_t seed)
+{
+    std::mt19937 generator(seed);
+    std::normal_distribution<float> distribution;
+
+    TestModel result{dim, {}, {}};
+    for (size_t i = 0; i < count; ++i) {
+        result.words.push_back("word" + std::to_string(i));
+        result.vectors.emplace_back(dim);
+        for (auto& value : result.vectors.back()) {
+            value = distribution(generator);
+        }
+    }
+
+    return result;
+}
+
+inline void buildModel(
+    const TestModel& model,
+    const std::string& filename,
+    const std::string& storageName,
+    size_t bitsPerWeight,
+    const CompressionOptions& options = CompressionOptions())
+{
+    Builder builder(model.dim, storageName, bitsPerWeight, options);
+    for (size_t i = 0; i < model.words.size(); ++i) {
+        builder.addWord(model.words[i], model.vectors[i]);
+    }
+    builder.save(filename);
+}
+
+}
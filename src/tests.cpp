@@ -1,16 +1,27 @@
 #include "builder.h"
 #include "reader.h"
+#include "packed_compression.h"
+#include "test_utils.h"
 #include "trained_compression.h"
+#include "thread_pool.h"
 
+#include <algorithm>
+#include <random>
 #include <sstream>
 #include <fstream>
 
+#ifndef _WIN32
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <unistd.h>
+#endif
+
 #define BOOST_AUTO_TEST_MAIN
 #include <boost/test/unit_test.hpp>
 
 using namespace memb;
 
-const std::string STORAGE_FILENAME = "data.bin";
+const std::string STORAGE_FILENAME = temporaryPath("data.bin");
 
 struct WordVector {
     std::string word;
@@ -26,11 +37,14 @@ std::vector<WordVector> testVectors = {
     {"abc", {-2.0, 0.0, 1.0}},
 };
 
-void builderTestImpl(wire::Storage storageType, std::shared_ptr<CompressionStrategy> compression)
+void builderTestImpl(
+    wire::Storage storageType,
+    std::shared_ptr<CompressionStrategy> compression,
+    const CompressionOptions& options = CompressionOptions())
 {
     std::vector<std::string> expectedKeys;
 
-    Builder builder(3, storageType, 8);
+    Builder builder(3, storageType, 8, options);
     for (const auto& wordVector : testVectors) {
         builder.addWord(wordVector.word, wordVector.embedding);
         expectedKeys.push_back(wordVector.word);
@@ -42,6 +56,13 @@ void builderTestImpl(wire::Storage storageType, std::shared_ptr<CompressionStrat
     Reader reader(STORAGE_FILENAME, compression);
     BOOST_REQUIRE(expectedKeys == reader.keys());
 
+    auto vocabulary = reader.vocabulary();
+    BOOST_REQUIRE(vocabulary.size() == expectedKeys.size());
+    BOOST_CHECK(std::equal(expectedKeys.begin(), expectedKeys.end(), vocabulary.begin(), vocabulary.end()));
+    BOOST_CHECK(vocabulary.end() - vocabulary.begin() == static_cast<ptrdiff_t>(expectedKeys.size()));
+    BOOST_CHECK(vocabulary[1] == expectedKeys[1]);
+    BOOST_CHECK(*(vocabulary.begin() + 2) == expectedKeys[2]);
+
     for (const auto& wordVector : testVectors) {
         auto embedding = reader.wordEmbedding(wordVector.word);
         BOOST_REQUIRE(embedding.size() == wordVector.embedding.size());
@@ -50,10 +71,33 @@ void builderTestImpl(wire::Storage storageType, std::shared_ptr<CompressionStrat
         }
     }
 
-    auto missingEmbedding = reader.wordEmbedding("o");
-    for (auto item: missingEmbedding) {
-        BOOST_REQUIRE(item == 0.0);
+    for (const auto& missingWord : {"o", "zzz", ""}) {
+        auto missingEmbedding = reader.wordEmbedding(missingWord);
+        for (auto item: missingEmbedding) {
+            BOOST_REQUIRE(item == 0.0);
+        }
+    }
+
+    BOOST_REQUIRE(reader.size() == expectedKeys.size());
+
+    auto idsQuery = expectedKeys;
+    idsQuery.push_back("zzz");
+    auto wordIds = reader.batchWordIds(idsQuery);
+    BOOST_CHECK_EQUAL(wordIds.back(), CompressedStorage::MISSING_WORD);
+    wordIds.pop_back();
+
+    for (size_t i = 0; i < expectedKeys.size(); ++i) {
+        BOOST_CHECK_EQUAL(wordIds[i], i);
+        BOOST_CHECK_EQUAL(reader.wordId(expectedKeys[i]), i);
+        BOOST_CHECK(reader.embeddingById(i) == reader.wordEmbedding(expectedKeys[i]));
     }
+
+    wordIds.push_back(CompressedStorage::MISSING_WORD);
+    auto embeddings = reader.batchEmbeddingByIds(wordIds);
+    auto expectedEmbeddings = reader.batchEmbedding(idsQuery);
+    BOOST_CHECK(embeddings == expectedEmbeddings);
+
+    BOOST_CHECK_THROW(reader.embeddingById(expectedKeys.size()), std::runtime_error);
 }
 
 BOOST_AUTO_TEST_SUITE(compressionStrategies)
@@ -76,9 +120,11 @@ BOOST_AUTO_TEST_CASE(trainedBuilderWorks)
 class TestTrainedCompressionStrategy : public TrainedCompressionStrategy {
 public:
     virtual std::shared_ptr<CompressedStorage> createCompressedStorage(
-        const void* flatIndex, size_t dim) const override
+        const void* flatIndex, size_t dim, const DecodingOptions& options) const override
     {
-        return std::make_shared<TrainedCompressedStorage>(flatIndex, dim, 1);
+        auto indirectOptions = options;
+        indirectOptions.decodeTableBits = 1;
+        return std::make_shared<TrainedCompressedStorage>(flatIndex, dim, indirectOptions);
     }
 };
 
@@ -87,7 +133,338 @@ BOOST_AUTO_TEST_CASE(trainedBuilderWorksWithIndirectDecoder)
     builderTestImpl(wire::Storage_Trained, std::make_shared<TestTrainedCompressionStrategy>());
 }
 
-BOOST_AUTO_TEST_CASE(threadedDecoderWorks)
+BOOST_AUTO_TEST_CASE(trainedBuilderWorksWithPerfectHashIndex)
+{
+    CompressionOptions options;
+    options.perfectHashIndex = true;
+    builderTestImpl(wire::Storage_Trained, createCompressionStrategy(wire::Storage_Trained), options);
+}
+
+BOOST_AUTO_TEST_CASE(trainedBuilderWorksWithSearchTree)
+{
+    CompressionOptions options;
+    options.searchTree = true;
+    builderTestImpl(wire::Storage_Trained, createCompressionStrategy(wire::Storage_Trained), options);
+}
+
+BOOST_AUTO_TEST_CASE(ansBuilderWorks)
+{
+    builderTestImpl(wire::Storage_Ans, createCompressionStrategy(wire::Storage_Ans));
+}
+
+BOOST_AUTO_TEST_CASE(ansBuilderWorksWithPerfectHashIndex)
+{
+    CompressionOptions options;
+    options.perfectHashIndex = true;
+    builderTestImpl(wire::Storage_Ans, createCompressionStrategy(wire::Storage_Ans), options);
+}
+
+BOOST_AUTO_TEST_CASE(packedBuilderWorks)
+{
+    builderTestImpl(wire::Storage_Packed, createCompressionStrategy(wire::Storage_Packed));
+}
+
+BOOST_AUTO_TEST_CASE(packedBuilderWorksWithPerfectHashIndex)
+{
+    CompressionOptions options;
+    options.perfectHashIndex = true;
+    builderTestImpl(wire::Storage_Packed, createCompressionStrategy(wire::Storage_Packed), options);
+}
+
+BOOST_AUTO_TEST_CASE(packedStorageKeepsFixedWidthCodes)
+{
+    const size_t dim = 37;
+    auto source = randomModel(dim, 100, 5);
+
+    for (size_t bitsPerWeight = 0; bitsPerWeight <= 9; ++bitsPerWeight) {
+        size_t bitsPerCode = std::min<size_t>(8, std::max<size_t>(1, bitsPerWeight));
+        buildModel(source, STORAGE_FILENAME, "packed", bitsPerWeight);
+
+        std::ifstream modelFile(STORAGE_FILENAME, std::ios::binary);
+        std::string model((std::istreambuf_iterator<char>(modelFile)), std::istreambuf_iterator<char>());
+        auto storage = wire::GetIndex(model.data())->storage_as_Packed();
+        BOOST_CHECK_EQUAL(storage->bits_per_code(), bitsPerCode);
+        auto centroids = storage->clusterizer()->centroids();
+
+        Reader reader(STORAGE_FILENAME);
+        for (size_t wordId = 0; wordId < reader.size(); ++wordId) {
+            const uint8_t* data = storage->packed_values()->data() + storage->value_offsets()->Get(wordId);
+            auto embedding = reader.embeddingById(wordId);
+            for (size_t i = 0; i < dim; ++i) {
+                size_t code = 0;
+                for (size_t bit = i * bitsPerCode; bit < (i + 1) * bitsPerCode; ++bit) {
+                    code = (code << 1) | ((data[bit / 8] >> (7 - bit % 8)) & 1);
+                }
+                BOOST_CHECK_EQUAL(embedding[i], centroids->Get(code));
+            }
+        }
+        BOOST_CHECK_EQUAL(
+            storage->packed_values()->size(),
+            source.words.size() * ((dim * bitsPerCode + 7) / 8) + BitStreamReader::PADDING_BYTES);
+    }
+}
+
+BOOST_AUTO_TEST_CASE(packedStorageRejectsUnsupportedWidths)
+{
+    for (uint8_t bitsPerCode : {0, 9}) {
+        flatbuffers::FlatBufferBuilder builder;
+        auto storage = wire::CreatePacked(
+            builder,
+            builder.CreateVector(std::vector<uint32_t>{0}),
+            builder.CreateVector(std::vector<uint32_t>{0}),
+            builder.CreateString(std::string("word", 5)),
+            builder.CreateVector(std::vector<uint8_t>(16, 0)),
+            bitsPerCode,
+            wire::CreateKMeansClusterizer(builder, builder.CreateVector(std::vector<float>{0.0f, 1.0f})));
+        builder.Finish(storage);
+
+        BOOST_CHECK_THROW(
+            PackedCompressedStorage(flatbuffers::GetRoot<wire::Packed>(builder.GetBufferPointer()), 1),
+            std::runtime_error);
+    }
+}
+
+BOOST_AUTO_TEST_CASE(trainedBuilderWorksWithInterleavedStreams)
+{
+    for (size_t streams : {2, 4, 8}) {
+        CompressionOptions options;
+        options.huffmanStreams = streams;
+        builderTestImpl(wire::Storage_Trained, createCompressionStrategy(wire::Storage_Trained), options);
+        builderTestImpl(wire::Storage_Trained, std::make_shared<TestTrainedCompressionStrategy>(), options);
+    }
+
+    CompressionOptions options;
+    options.huffmanStreams = 3;
+    BOOST_CHECK_THROW(Builder(3, wire::Storage_Trained, 8, options), std::runtime_error);
+}
+
+BOOST_AUTO_TEST_CASE(interleavedStreamsDecodeSameValues)
+{
+    auto model = randomModel(37, 500, 42);
+    const auto& words = model.words;
+
+    std::vector<float> expected;
+    for (size_t streams : {1, 2, 4, 8}) {
+        CompressionOptions options;
+        options.huffmanStreams = streams;
+        buildModel(model, STORAGE_FILENAME, "trained", 4, options);
+
+        auto embeddings = Reader(STORAGE_FILENAME, 1).batchEmbedding(words);
+        if (expected.empty()) {
+            expected = embeddings;
+        }
+        BOOST_CHECK(embeddings == expected);
+
+        for (size_t decodeTableBits : {4, 12}) {
+            for (size_t symbolsPerLookup : {2, 4}) {
+                ReaderOptions readerOptions;
+                readerOptions.decoding.decodeTableBits = decodeTableBits;
+                readerOptions.decoding.symbolsPerLookup = symbolsPerLookup;
+                BOOST_CHECK(Reader(STORAGE_FILENAME, readerOptions).batchEmbedding(words) == expected);
+            }
+        }
+    }
+}
+
+BOOST_AUTO_TEST_CASE(codebookBlocksDecodeSameValues)
+{
+    const size_t dim = 37;
+    auto source = randomModel(dim, 500, 7);
+    const auto& words = source.words;
+    // Dimensions with different scales get different codebooks
+    for (auto& vector : source.vectors) {
+        for (size_t j = 0; j < dim; ++j) {
+            vector[j] *= 1 + j % 5;
+        }
+    }
+
+    std::vector<float> expected;
+    for (size_t streams : {1, 4}) {
+        for (size_t blocks : {1, 3, 8, 100}) {
+            CompressionOptions options;
+            options.huffmanStreams = streams;
+            options.codebookBlocks = blocks;
+            buildModel(source, STORAGE_FILENAME, "trained", 4, options);
+
+            std::ifstream modelFile(STORAGE_FILENAME, std::ios::binary);
+            std::string model((std::istreambuf_iterator<char>(modelFile)), std::istreambuf_iterator<char>());
+            auto storage = wire::GetIndex(model.data())->storage_as_Trained();
+            if (blocks == 1) {
+                BOOST_CHECK(storage->block_decoders() == nullptr);
+            } else {
+                size_t blockSize = storage->codebook_block_size();
+                BOOST_CHECK_EQUAL(blockSize % streams, 0);
+                BOOST_CHECK_LE(storage->block_decoders()->size(), blocks);
+                BOOST_CHECK_EQUAL(storage->block_decoders()->size(), (dim + blockSize - 1) / blockSize);
+            }
+
+            auto embeddings = Reader(STORAGE_FILENAME, 1).batchEmbedding(words);
+            if (expected.empty()) {
+                expected = embeddings;
+            }
+            BOOST_CHECK(embeddings == expected);
+
+            ReaderOptions readerOptions;
+            readerOptions.decoding.symbolsPerLookup = 3;
+            BOOST_CHECK(Reader(STORAGE_FILENAME, readerOptions).batchEmbedding(words) == expected);
+        }
+    }
+
+    CompressionOptions options;
+    options.codebookBlocks = 0;
+    BOOST_CHECK_THROW(Builder(3, wire::Storage_Trained, 8, options), std::runtime_error);
+}
+
+BOOST_AUTO_TEST_CASE(embeddingRangesMatchWholeVectors)
+{
+    const size_t dim = 37;
+    auto model = randomModel(dim, 200, 11);
+
+    struct Layout {
+        std::string storage;
+        size_t streams;
+        size_t blocks;
+        size_t checkpointInterval;
+    };
+    std::vector<Layout> layouts = {
+        {"full", 1, 1, 0},
+        {"uniform", 1, 1, 0},
+        {"ans", 1, 1, 0},
+        {"packed", 1, 1, 0},
+        {"trained", 1, 1, 0},
+        {"trained", 1, 1, 5},
+        {"trained", 1, 3, 8},
+        {"trained", 4, 1, 12},
+        {"trained", 2, 4, 6},
+        {"trained", 8, 1, 40}
+    };
+    std::vector<std::pair<size_t, size_t>> ranges = {
+        {0, dim}, {0, 1}, {5, 6}, {8, 20}, {11, 37}, {36, 37}, {37, 37}
+    };
+
+    for (const auto& layout : layouts) {
+        CompressionOptions options;
+        options.huffmanStreams = layout.streams;
+        options.codebookBlocks = layout.blocks;
+        options.checkpointInterval = layout.checkpointInterval;
+        buildModel(model, STORAGE_FILENAME, layout.storage, 4, options);
+
+        for (size_t symbolsPerLookup : {1, 3}) {
+            ReaderOptions readerOptions;
+            readerOptions.decoding.symbolsPerLookup = symbolsPerLookup;
+            Reader reader(STORAGE_FILENAME, readerOptions);
+            for (int64_t wordId = 0; wordId < static_cast<int64_t>(reader.size()); wordId += 7) {
+                auto expected = reader.embeddingById(wordId);
+                for (const auto& range : ranges) {
+                    auto embedding = reader.embeddingRangeById(wordId, range.first, range.second);
+                    BOOST_CHECK(std::equal(
+                        embedding.begin(),
+                        embedding.end(),
+                        expected.begin() + range.first,
+                        expected.begin() + range.second));
+                }
+            }
+
+            std::vector<int64_t> wordIds = {3, -1, 5};
+            std::vector<float> buffer(wordIds.size() * 4, 1.0f);
+            reader.batchEmbeddingRangeByIdsToBuffer(wordIds.data(), wordIds.size(), 30, 34, buffer.data());
+            auto expected = reader.embeddingById(5);
+            BOOST_CHECK(std::equal(buffer.begin() + 8, buffer.end(), expected.begin() + 30));
+            BOOST_CHECK(std::all_of(buffer.begin() + 4, buffer.begin() + 8, [](float value) { return value == 0; }));
+
+            BOOST_CHECK_THROW(reader.embeddingRangeById(0, 3, 2), std::runtime_error);
+            BOOST_CHECK_THROW(reader.embeddingRangeById(0, 0, dim + 1), std::runtime_error);
+        }
+    }
+
+    CompressionOptions options;
+    options.huffmanStreams = 4;
+    options.checkpointInterval = 6;
+    BOOST_CHECK_THROW(Builder(3, wire::Storage_Trained, 8, options), std::runtime_error);
+}
+
+BOOST_AUTO_TEST_CASE(storedDecodeTablesDecodeSameValues)
+{
+    const size_t dim = 37;
+    auto source = randomModel(dim, 500, 11);
+    const auto& words = source.words;
+
+    auto buildWithTables = [&](size_t streams, size_t blocks, size_t storedTableBits)
+    {
+        CompressionOptions options;
+        options.huffmanStreams = streams;
+        options.codebookBlocks = blocks;
+        options.decodeTableBits = storedTableBits;
+        buildModel(source, STORAGE_FILENAME, "trained", 6, options);
+    };
+
+    for (size_t streams : {1, 4}) {
+        for (size_t blocks : {1, 3}) {
+            // Other table bits and multi-symbol lookups build their own tables
+            std::vector<ReaderOptions> readerOptions;
+            for (size_t decodeTableBits : {8, 10}) {
+                for (size_t symbolsPerLookup : {1, 2}) {
+                    ReaderOptions options;
+                    options.decoding.decodeTableBits = decodeTableBits;
+                    options.decoding.symbolsPerLookup = symbolsPerLookup;
+                    readerOptions.push_back(options);
+                }
+            }
+
+            buildWithTables(streams, blocks, 0);
+            std::vector<std::vector<float>> expected;
+            for (const auto& options : readerOptions) {
+                expected.push_back(Reader(STORAGE_FILENAME, options).batchEmbedding(words));
+            }
+
+            buildWithTables(streams, blocks, 8);
+            std::ifstream modelFile(STORAGE_FILENAME, std::ios::binary);
+            std::string model((std::istreambuf_iterator<char>(modelFile)), std::istreambuf_iterator<char>());
+            auto storage = wire::GetIndex(model.data())->storage_as_Trained();
+            size_t codebooks = storage->block_decoders() ? storage->block_decoders()->size() : 1;
+            BOOST_REQUIRE(storage->decode_tables());
+            BOOST_CHECK_EQUAL(storage->decode_tables()->size(), codebooks);
+            BOOST_CHECK_EQUAL(storage->decode_tables()->Get(0)->table_bits(), 8);
+
+            for (size_t i = 0; i < readerOptions.size(); ++i) {
+                BOOST_CHECK(Reader(STORAGE_FILENAME, readerOptions[i]).batchEmbedding(words) == expected[i]);
+            }
+        }
+    }
+
+    CompressionOptions invalidOptions;
+    invalidOptions.decodeTableBits = 17;
+    BOOST_CHECK_THROW(Builder(dim, wire::Storage_Trained, 6, invalidOptions), std::runtime_error);
+}
+
+BOOST_AUTO_TEST_CASE(inconsistentDecodeTablesAreRejected)
+{
+    // Codes 0, 10 and 11 with a one bit table
+    auto loadTables = [](uint8_t directBits, uint32_t indirectOffset, uint8_t indirectBits, size_t maxCodeLength)
+    {
+        flatbuffers::FlatBufferBuilder builder;
+        std::vector<wire::HuffmanTableEntry> direct = {{1, directBits}};
+        std::vector<wire::HuffmanIndirectOffset> indirectOffsets = {{indirectOffset, indirectBits}};
+        std::vector<wire::HuffmanTableEntry> indirect = {{2, 1}, {3, 1}};
+        builder.Finish(wire::CreateHuffmanDecodeTables(
+            builder,
+            1,
+            builder.CreateVectorOfStructs(direct),
+            builder.CreateVectorOfStructs(indirectOffsets),
+            builder.CreateVectorOfStructs(indirect)));
+
+        HuffmanTableDecoder(flatbuffers::GetRoot<wire::HuffmanDecodeTables>(builder.GetBufferPointer()), maxCodeLength);
+    };
+
+    loadTables(1, 0, 1, 2);
+    BOOST_CHECK_THROW(loadTables(2, 0, 1, 2), std::runtime_error);
+    BOOST_CHECK_THROW(loadTables(1, 1, 1, 2), std::runtime_error);
+    BOOST_CHECK_THROW(loadTables(1, 0, 2, 2), std::runtime_error);
+    BOOST_CHECK_THROW(loadTables(1, 0, 1, 0), std::runtime_error);
+    BOOST_CHECK_THROW(loadTables(1, 0, 1, 17), std::runtime_error);
+}
+
+BOOST_AUTO_TEST_CASE(invalidDecodingOptionsAreRejected)
 {
     Builder builder(3, wire::Storage_Trained, 8);
     for (const auto& wordVector : testVectors) {
@@ -95,16 +472,92 @@ BOOST_AUTO_TEST_CASE(threadedDecoderWorks)
     }
     builder.save(STORAGE_FILENAME);
 
+    ReaderOptions options;
+    options.decoding.symbolsPerLookup = HuffmanTableDecoder::MAX_SYMBOLS_PER_LOOKUP + 1;
+    BOOST_CHECK_THROW(Reader(STORAGE_FILENAME, options), std::runtime_error);
+
+    options.decoding.symbolsPerLookup = 1;
+    options.decoding.decodeTableBits = 0;
+    BOOST_CHECK_THROW(Reader(STORAGE_FILENAME, options), std::runtime_error);
+}
+
+BOOST_AUTO_TEST_CASE(frequentWordsArePackedFirst)
+{
+    Builder builder(3, wire::Storage_Trained, 8);
+    for (size_t i = 0; i < testVectors.size(); ++i) {
+        builder.addWord(testVectors[i].word, testVectors[i].embedding, i);
+    }
+    builder.save(STORAGE_FILENAME);
+
+    std::ifstream modelFile(STORAGE_FILENAME, std::ios::binary);
+    std::string model((std::istreambuf_iterator<char>(modelFile)), std::istreambuf_iterator<char>());
+    auto valueOffsets = wire::GetIndex(model.data())->storage_as_Trained()->value_offsets();
+
+    Reader reader(STORAGE_FILENAME);
+    for (size_t i = 0; i + 1 < testVectors.size(); ++i) {
+        BOOST_CHECK_GT(
+            valueOffsets->Get(reader.wordId(testVectors[i].word)),
+            valueOffsets->Get(reader.wordId(testVectors[i + 1].word)));
+
+        auto embedding = reader.wordEmbedding(testVectors[i].word);
+        for (size_t idx = 0; idx < embedding.size(); ++idx) {
+            BOOST_CHECK_CLOSE_FRACTION(embedding[idx], testVectors[i].embedding[idx], 0.01);
+        }
+    }
+    BOOST_CHECK_EQUAL(valueOffsets->Get(reader.wordId(testVectors.back().word)), 0);
+}
+
+class CountingExecutor : public Executor {
+public:
+    CountingExecutor():
+        pool_(2),
+        submittedTasks(0)
+    {}
+
+    virtual void submit(std::function<void()> task) override
+    {
+        ++submittedTasks;
+        pool_.submit(task);
+    }
+
+    virtual size_t concurrency() const override
+    {
+        return pool_.concurrency();
+    }
+
+private:
+    ThreadPool pool_;
+
+public:
+    std::atomic<size_t> submittedTasks;
+};
+
+BOOST_AUTO_TEST_CASE(threadedDecoderWorks)
+{
+    // Batches are split between threads by distinct words,
+    // so every thread needs a job worth of them
+    const size_t dim = 3;
+    auto executor = std::make_shared<CountingExecutor>();
+    size_t threadsCount = executor->concurrency() + 1;
+    auto model = randomModel(dim, threadsCount * (MIN_JOB_VALUES / dim + 1), 42);
+    buildModel(model, STORAGE_FILENAME, "trained", 8);
+
+    ReaderOptions options;
+    options.executor = executor;
+
     Reader reader(STORAGE_FILENAME, 1);
-    Reader threadedReader(STORAGE_FILENAME, 4);
-    std::vector<std::string> batch;
+    Reader threadedReader(STORAGE_FILENAME, options);
 
+    std::mt19937 generator(42);
+    auto batch = model.words;
     for (size_t i = 0; i < 1025; ++i) {
-        batch.push_back(testVectors[i % testVectors.size()].word);
+        batch.push_back(model.words[generator() % model.words.size()]);
     }
+    std::shuffle(batch.begin(), batch.end(), generator);
 
     auto embedding = reader.batchEmbedding(batch);
     auto threadedEmbedding = threadedReader.batchEmbedding(batch);
+    BOOST_CHECK(executor->submittedTasks > 0);
 
     BOOST_REQUIRE(embedding.size() == threadedEmbedding.size());
     for (size_t idx = 0; idx < embedding.size(); ++idx) {
@@ -112,6 +565,280 @@ BOOST_AUTO_TEST_CASE(threadedDecoderWorks)
     }
 }
 
+BOOST_AUTO_TEST_CASE(batchWithDuplicatesWorks)
+{
+    const size_t WORDS_COUNT = 3000;
+
+    Builder builder(3, wire::Storage_Trained, 8);
+    for (size_t i = 0; i < WORDS_COUNT; ++i) {
+        builder.addWord("word" + std::to_string(i), {i * 1.0f, -1.0f, i % 7 * 1.0f});
+    }
+    builder.save(STORAGE_FILENAME);
+
+    std::vector<std::string> batch;
+    for (size_t i = 0; i < 2 * WORDS_COUNT; ++i) {
+        batch.push_back("word" + std::to_string(i * 7919 % WORDS_COUNT));
+        if (i % 5 == 0) {
+            batch.push_back("missing" + std::to_string(i % 3));
+        }
+    }
+
+    for (size_t numThreads : {1, 4}) {
+        Reader reader(STORAGE_FILENAME, numThreads);
+        auto embedding = reader.batchEmbedding(batch);
+
+        BOOST_REQUIRE(embedding.size() == batch.size() * reader.dim());
+        for (size_t idx = 0; idx < batch.size(); ++idx) {
+            auto expected = reader.wordEmbedding(batch[idx]);
+            BOOST_REQUIRE(std::equal(expected.begin(), expected.end(), embedding.begin() + idx * reader.dim()));
+        }
+
+        auto wordIds = reader.batchWordIds(batch);
+        std::vector<int32_t> narrowWordIds(wordIds.begin(), wordIds.end());
+        std::vector<float> embeddingByIds(embedding.size());
+        reader.batchEmbeddingByIdsToBuffer(narrowWordIds.data(), narrowWordIds.size(), embeddingByIds.data());
+        BOOST_CHECK(embeddingByIds == embedding);
+    }
+}
+
+BOOST_AUTO_TEST_CASE(cachedReaderWorks)
+{
+    Builder builder(3, wire::Storage_Trained, 8);
+    for (const auto& wordVector : testVectors) {
+        builder.addWord(wordVector.word, wordVector.embedding);
+    }
+    builder.save(STORAGE_FILENAME);
+
+    ReaderOptions options;
+    options.numThreads = 4;
+    options.cacheBytes = 1 << 20;
+
+    Reader reader(STORAGE_FILENAME, 1);
+    Reader cachedReader(STORAGE_FILENAME, options);
+    std::vector<std::string> batch;
+    for (size_t i = 0; i < 1025; ++i) {
+        batch.push_back(testVectors[i % testVectors.size()].word);
+    }
+    batch.push_back("missing");
+
+    BOOST_CHECK(reader.batchEmbedding(batch) == cachedReader.batchEmbedding(batch));
+    BOOST_CHECK(reader.batchEmbedding(batch) == cachedReader.batchEmbedding(batch));
+    for (const auto& word : batch) {
+        BOOST_CHECK(reader.wordEmbedding(word) == cachedReader.wordEmbedding(word));
+    }
+
+    auto statistics = cachedReader.cacheStatistics();
+    BOOST_CHECK_EQUAL(statistics.misses, testVectors.size());
+    BOOST_CHECK_EQUAL(statistics.entries, testVectors.size());
+    BOOST_CHECK_EQUAL(statistics.hits, testVectors.size() + batch.size() - 1);
+    BOOST_CHECK_EQUAL(reader.cacheStatistics().capacity, 0);
+
+    // Ranges of cached vectors are sliced from the cache
+    for (const auto& wordVector : testVectors) {
+        auto wordId = reader.wordId(wordVector.word);
+        BOOST_CHECK(reader.embeddingRangeById(wordId, 1, 3) == cachedReader.embeddingRangeById(wordId, 1, 3));
+    }
+    BOOST_CHECK_EQUAL(cachedReader.cacheStatistics().hits, statistics.hits + testVectors.size());
+    BOOST_CHECK_EQUAL(cachedReader.cacheStatistics().misses, statistics.misses);
+}
+
+BOOST_AUTO_TEST_CASE(customExecutorIsUsed)
+{
+    Builder builder(3, wire::Storage_Trained, 8);
+    for (const auto& wordVector : testVectors) {
+        builder.addWord(wordVector.word, wordVector.embedding);
+    }
+    builder.save(STORAGE_FILENAME);
+
+    auto executor = std::make_shared<CountingExecutor>();
+    ReaderOptions options;
+    options.executor = executor;
+
+    Reader reader(STORAGE_FILENAME, 1);
+    Reader threadedReader(STORAGE_FILENAME, options);
+
+    std::vector<int64_t> wordIds;
+    for (size_t i = 0; i < 100000; ++i) {
+        wordIds.push_back(i % (testVectors.size() + 1) - 1);
+    }
+
+    BOOST_CHECK(reader.batchEmbeddingByIds(wordIds) == threadedReader.batchEmbeddingByIds(wordIds));
+    BOOST_CHECK(executor->submittedTasks > 0);
+}
+
+BOOST_AUTO_TEST_CASE(asyncBatchWorks)
+{
+    Builder builder(3, wire::Storage_Trained, 8);
+    for (const auto& wordVector : testVectors) {
+        builder.addWord(wordVector.word, wordVector.embedding);
+    }
+    builder.save(STORAGE_FILENAME);
+
+    std::vector<std::string> batch;
+    for (size_t i = 0; i < 5000; ++i) {
+        batch.push_back(i % 3 ? testVectors[i % testVectors.size()].word : "missing");
+    }
+
+    for (size_t numThreads : {1, 4}) {
+        Reader reader(STORAGE_FILENAME, numThreads);
+        auto expected = reader.batchEmbedding(batch);
+
+        std::vector<std::vector<float>> buffers(8, std::vector<float>(expected.size(), 1.0));
+        std::vector<std::future<void>> results;
+        for (auto& buffer : buffers) {
+            results.push_back(reader.batchEmbeddingAsync(batch, buffer.data()));
+        }
+
+        for (size_t i = 0; i < buffers.size(); ++i) {
+            results[i].get();
+            BOOST_CHECK(buffers[i] == expected);
+        }
+
+        std::vector<float> callbackBuffer(expected.size());
+        std::promise<bool> callbackResult;
+        reader.batchEmbeddingAsync(
+            batch,
+            callbackBuffer.data(),
+            [&callbackResult](std::exception_ptr error)
+            {
+                callbackResult.set_value(!error);
+            });
+        BOOST_CHECK(callbackResult.get_future().get());
+        BOOST_CHECK(callbackBuffer == expected);
+    }
+}
+
+BOOST_AUTO_TEST_CASE(asyncRequestsMayReleaseReader)
+{
+    Builder builder(3, wire::Storage_Trained, 8);
+    for (const auto& wordVector : testVectors) {
+        builder.addWord(wordVector.word, wordVector.embedding);
+    }
+    builder.save(STORAGE_FILENAME);
+
+    std::vector<std::string> batch;
+    for (size_t i = 0; i < 5000; ++i) {
+        batch.push_back(testVectors[i % testVectors.size()].word);
+    }
+
+    for (size_t numThreads : {0, 1, 4}) {
+        auto reader = std::make_shared<Reader>(STORAGE_FILENAME, numThreads);
+        auto expected = reader->batchEmbedding(batch);
+
+        // The last callback destroys the reader and possibly its own pool
+        std::vector<std::vector<float>> buffers(8, std::vector<float>(expected.size()));
+        std::vector<std::promise<bool>> results(buffers.size());
+        for (size_t i = 0; i < buffers.size(); ++i) {
+            reader->batchEmbeddingAsync(
+                batch,
+                buffers[i].data(),
+                [reader, &results, i](std::exception_ptr error) mutable
+                {
+                    reader.reset();
+                    results[i].set_value(!error);
+                });
+        }
+        reader.reset();
+
+        for (size_t i = 0; i < buffers.size(); ++i) {
+            BOOST_CHECK(results[i].get_future().get());
+            BOOST_CHECK(buffers[i] == expected);
+        }
+    }
+}
+
+BOOST_AUTO_TEST_CASE(residencyPoliciesWork)
+{
+    std::vector<std::string> batch;
+    for (const auto& wordVector : testVectors) {
+        batch.push_back(wordVector.word);
+    }
+    batch.push_back("missing");
+
+    for (auto storageType : {wire::Storage_Full, wire::Storage_Trained}) {
+        Builder builder(3, storageType, 8);
+        for (const auto& wordVector : testVectors) {
+            builder.addWord(wordVector.word, wordVector.embedding);
+        }
+        builder.save(STORAGE_FILENAME);
+
+        auto expected = Reader(STORAGE_FILENAME, 1).batchEmbedding(batch);
+
+        for (const auto& policyName : {"default", "random", "willneed", "hugepages", "populate", "lock"}) {
+            ReaderOptions options;
+            options.numThreads = 1;
+            options.residency.vocabulary = parseResidencyPolicy(policyName);
+            options.residency.decoder = parseResidencyPolicy(policyName);
+            options.residency.values = parseResidencyPolicy(policyName);
+            options.residency.prefetchBatches = true;
+
+            Reader reader(STORAGE_FILENAME, options);
+            BOOST_CHECK(reader.batchEmbedding(batch) == expected);
+        }
+    }
+
+    BOOST_CHECK_THROW(parseResidencyPolicy("always"), std::runtime_error);
+}
+
+BOOST_AUTO_TEST_CASE(modelBuffersWork)
+{
+    std::vector<std::string> batch = {"the", "abc", "missing"};
+
+    Builder builder(3, wire::Storage_Trained, 8);
+    for (const auto& wordVector : testVectors) {
+        builder.addWord(wordVector.word, wordVector.embedding);
+    }
+    std::ostringstream stream;
+    builder.dump(stream);
+    auto model = std::make_shared<std::string>(stream.str());
+
+    auto expected = Reader(ModelBuffer::fromMemory(model->data(), model->size())).batchEmbedding(batch);
+    BOOST_CHECK_CLOSE_FRACTION(expected[1], 1.0, 0.01);
+
+    {
+        auto buffer = ModelBuffer::fromMemory(model->data(), model->size(), model);
+        Reader reader(buffer);
+        model.reset();
+        BOOST_CHECK(reader.batchEmbedding(batch) == expected);
+        model = std::make_shared<std::string>(stream.str());
+    }
+
+#ifndef _WIN32
+    // Model stored after a header, the way artifact bundles keep it
+    const size_t offset = 5000;
+    {
+        std::ofstream f(STORAGE_FILENAME, std::ios::binary);
+        f << std::string(offset, 'x') << *model;
+    }
+
+    int fd = open(STORAGE_FILENAME.c_str(), O_RDONLY);
+    BOOST_REQUIRE(fd >= 0);
+    auto fdBuffer = ModelBuffer::fromFileDescriptor(fd, offset);
+    BOOST_CHECK_THROW(ModelBuffer::fromFileDescriptor(fd, offset + model->size()), std::runtime_error);
+    BOOST_CHECK_EQUAL(ModelBuffer::fromFileDescriptor(fd, offset, model->size()).size(), model->size());
+    BOOST_CHECK_THROW(ModelBuffer::fromFileDescriptor(fd, offset, model->size() + 1), std::runtime_error);
+    close(fd);
+
+    BOOST_CHECK_EQUAL(fdBuffer.size(), model->size());
+    BOOST_CHECK(Reader(fdBuffer).batchEmbedding(batch) == expected);
+    BOOST_CHECK_THROW(ModelBuffer::fromFileDescriptor(-1), std::runtime_error);
+#endif
+
+#ifdef __linux__
+    int memfd = memfd_create("memb_model", 0);
+    BOOST_REQUIRE(memfd >= 0);
+    BOOST_REQUIRE(write(memfd, model->data(), model->size()) == static_cast<ssize_t>(model->size()));
+    Reader memfdReader(ModelBuffer::fromFileDescriptor(memfd));
+    close(memfd);
+    BOOST_CHECK(memfdReader.batchEmbedding(batch) == expected);
+#endif
+
+    std::string invalidModel = "0123456789";
+    BOOST_CHECK_THROW(
+        Reader(ModelBuffer::fromMemory(invalidModel.data(), invalidModel.size())),
+        std::runtime_error);
+}
+
 BOOST_AUTO_TEST_CASE(invalidDimensionThrows)
 {
     Builder builder(15, wire::Storage_Full, 8);
@@ -140,7 +867,7 @@ BOOST_AUTO_TEST_CASE(missingFileThrows)
 
 BOOST_AUTO_TEST_CASE(invalidFileThrows)
 {
-    static const std::string INVALID_FILE = "invalid.bin";
+    static const std::string INVALID_FILE = temporaryPath("invalid.bin");
 
     {
         std::ofstream f(INVALID_FILE);
@@ -0,0 +1,140 @@
+#include "thread_pool.h"
+
+#include <algorithm>
+
+namespace memb {
+
+namespace {
+
+thread_local const ThreadPool* currentPool = nullptr;
+thread_local size_t currentThreadIndex = 0;
+
+} // namespace
+
+ThreadPool::ThreadPool(size_t threadsCount):
+    nextQueue_(0),
+    pendingTasks_(0),
+    stopping_(false)
+{
+    for (size_t i = 0; i < threadsCount; ++i) {
+        queues_.emplace_back(new TaskQueue());
+    }
+
+    for (size_t i = 0; i < threadsCount; ++i) {
+        threads_.emplace_back(&ThreadPool::run, this, i);
+    }
+}
+
+ThreadPool::~ThreadPool()
+{
+    {
+        std::lock_guard<std::mutex> lock(sleepMutex_);
+        stopping_ = true;
+    }
+    wakeUp_.notify_all();
+
+    // A task may drop the last reference to its own pool, its thread
+    // cannot be joined and leaves the pool when the task returns
+    for (auto& thread : threads_) {
+        if (thread.get_id() == std::this_thread::get_id()) {
+            currentPool = nullptr;
+            thread.detach();
+        } else {
+            thread.join();
+        }
+    }
+}
+
+void ThreadPool::submit(std::function<void()> task)
+{
+    if (queues_.empty()) {
+        task();
+        return;
+    }
+
+    size_t queueIndex = (currentPool == this)
+        ? currentThreadIndex
+        : nextQueue_++ % queues_.size();
+
+    {
+        std::lock_guard<std::mutex> lock(queues_[queueIndex]->mutex);
+        queues_[queueIndex]->tasks.push_back(std::move(task));
+    }
+
+    {
+        std::lock_guard<std::mutex> lock(sleepMutex_);
+        ++pendingTasks_;
+    }
+    wakeUp_.notify_one();
+}
+
+size_t ThreadPool::concurrency() const
+{
+    return threads_.size();
+}
+
+std::shared_ptr<ThreadPool> ThreadPool::shared()
+{
+    static auto pool = std::make_shared<ThreadPool>(
+        std::max(std::thread::hardware_concurrency(), 2u) - 1);
+
+    return pool;
+}
+
+void ThreadPool::run(size_t threadIndex)
+{
+    currentPool = this;
+    currentThreadIndex = threadIndex;
+
+    std::function<void()> task;
+    while (true) {
+        if (popTask(threadIndex, task)) {
+            --pendingTasks_;
+            task();
+            task = nullptr;
+            if (currentPool != this) {
+                return;
+            }
+            continue;
+        }
+
+        std::unique_lock<std::mutex> lock(sleepMutex_);
+        wakeUp_.wait(
+            lock,
+            [this]
+            {
+                return stopping_ || pendingTasks_ > 0;
+            });
+
+        if (stopping_ && pendingTasks_ == 0) {
+            return;
+        }
+    }
+}
+
+bool ThreadPool::popTask(size_t threadIndex, std::function<void()>& task)
+{
+    {
+        auto& queue = *queues_[threadIndex];
+        std::lock_guard<std::mutex> lock(queue.mutex);
+        if (!queue.tasks.empty()) {
+            task = std::move(queue.tasks.back());
+            queue.tasks.pop_back();
+            return true;
+        }
+    }
+
+    for (size_t i = 1; i < queues_.size(); ++i) {
+        auto& queue = *queues_[(threadIndex + i) % queues_.size()];
+        std::lock_guard<std::mutex> lock(queue.mutex);
+        if (!queue.tasks.empty()) {
+            task = std::move(queue.tasks.front());
+            queue.tasks.pop_front();
+            return true;
+        }
+    }
+
+    return false;
+}
+
+}
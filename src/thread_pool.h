@@ -0,0 +1,48 @@
+#pragma once
+
+#include "executor.h"
+
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace memb {
+
+// Fixed set of threads with a task queue per thread. Tasks submitted
+// from a pool thread go to its own queue, other tasks are distributed
+// round robin, and idle threads steal from the queues of busy ones.
+class ThreadPool : public Executor {
+public:
+    explicit ThreadPool(size_t threadsCount);
+    ~ThreadPool();
+
+    virtual void submit(std::function<void()> task) override;
+    virtual size_t concurrency() const override;
+
+    // Process-wide pool with a thread per core, created on first use
+    static std::shared_ptr<ThreadPool> shared();
+
+private:
+    struct TaskQueue {
+        std::mutex mutex;
+        std::deque<std::function<void()>> tasks;
+    };
+
+    void run(size_t threadIndex);
+    bool popTask(size_t threadIndex, std::function<void()>& task);
+
+    std::vector<std::unique_ptr<TaskQueue>> queues_;
+    std::vector<std::thread> threads_;
+    std::atomic<size_t> nextQueue_;
+
+    std::mutex sleepMutex_;
+    std::condition_variable wakeUp_;
+    std::atomic<size_t> pendingTasks_;
+    bool stopping_;
+};
+
+}
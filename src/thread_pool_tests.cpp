@@ -0,0 +1,114 @@
+#include "thread_pool.h"
+
+#include <boost/test/unit_test.hpp>
+
+#include <algorithm>
+#include <stdexcept>
+
+using namespace memb;
+
+BOOST_AUTO_TEST_SUITE(threadPool)
+
+BOOST_AUTO_TEST_CASE(parallelForCoversRange)
+{
+    ThreadPool pool(3);
+    std::vector<size_t> visits(100000, 0);
+
+    parallelFor(
+        &pool,
+        visits.size(),
+        100,
+        [&visits](size_t begin, size_t end)
+        {
+            for (size_t i = begin; i < end; ++i) {
+                ++visits[i];
+            }
+        });
+
+    BOOST_CHECK(std::all_of(visits.begin(), visits.end(), [](size_t item) { return item == 1; }));
+}
+
+BOOST_AUTO_TEST_CASE(nullExecutorRunsInCallingThread)
+{
+    auto callerId = std::this_thread::get_id();
+    size_t callsCount = 0;
+
+    parallelFor(
+        nullptr,
+        1000,
+        1,
+        [&](size_t begin, size_t end)
+        {
+            BOOST_CHECK(std::this_thread::get_id() == callerId);
+            BOOST_CHECK_EQUAL(begin, 0);
+            BOOST_CHECK_EQUAL(end, 1000);
+            ++callsCount;
+        });
+
+    BOOST_CHECK_EQUAL(callsCount, 1);
+}
+
+BOOST_AUTO_TEST_CASE(nestedParallelForWorks)
+{
+    ThreadPool pool(2);
+    std::vector<std::atomic<size_t>> sums(64);
+
+    parallelFor(
+        &pool,
+        sums.size(),
+        1,
+        [&](size_t begin, size_t end)
+        {
+            for (size_t i = begin; i < end; ++i) {
+                parallelFor(
+                    &pool,
+                    1000,
+                    10,
+                    [&sums, i](size_t innerBegin, size_t innerEnd)
+                    {
+                        sums[i] += innerEnd - innerBegin;
+                    });
+            }
+        });
+
+    for (const auto& sum : sums) {
+        BOOST_CHECK_EQUAL(sum, 1000);
+    }
+}
+
+BOOST_AUTO_TEST_CASE(exceptionsArePropagated)
+{
+    ThreadPool pool(2);
+
+    BOOST_CHECK_THROW(
+        parallelFor(
+            &pool,
+            1000,
+            1,
+            [](size_t begin, size_t end)
+            {
+                if (begin <= 500 && 500 < end) {
+                    throw std::runtime_error("job failed");
+                }
+            }),
+        std::runtime_error);
+}
+
+BOOST_AUTO_TEST_CASE(submittedTasksRunBeforeDestruction)
+{
+    std::atomic<size_t> completed(0);
+    {
+        ThreadPool pool(2);
+        for (size_t i = 0; i < 100; ++i) {
+            pool.submit(
+                [&completed]
+                {
+                    ++completed;
+                });
+        }
+    }
+
+    BOOST_CHECK_EQUAL(completed, 100);
+}
+
+BOOST_AUTO_TEST_SUITE_END()
@@ -1,167 +1,424 @@
 #include "trained_compression.h"
-#include "kmeans.h"
-#include "bit_stream.h"
 #include "huffman_encoder.h"
-#include "huffman_decoder.h"
+#include "bit_stream.h"
+
+#include <boost/format.hpp>
+
+#include <algorithm>
+#include <array>
+#include <limits>
+#include <stdexcept>
 
 namespace memb {
 
 namespace {
 
-struct QuantizedWordVector {
-    std::string word;
-    std::vector<uint8_t> values;
-};
+const size_t STREAM_SIZE_BYTES = 2;
+const size_t MAX_DECODE_TABLE_BITS = 16;
 
-struct StorageNode {
-    std::string word;
-    uint32_t offset;
-};
+std::vector<HuffmanTableDecoder> createTableDecoders(
+    const wire::Trained* flatStorage, size_t dim, const DecodingOptions& options)
+{
+    if (options.decodeTableBits == 0 || options.decodeTableBits > MAX_DECODE_TABLE_BITS) {
+        throw std::runtime_error(boost::str(boost::format(
+            "Decode table bits must be between 1 and %1%, got %2%") %
+            MAX_DECODE_TABLE_BITS % options.decodeTableBits));
+    }
+    if (options.symbolsPerLookup == 0 ||
+            options.symbolsPerLookup > HuffmanTableDecoder::MAX_SYMBOLS_PER_LOOKUP) {
+        throw std::runtime_error(boost::str(boost::format(
+            "Symbols per lookup must be between 1 and %1%, got %2%") %
+            HuffmanTableDecoder::MAX_SYMBOLS_PER_LOOKUP % options.symbolsPerLookup));
+    }
 
-const size_t CLUSTER_SAMPLE_SIZE = 10000;
+    std::vector<const wire::HuffmanDecoder*> flatDecoders;
+    if (flatStorage->block_decoders()) {
+        size_t blockSize = flatStorage->codebook_block_size();
+        if (blockSize == 0 ||
+                flatStorage->block_decoders()->size() != (dim + blockSize - 1) / blockSize) {
+            throw std::runtime_error(boost::str(boost::format(
+                "%1% codebooks do not match blocks of %2% of %3% dimensions") %
+                flatStorage->block_decoders()->size() % blockSize % dim));
+        }
+        flatDecoders.assign(flatStorage->block_decoders()->begin(), flatStorage->block_decoders()->end());
+    } else {
+        flatDecoders.push_back(flatStorage->decoder());
+    }
 
-} // namespace
+    std::vector<HuffmanTableDecoder> result;
+
+    // Stored tables are used from the file without copying
+    auto decodeTables = flatStorage->decode_tables();
+    if (decodeTables && decodeTables->size() == flatDecoders.size() && options.symbolsPerLookup == 1 &&
+            decodeTables->Get(0)->table_bits() == options.decodeTableBits) {
+        for (size_t i = 0; i < flatDecoders.size(); ++i) {
+            // Offsets start with the one of zero length codes
+            auto sizeOffsets = flatDecoders[i]->size_offsets();
+            size_t maxCodeLength = sizeOffsets && sizeOffsets->size() > 0 ? sizeOffsets->size() - 1 : 0;
+            result.emplace_back(decodeTables->Get(i), maxCodeLength);
+        }
+        return result;
+    }
 
-TrainedCompressor::TrainedCompressor(
-        flatbuffers::FlatBufferBuilder& builder,
-        size_t bitsPerWeight):
-    builder_(builder),
-    quantizationLevels_(std::min(1 << bitsPerWeight, 255))
-{}
+    for (auto flatDecoder : flatDecoders) {
+        result.push_back(HuffmanDecoder::load(flatDecoder).createTableDecoder(
+            options.decodeTableBits, options.symbolsPerLookup));
+    }
 
-void TrainedCompressor::add(
-    const std::string& word,
-    const float* source,
-    size_t dim)
-{
-    embeddings_.push_back({word, std::vector<float>(source, source + dim)});
+    return result;
 }
 
-flatbuffers::Offset<void> TrainedCompressor::finalize()
+size_t nextMultiple(size_t value, size_t step)
 {
-    std::vector<float> valuesSample;
+    return (value / step + 1) * step;
+}
 
-    for (size_t i = 0; i < std::min(CLUSTER_SAMPLE_SIZE, embeddings_.size()); ++i) {
-        valuesSample.insert(
-            valuesSample.end(), embeddings_[i].values.begin(), embeddings_[i].values.end());
+void appendUint16(size_t value, const std::string& field, std::vector<uint8_t>* bytes)
+{
+    if (value > std::numeric_limits<uint16_t>::max()) {
+        throw std::runtime_error(boost::str(
+            boost::format("Huffman stream is too long for its %1%") % field));
     }
+    bytes->push_back(value & 0xff);
+    bytes->push_back(value >> 8);
+}
+
+size_t readUint16(const uint8_t* data)
+{
+    return data[0] + (data[1] << 8);
+}
 
-    HuffmanEncoderBuilder encoderBuilder;
-    std::vector<QuantizedWordVector> quantizedVectors;
-    KMeansClusterizer clusterizer(quantizationLevels_);
-    clusterizer.fit(valuesSample);
+// Symbol i goes to the stream i % streamsCount and is coded with the codebook
+// of its block. Blocks and checkpoint intervals are multiples of streamsCount,
+// streams are byte aligned.
+std::vector<uint8_t> encodeStreams(
+    const std::vector<HuffmanEncoder>& encoders,
+    size_t blockSize,
+    size_t checkpointInterval,
+    const std::vector<uint8_t>& values,
+    size_t streamsCount)
+{
+    std::vector<BitStream> bitStreams(streamsCount);
+    std::vector<uint8_t> checkpoints;
+    std::vector<uint8_t> segmentValues;
+    for (size_t begin = 0, end = 0; begin < values.size(); begin = end) {
+        end = std::min(values.size(), nextMultiple(begin, blockSize));
+        if (checkpointInterval) {
+            end = std::min(end, nextMultiple(begin, checkpointInterval));
+            if (begin > 0 && begin % checkpointInterval == 0) {
+                for (const auto& bitStream : bitStreams) {
+                    appendUint16(bitStream.bitsCount(), "checkpoints", &checkpoints);
+                }
+            }
+        }
 
-    for (const auto& wordVector : embeddings_) {
-        auto quantizedWordVector = clusterizer.predict(wordVector.values);
-        encoderBuilder.updateFrequencies(quantizedWordVector);
-        quantizedVectors.push_back({wordVector.word, quantizedWordVector});
+        for (size_t stream = 0; stream < streamsCount; ++stream) {
+            segmentValues.clear();
+            for (size_t i = begin + stream; i < end; i += streamsCount) {
+                segmentValues.push_back(values[i]);
+            }
+            encoders[begin / blockSize].encode(segmentValues, &bitStreams[stream]);
+        }
     }
 
-    auto encoder = encoderBuilder.createEncoder();
+    std::vector<uint8_t> header;
+    std::vector<uint8_t> streams;
+    for (size_t stream = 0; stream < streamsCount; ++stream) {
+        auto encodedValues = bitStreams[stream].data();
+        if (stream + 1 < streamsCount) {
+            appendUint16(encodedValues.size(), "size header", &header);
+        }
+        streams.insert(streams.end(), encodedValues.begin(), encodedValues.end());
+    }
 
-    std::vector<StorageNode> nodes;
-    std::vector<uint8_t> packedValues;
+    header.insert(header.end(), checkpoints.begin(), checkpoints.end());
+    header.insert(header.end(), streams.begin(), streams.end());
+    return header;
+}
 
-    for (const auto& item : quantizedVectors) {
-        auto offset = packedValues.size();
-        auto encodedValues = encoder.encode(item.values);
-        packedValues.insert(
-            packedValues.end(), encodedValues.begin(), encodedValues.end());
-        nodes.push_back(StorageNode{item.word, static_cast<uint32_t>(offset)});
+} // namespace
+
+TrainedCompressor::TrainedCompressor(
+        flatbuffers::FlatBufferBuilder& builder,
+        size_t bitsPerWeight,
+        const CompressionOptions& options):
+    CentroidCompressor(builder, bitsPerWeight, options),
+    blockSize_(0)
+{
+    auto streams = options_.huffmanStreams;
+    if (streams != 1 && streams != 2 && streams != 4 && streams != 8) {
+        throw std::runtime_error(boost::str(
+            boost::format("Unsupported number of Huffman streams %1%, expected 1, 2, 4 or 8") % streams));
+    }
+    if (options_.codebookBlocks == 0) {
+        throw std::runtime_error("Trained storage needs at least one codebook block");
     }
+    if (options_.decodeTableBits > MAX_DECODE_TABLE_BITS) {
+        throw std::runtime_error(boost::str(boost::format(
+            "Stored decode table bits must be at most %1%, got %2%") %
+            MAX_DECODE_TABLE_BITS % options_.decodeTableBits));
+    }
+    if (options_.checkpointInterval % streams != 0) {
+        throw std::runtime_error(boost::str(
+            boost::format("Checkpoint interval %1% is not a multiple of %2% Huffman streams") %
+            options_.checkpointInterval % streams));
+    }
+}
 
-    std::sort(
-        nodes.begin(),
-        nodes.end(),
-        [](const StorageNode& lhs, const StorageNode& rhs)
-        {
-            return lhs.word < rhs.word;
-        });
+void TrainedCompressor::fitCoder(const std::vector<std::vector<uint8_t>>& codes)
+{
+    size_t dim = codes.empty() ? 0 : codes.front().size();
+    size_t streams = options_.huffmanStreams;
+
+    // Blocks are rounded up to whole rounds of streams, so a stream
+    // switches codebooks at the same positions for every vector
+    size_t blockSize = (dim + options_.codebookBlocks - 1) / options_.codebookBlocks;
+    blockSize = (blockSize + streams - 1) / streams * streams;
+    blockSize_ = (blockSize > 0 && blockSize < dim) ? blockSize : 0;
+
+    encoders_.clear();
+    size_t encodedBlockSize = blockSize_ ? blockSize_ : dim;
+    size_t begin = 0;
+    do {
+        HuffmanEncoderBuilder encoderBuilder;
+        for (const auto& vectorCodes : codes) {
+            auto end = std::min(begin + encodedBlockSize, vectorCodes.size());
+            encoderBuilder.updateFrequencies(
+                std::vector<uint8_t>(vectorCodes.begin() + begin, vectorCodes.begin() + end));
+        }
+        encoders_.push_back(encoderBuilder.createEncoder());
+        begin += encodedBlockSize;
+    } while (begin < dim);
+}
 
-    std::string packedWords;
-    std::vector<uint32_t> wordOffsets;
-    std::vector<uint32_t> valueOffsets;
+std::vector<uint8_t> TrainedCompressor::encodeCodes(const std::vector<uint8_t>& codes) const
+{
+    return encodeStreams(
+        encoders_,
+        blockSize_ ? blockSize_ : codes.size(),
+        options_.checkpointInterval,
+        codes,
+        options_.huffmanStreams);
+}
 
-    for (const auto& node : nodes) {
-        wordOffsets.push_back(packedWords.size());
-        valueOffsets.push_back(node.offset);
+flatbuffers::Offset<void> TrainedCompressor::createStorage(const StorageParts& parts)
+{
+    flatbuffers::Offset<wire::HuffmanDecoder> decoder;
+    flatbuffers::Offset<flatbuffers::Vector<flatbuffers::Offset<wire::HuffmanDecoder>>> blockDecoders;
+    if (blockSize_) {
+        std::vector<flatbuffers::Offset<wire::HuffmanDecoder>> decoders;
+        for (const auto& encoder : encoders_) {
+            decoders.push_back(encoder.createDecoder().save(builder_));
+        }
+        blockDecoders = builder_.CreateVector(decoders);
+    } else {
+        decoder = encoders_.front().createDecoder().save(builder_);
+    }
 
-        packedWords.insert(packedWords.size(), node.word.c_str(), node.word.size() + 1);
+    flatbuffers::Offset<flatbuffers::Vector<flatbuffers::Offset<wire::HuffmanDecodeTables>>> decodeTables;
+    if (options_.decodeTableBits) {
+        std::vector<flatbuffers::Offset<wire::HuffmanDecodeTables>> tables;
+        for (const auto& encoder : encoders_) {
+            tables.push_back(encoder.createDecoder().createTableDecoder(options_.decodeTableBits).save(builder_));
+        }
+        decodeTables = builder_.CreateVector(tables);
     }
 
     return wire::CreateTrained(
         builder_,
-        builder_.CreateVector(wordOffsets),
-        builder_.CreateVector(valueOffsets),
-        builder_.CreateString(packedWords),
-        builder_.CreateVector(packedValues),
-        encoder.createDecoder().save(builder_),
-        clusterizer.save(builder_)
+        parts.wordOffsets,
+        parts.valueOffsets,
+        parts.packedWords,
+        parts.packedValues,
+        decoder,
+        parts.clusterizer,
+        parts.perfectHash,
+        parts.searchTree,
+        parts.squaredNorms,
+        options_.huffmanStreams,
+        true,
+        blockDecoders,
+        blockSize_,
+        options_.checkpointInterval,
+        decodeTables
     ).Union();
 }
 
 TrainedCompressedStorage::TrainedCompressedStorage(
         const void* flatStorage,
         size_t dim,
-        size_t maxDirectDecodeBitLength):
+        const DecodingOptions& options):
+    CentroidCompressedStorage(
+        static_cast<const wire::Trained*>(flatStorage),
+        dim,
+        static_cast<const wire::Trained*>(flatStorage)->padded_values()),
     flatStorage_(static_cast<const wire::Trained*>(flatStorage)),
-    dim_(dim),
-    huffmanDecoder_(HuffmanDecoder::load(flatStorage_->decoder()).createTableDecoder(maxDirectDecodeBitLength)),
-    centroids_(KMeansClusterizer::load(flatStorage_->clusterizer()).centroids())
+    huffmanDecoders_(createTableDecoders(flatStorage_, dim, options)),
+    blockSize_(flatStorage_->block_decoders() ? flatStorage_->codebook_block_size() : dim),
+    checkpointInterval_(flatStorage_->checkpoint_interval()),
+    checkpointsCount_(checkpointInterval_ && dim ? (dim - 1) / checkpointInterval_ : 0)
 {}
 
-bool TrainedCompressedStorage::extract(const std::string& word, float* destination) const
+template <size_t Streams, typename Consumer>
+void TrainedCompressedStorage::decodeStreams(
+    const uint8_t* data, size_t begin, size_t end, Consumer&& consume) const
 {
-    auto wordData = flatStorage_->packed_words()->data();
-    auto resultIt = std::lower_bound(
-        flatStorage_->word_offsets()->begin(),
-        flatStorage_->word_offsets()->end(),
-        word.c_str(),
-        [wordData](uint32_t offset, const char* word)
-        {
-            return strcmp(wordData + offset, word) < 0;
-        });
+    // Streams are entered at the closest checkpoint before begin
+    size_t checkpoint = checkpointInterval_ ? std::min(begin / checkpointInterval_, checkpointsCount_) : 0;
+    const uint8_t* bitOffsets = data + STREAM_SIZE_BYTES * (Streams - 1);
+    if (checkpoint > 0) {
+        bitOffsets += STREAM_SIZE_BYTES * Streams * (checkpoint - 1);
+    }
+
+    std::array<HuffmanTableDecoder::DecodeState, Streams> states;
+    size_t offset = STREAM_SIZE_BYTES * (Streams - 1 + checkpointsCount_ * Streams);
+    for (size_t stream = 0; stream < Streams; ++stream) {
+        size_t bitOffset = checkpoint > 0 ? readUint16(bitOffsets + STREAM_SIZE_BYTES * stream) : 0;
+        states[stream] = huffmanDecoders_.front().decode(data + offset + (bitOffset >> 3));
+        states[stream].reader.consume(bitOffset & 7);
+        if (stream + 1 < Streams) {
+            offset += readUint16(data + STREAM_SIZE_BYTES * stream);
+        }
+    }
 
-    if (strcmp(flatStorage_->packed_words()->data() + *resultIt, word.c_str()) == 0) {
-        size_t offset = flatStorage_->value_offsets()->Get(
-            resultIt - flatStorage_->word_offsets()->begin());
+    size_t segmentEnd = 0;
+    for (size_t segmentBegin = checkpoint * checkpointInterval_; segmentBegin < end; segmentBegin = segmentEnd) {
+        const auto& decoder = huffmanDecoders_[segmentBegin / blockSize_];
+        segmentEnd = std::min(end, nextMultiple(segmentBegin, blockSize_));
+        // Refills are planned for the longest code of one table
+        for (auto& state : states) {
+            state.lookupsBeforeRefill = 0;
+        }
 
-        auto decodeState = huffmanDecoder_.decode(
-            flatStorage_->packed_values()->data() + offset,
-            flatStorage_->packed_values()->size() - offset);
+        // Lookups emitting several symbols have variable strides,
+        // so such streams are decoded one after another
+        if (decoder.hasMultiSymbolTable()) {
+            for (size_t stream = 0; stream < Streams; ++stream) {
+                decoder.decodeSymbols(
+                    states[stream],
+                    (segmentEnd - segmentBegin + Streams - 1 - stream) / Streams,
+                    [&](size_t index, uint8_t code)
+                    {
+                        consume(segmentBegin + index * Streams + stream, code);
+                    });
+            }
+            continue;
+        }
 
-        for (size_t i = 0; i < dim_; ++i) {
-            destination[i] = centroids_[huffmanDecoder_.next(decodeState)];
+        // Lookups of different streams do not depend on each other,
+        // so the unrolled inner loop keeps several of them in flight
+        size_t i = segmentBegin;
+        for (; i + Streams <= segmentEnd; i += Streams) {
+            for (size_t stream = 0; stream < Streams; ++stream) {
+                consume(i + stream, decoder.next(states[stream]));
+            }
         }
-        return true;
-    } else {
-        return false;
+        for (size_t stream = 0; i < segmentEnd; ++i, ++stream) {
+            consume(i, decoder.next(states[stream]));
+        }
+    }
+}
+
+template <typename Consumer>
+void TrainedCompressedStorage::decodeVector(
+    size_t wordId, size_t begin, size_t end, Consumer&& consume) const
+{
+    const uint8_t* data = packedValues(wordId);
+
+    switch (flatStorage_->huffman_streams()) {
+    case 2:
+        decodeStreams<2>(data, begin, end, consume);
+        break;
+    case 4:
+        decodeStreams<4>(data, begin, end, consume);
+        break;
+    case 8:
+        decodeStreams<8>(data, begin, end, consume);
+        break;
+    default:
+        decodeStreams<1>(data, begin, end, consume);
     }
 }
 
-std::vector<std::string> TrainedCompressedStorage::keys() const
+void TrainedCompressedStorage::extractById(size_t wordId, float* destination) const
 {
-    std::vector<std::string> result;
-    result.reserve(flatStorage_->word_offsets()->size());
-    auto wordData = flatStorage_->packed_words()->data();
+    decodeVector(
+        wordId,
+        0,
+        dim_,
+        [this, destination](size_t index, uint8_t code)
+        {
+            destination[index] = centroids_[code];
+        });
+}
+
+// Codes between the checkpoint and begin are decoded and dropped
+void TrainedCompressedStorage::extractRangeById(
+    size_t wordId, size_t, size_t begin, size_t end, float* destination) const
+{
+    decodeVector(
+        wordId,
+        begin,
+        end,
+        [this, begin, destination](size_t index, uint8_t code)
+        {
+            if (index >= begin) {
+                destination[index - begin] = centroids_[code];
+            }
+        });
+}
 
-    for (auto wordOffset : *flatStorage_->word_offsets()) {
-        result.emplace_back(reinterpret_cast<const char*>(wordData + wordOffset));
+void TrainedCompressedStorage::decodeCodes(size_t wordId, uint8_t* codes) const
+{
+    decodeVector(
+        wordId,
+        0,
+        dim_,
+        [codes](size_t index, uint8_t code)
+        {
+            codes[index] = code;
+        });
+}
+
+std::vector<MemoryRange> TrainedCompressedStorage::memoryRanges() const
+{
+    auto result = commonMemoryRanges(flatStorage_);
+    std::vector<const wire::HuffmanDecoder*> decoders;
+    if (flatStorage_->block_decoders()) {
+        decoders.assign(flatStorage_->block_decoders()->begin(), flatStorage_->block_decoders()->end());
+    } else {
+        decoders.push_back(flatStorage_->decoder());
+    }
+    for (auto decoder : decoders) {
+        result.push_back(vectorRange(StorageSection::Decoder, decoder->keys(), sizeof(uint8_t)));
+        result.push_back(vectorRange(StorageSection::Decoder, decoder->size_offsets(), sizeof(uint32_t)));
+    }
+    if (flatStorage_->decode_tables()) {
+        for (auto tables : *flatStorage_->decode_tables()) {
+            result.push_back(vectorRange(
+                StorageSection::Decoder, tables->direct(), sizeof(wire::HuffmanTableEntry)));
+            result.push_back(vectorRange(
+                StorageSection::Decoder, tables->indirect_offsets(), sizeof(wire::HuffmanIndirectOffset)));
+            result.push_back(vectorRange(
+                StorageSection::Decoder, tables->indirect(), sizeof(wire::HuffmanTableEntry)));
+        }
     }
 
     return result;
 }
 
 std::shared_ptr<Compressor> TrainedCompressionStrategy::createCompressor(
-    flatbuffers::FlatBufferBuilder& builder, size_t bitsPerWeight) const
+    flatbuffers::FlatBufferBuilder& builder,
+    size_t bitsPerWeight,
+    const CompressionOptions& options) const
 {
-    return std::make_shared<TrainedCompressor>(builder, bitsPerWeight);
+    return std::make_shared<TrainedCompressor>(builder, bitsPerWeight, options);
 }
 
 std::shared_ptr<CompressedStorage> TrainedCompressionStrategy::createCompressedStorage(
-    const void* flatStorage, size_t dim) const
+    const void* flatStorage, size_t dim, const DecodingOptions& options) const
 {
-    return std::make_shared<TrainedCompressedStorage>(flatStorage, dim);
+    return std::make_shared<TrainedCompressedStorage>(flatStorage, dim, options);
 }
 
 std::string TrainedCompressionStrategy::storageName() const
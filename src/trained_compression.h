@@ -1,60 +1,69 @@
 #pragma once
 
-#include "prefix_code.h"
-#include "compression_strategy.h"
+#include "centroid_compression.h"
 #include "huffman_decoder.h"
+#include "huffman_encoder.h"
 
 namespace memb {
 
-class TrainedCompressedStorage : public CompressedStorage {
+class TrainedCompressedStorage : public CentroidCompressedStorage {
 public:
-    static const size_t DEFAULT_DECODE_TABLE_BIT_LENGTH = 10;
-
     TrainedCompressedStorage(
         const void* flatStorage,
         size_t dim,
-        size_t maxDirectDecodeBitLength = DEFAULT_DECODE_TABLE_BIT_LENGTH);
-    virtual bool extract(const std::string& word, float* destination) const override;
-    virtual std::vector<std::string> keys() const override;
+        const DecodingOptions& options = DecodingOptions());
+    virtual void extractById(size_t wordId, float* destination) const override;
+    // Decoding starts from the closest checkpoint and stops at end
+    virtual void extractRangeById(
+        size_t wordId, size_t dim, size_t begin, size_t end, float* destination) const override;
+    virtual std::vector<MemoryRange> memoryRanges() const override;
+
+protected:
+    virtual void decodeCodes(size_t wordId, uint8_t* codes) const override;
 
 private:
+    // Calls consume(index, code) for codes of the vector from the checkpoint
+    // before begin to end, codes before begin are passed too
+    template <typename Consumer>
+    void decodeVector(size_t wordId, size_t begin, size_t end, Consumer&& consume) const;
+    template <size_t Streams, typename Consumer>
+    void decodeStreams(const uint8_t* data, size_t begin, size_t end, Consumer&& consume) const;
+
     const wire::Trained* flatStorage_;
-    size_t dim_;
-    HuffmanTableDecoder huffmanDecoder_;
-    std::vector<float> centroids_;
+    // One decoder per codebook block of blockSize_ dimensions
+    std::vector<HuffmanTableDecoder> huffmanDecoders_;
+    size_t blockSize_;
+    size_t checkpointInterval_;
+    size_t checkpointsCount_;
 };
 
-class TrainedCompressor : public Compressor {
+class TrainedCompressor : public CentroidCompressor {
 public:
     TrainedCompressor(
         flatbuffers::FlatBufferBuilder& builder,
-        size_t bitsPerWeight);
+        size_t bitsPerWeight,
+        const CompressionOptions& options);
 
-    virtual void add(
-        const std::string& word,
-        const float* source,
-        size_t dim) override;
-
-    virtual flatbuffers::Offset<void> finalize() override;
+protected:
+    virtual void fitCoder(const std::vector<std::vector<uint8_t>>& codes) override;
+    virtual std::vector<uint8_t> encodeCodes(const std::vector<uint8_t>& codes) const override;
+    virtual flatbuffers::Offset<void> createStorage(const StorageParts& parts) override;
 
 private:
-    struct WordVector {
-        std::string word;
-        std::vector<float> values;
-    };
-
-    std::vector<WordVector> embeddings_;
-    flatbuffers::FlatBufferBuilder& builder_;
-    uint8_t quantizationLevels_;
+    std::vector<HuffmanEncoder> encoders_;
+    // Zero when one codebook covers all dimensions
+    size_t blockSize_;
 };
 
 class TrainedCompressionStrategy : public CompressionStrategy {
 public:
     virtual std::shared_ptr<Compressor> createCompressor(
-        flatbuffers::FlatBufferBuilder& builder, size_t bitsPerWeight) const override;
+        flatbuffers::FlatBufferBuilder& builder,
+        size_t bitsPerWeight,
+        const CompressionOptions& options) const override;
 
     virtual std::shared_ptr<CompressedStorage> createCompressedStorage(
-        const void* flatStorage, size_t dim) const override;
+        const void* flatStorage, size_t dim, const DecodingOptions& options) const override;
 
     virtual std::string storageName() const override;
 
@@ -1,5 +1,7 @@
 #include "uniform_compression.h"
 
+#include <algorithm>
+
 namespace memb {
 
 UniformCompressor::UniformCompressor(flatbuffers::FlatBufferBuilder& builder, size_t bitsPerWeight):
@@ -10,7 +12,8 @@ UniformCompressor::UniformCompressor(flatbuffers::FlatBufferBuilder& builder, si
 void UniformCompressor::add(
     const std::string& word,
     const float* source,
-    size_t dim)
+    size_t dim,
+    double)
 {
     auto minMaxValues = std::minmax_element(source, source + dim);
     auto minValue = *(minMaxValues.first);
@@ -51,52 +54,73 @@ UniformCompressedStorage::UniformCompressedStorage(const void* flatStorage):
     flatStorage_(static_cast<const wire::Uniform*>(flatStorage))
 {}
 
-bool UniformCompressedStorage::extract(const std::string& word, float* destination) const
+int64_t UniformCompressedStorage::wordId(const std::string& word) const
 {
-    auto resultNode = flatStorage_->nodes()->LookupByKey(word.c_str());
-    if (resultNode) {
-        auto uniformStorage = resultNode->compressed_values();
-        auto minValue = uniformStorage->min_value();
-        auto maxValue = uniformStorage->max_value();
-        auto values = uniformStorage->values();
-        auto quantizationLevels = flatStorage_->quantization_levels();
-
-        std::transform(
-            values->begin(),
-            values->end(),
-            destination,
-            [minValue, maxValue, quantizationLevels](uint8_t value)
-            {
-                auto floatValue = static_cast<float>(value);
-                return minValue + (maxValue - minValue) * floatValue / quantizationLevels;
-            });
-        return true;
+    auto nodes = flatStorage_->nodes();
+    auto resultIt = std::lower_bound(
+        nodes->begin(),
+        nodes->end(),
+        word.c_str(),
+        [](const wire::UniformQuantizedNode* node, const char* word)
+        {
+            return node->KeyCompareWithValue(word) < 0;
+        });
+
+    if (resultIt != nodes->end() && resultIt->KeyCompareWithValue(word.c_str()) == 0) {
+        return resultIt - nodes->begin();
     } else {
-        return false;
+        return MISSING_WORD;
     }
 }
 
-std::vector<std::string> UniformCompressedStorage::keys() const
+size_t UniformCompressedStorage::size() const
 {
-    std::vector<std::string> result;
-    result.reserve(flatStorage_->nodes()->size());
+    return flatStorage_->nodes()->size();
+}
 
-    for (const auto& node : *flatStorage_->nodes()) {
-        result.emplace_back(node->word()->begin(), node->word()->end());
-    }
+void UniformCompressedStorage::extractById(size_t wordId, float* destination) const
+{
+    auto size = flatStorage_->nodes()->Get(wordId)->compressed_values()->values()->size();
+    extractRangeById(wordId, size, 0, size, destination);
+}
 
-    return result;
+void UniformCompressedStorage::extractRangeById(
+    size_t wordId, size_t, size_t begin, size_t end, float* destination) const
+{
+    auto uniformStorage = flatStorage_->nodes()->Get(wordId)->compressed_values();
+    auto minValue = uniformStorage->min_value();
+    auto maxValue = uniformStorage->max_value();
+    auto values = uniformStorage->values();
+    auto quantizationLevels = flatStorage_->quantization_levels();
+
+    std::transform(
+        values->begin() + begin,
+        values->begin() + end,
+        destination,
+        [minValue, maxValue, quantizationLevels](uint8_t value)
+        {
+            auto floatValue = static_cast<float>(value);
+            return minValue + (maxValue - minValue) * floatValue / quantizationLevels;
+        });
+}
+
+boost::string_view UniformCompressedStorage::word(size_t wordId) const
+{
+    auto word = flatStorage_->nodes()->Get(wordId)->word();
+    return boost::string_view(word->c_str(), word->size());
 }
 
 
 std::shared_ptr<Compressor> UniformCompressionStrategy::createCompressor(
-    flatbuffers::FlatBufferBuilder& builder, size_t bitsPerWeight) const
+    flatbuffers::FlatBufferBuilder& builder,
+    size_t bitsPerWeight,
+    const CompressionOptions& /*options*/) const
 {
     return std::make_shared<UniformCompressor>(builder, bitsPerWeight);
 }
 
 std::shared_ptr<CompressedStorage> UniformCompressionStrategy::createCompressedStorage(
-    const void* flatStorage, size_t /*dim*/) const
+    const void* flatStorage, size_t /*dim*/, const DecodingOptions& /*options*/) const
 {
     return std::make_shared<UniformCompressedStorage>(flatStorage);
 }
@@ -9,8 +9,12 @@ namespace memb {
 class UniformCompressedStorage : public CompressedStorage {
 public:
     UniformCompressedStorage(const void* flatStorage);
-    virtual bool extract(const std::string& word, float* destination) const override;
-    virtual std::vector<std::string> keys() const override;
+    virtual int64_t wordId(const std::string& word) const override;
+    virtual size_t size() const override;
+    virtual void extractById(size_t wordId, float* destination) const override;
+    virtual void extractRangeById(
+        size_t wordId, size_t dim, size_t begin, size_t end, float* destination) const override;
+    virtual boost::string_view word(size_t wordId) const override;
 
 private:
     const wire::Uniform* flatStorage_;
@@ -23,7 +27,8 @@ public:
     virtual void add(
         const std::string& word,
         const float* source,
-        size_t dim) override;
+        size_t dim,
+        double frequency) override;
 
     virtual flatbuffers::Offset<void> finalize() override;
 
@@ -36,10 +41,12 @@ private:
 class UniformCompressionStrategy : public CompressionStrategy {
 public:
     virtual std::shared_ptr<Compressor> createCompressor(
-        flatbuffers::FlatBufferBuilder& builder, size_t bitsPerWeight) const override;
+        flatbuffers::FlatBufferBuilder& builder,
+        size_t bitsPerWeight,
+        const CompressionOptions& options) const override;
 
     virtual std::shared_ptr<CompressedStorage> createCompressedStorage(
-        const void* flatStorage, size_t dim) const override;
+        const void* flatStorage, size_t dim, const DecodingOptions& options) const override;
 
     virtual std::string storageName() const override;
 
@@ -0,0 +1,205 @@
+#include "vector_cache.h"
+
+#include <algorithm>
+
+namespace memb {
+
+namespace {
+
+size_t mixWordId(size_t wordId)
+{
+    uint64_t value = wordId;
+    value = (value ^ (value >> 30)) * 0xbf58476d1ce4e5b9ULL;
+    value = (value ^ (value >> 27)) * 0x94d049bb133111ebULL;
+    return value ^ (value >> 31);
+}
+
+} // namespace
+
+const size_t VectorCache::DEFAULT_SHARDS_COUNT;
+
+VectorCache::VectorCache(size_t dim, size_t capacityBytes, size_t shardsCount):
+    dim_(dim),
+    shardsCount_(std::max<size_t>(
+        1, std::min(shardsCount, capacityBytes / (dim * sizeof(float))))),
+    shardCapacity_(capacityBytes / (dim * sizeof(float)) / shardsCount_),
+    shards_(new Shard[shardsCount_])
+{
+    for (size_t i = 0; i < shardsCount_; ++i) {
+        shards_[i].slotsByWord.reserve(shardCapacity_);
+        shards_[i].referenced.reset(new std::atomic<bool>[shardCapacity_]);
+    }
+}
+
+bool VectorCache::lookup(size_t wordId, float* destination) const
+{
+    return lookupRange(wordId, 0, dim_, destination);
+}
+
+bool VectorCache::lookupRange(size_t wordId, size_t begin, size_t end, float* destination) const
+{
+    auto& currentShard = shard(wordId);
+    std::shared_lock<std::shared_timed_mutex> lock(currentShard.mutex);
+
+    auto slotIt = currentShard.slotsByWord.find(wordId);
+    if (slotIt == currentShard.slotsByWord.end()) {
+        currentShard.misses.fetch_add(1, std::memory_order_relaxed);
+        return false;
+    }
+
+    currentShard.hits.fetch_add(1, std::memory_order_relaxed);
+    currentShard.referenced[slotIt->second].store(true, std::memory_order_relaxed);
+    auto values = currentShard.values.data() + slotIt->second * dim_;
+    std::copy(values + begin, values + end, destination);
+
+    return true;
+}
+
+void VectorCache::insert(size_t wordId, const float* values) const
+{
+    if (shardCapacity_ == 0) {
+        return;
+    }
+
+    auto& currentShard = shard(wordId);
+    std::lock_guard<std::shared_timed_mutex> lock(currentShard.mutex);
+
+    if (currentShard.slotsByWord.count(wordId)) {
+        return;
+    }
+
+    size_t slot;
+    if (currentShard.slotWords.size() < shardCapacity_) {
+        slot = currentShard.slotWords.size();
+        currentShard.slotWords.push_back(wordId);
+        currentShard.referenced[slot].store(false, std::memory_order_relaxed);
+        currentShard.values.resize(currentShard.values.size() + dim_);
+    } else {
+        while (currentShard.referenced[currentShard.hand].exchange(false, std::memory_order_relaxed)) {
+            currentShard.hand = (currentShard.hand + 1) % shardCapacity_;
+        }
+        slot = currentShard.hand;
+        currentShard.hand = (currentShard.hand + 1) % shardCapacity_;
+
+        currentShard.slotsByWord.erase(currentShard.slotWords[slot]);
+        currentShard.slotWords[slot] = wordId;
+    }
+
+    currentShard.slotsByWord[wordId] = slot;
+    std::copy(values, values + dim_, currentShard.values.data() + slot * dim_);
+}
+
+size_t VectorCache::capacity() const
+{
+    return shardCapacity_ * shardsCount_;
+}
+
+CacheStatistics VectorCache::statistics() const
+{
+    CacheStatistics result;
+    result.capacity = capacity();
+
+    for (size_t i = 0; i < shardsCount_; ++i) {
+        std::shared_lock<std::shared_timed_mutex> lock(shards_[i].mutex);
+        result.hits += shards_[i].hits.load(std::memory_order_relaxed);
+        result.misses += shards_[i].misses.load(std::memory_order_relaxed);
+        result.entries += shards_[i].slotWords.size();
+    }
+
+    return result;
+}
+
+VectorCache::Shard& VectorCache::shard(size_t wordId) const
+{
+    return shards_[mixWordId(wordId) % shardsCount_];
+}
+
+CachedCompressedStorage::CachedCompressedStorage(
+        std::shared_ptr<CompressedStorage> storage, size_t dim, size_t capacityBytes):
+    storage_(storage),
+    cache_(dim, capacityBytes)
+{}
+
+int64_t CachedCompressedStorage::wordId(const std::string& word) const
+{
+    return storage_->wordId(word);
+}
+
+std::vector<int64_t> CachedCompressedStorage::sortedWordIds(
+    const std::vector<const std::string*>& words) const
+{
+    return storage_->sortedWordIds(words);
+}
+
+size_t CachedCompressedStorage::size() const
+{
+    return storage_->size();
+}
+
+void CachedCompressedStorage::extractById(size_t wordId, float* destination) const
+{
+    if (!cache_.lookup(wordId, destination)) {
+        storage_->extractById(wordId, destination);
+        cache_.insert(wordId, destination);
+    }
+}
+
+// Ranges are sliced from cached vectors, but partial vectors
+// cannot fill cache entries, so misses decode from the storage
+void CachedCompressedStorage::extractRangeById(
+    size_t wordId, size_t dim, size_t begin, size_t end, float* destination) const
+{
+    if (!cache_.lookupRange(wordId, begin, end, destination)) {
+        storage_->extractRangeById(wordId, dim, begin, end, destination);
+    }
+}
+
+boost::string_view CachedCompressedStorage::word(size_t wordId) const
+{
+    return storage_->word(wordId);
+}
+
+ScoringQueries CachedCompressedStorage::prepareScoring(
+    const float* queries, size_t queriesCount, size_t dim) const
+{
+    return storage_->prepareScoring(queries, queriesCount, dim);
+}
+
+// Scans would evict all the frequent words, so they bypass the cache
+void CachedCompressedStorage::scoreBatch(
+    const ScoringQueries& queries,
+    SimilarityMetric metric,
+    const uint32_t* wordIds,
+    size_t wordsCount,
+    float* scores) const
+{
+    storage_->scoreBatch(queries, metric, wordIds, wordsCount, scores);
+}
+
+void CachedCompressedStorage::scorePairs(
+    size_t dim,
+    SimilarityMetric metric,
+    const int64_t* firstIds,
+    const int64_t* secondIds,
+    size_t pairsCount,
+    float* scores) const
+{
+    storage_->scorePairs(dim, metric, firstIds, secondIds, pairsCount, scores);
+}
+
+std::vector<MemoryRange> CachedCompressedStorage::memoryRanges() const
+{
+    return storage_->memoryRanges();
+}
+
+void CachedCompressedStorage::prefetch(const std::vector<int64_t>& wordIds) const
+{
+    storage_->prefetch(wordIds);
+}
+
+CacheStatistics CachedCompressedStorage::statistics() const
+{
+    return cache_.statistics();
+}
+
+}
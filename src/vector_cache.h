@@ -0,0 +1,100 @@
+#pragma once
+
+#include "compression_strategy.h"
+
+#include <atomic>
+#include <memory>
+#include <mutex>
+#include <shared_mutex>
+#include <unordered_map>
+#include <vector>
+
+namespace memb {
+
+struct CacheStatistics {
+    size_t hits = 0;
+    size_t misses = 0;
+    size_t entries = 0;
+    size_t capacity = 0;
+};
+
+// Memory bounded cache of decoded vectors keyed by word id.
+// Entries are spread over independently locked shards and
+// evicted with the CLOCK (second chance) policy. Lookups share
+// the lock of a shard and only set atomic reference bits.
+class VectorCache {
+public:
+    static const size_t DEFAULT_SHARDS_COUNT = 16;
+
+    VectorCache(size_t dim, size_t capacityBytes, size_t shardsCount = DEFAULT_SHARDS_COUNT);
+
+    bool lookup(size_t wordId, float* destination) const;
+    // Copies dimensions [begin, end) of a cached vector
+    bool lookupRange(size_t wordId, size_t begin, size_t end, float* destination) const;
+    void insert(size_t wordId, const float* values) const;
+
+    size_t capacity() const;
+    CacheStatistics statistics() const;
+
+private:
+    struct Shard {
+        std::shared_timed_mutex mutex;
+        std::unordered_map<size_t, size_t> slotsByWord;
+        std::vector<size_t> slotWords;
+        // Allocated for the whole shard capacity
+        std::unique_ptr<std::atomic<bool>[]> referenced;
+        std::vector<float> values;
+        size_t hand = 0;
+        std::atomic<size_t> hits{0};
+        std::atomic<size_t> misses{0};
+    };
+
+    Shard& shard(size_t wordId) const;
+
+    size_t dim_;
+    size_t shardsCount_;
+    size_t shardCapacity_;
+    std::unique_ptr<Shard[]> shards_;
+};
+
+// Serves extractById from the cache and fills it on misses,
+// everything else is forwarded to the wrapped storage
+class CachedCompressedStorage : public CompressedStorage {
+public:
+    CachedCompressedStorage(
+        std::shared_ptr<CompressedStorage> storage, size_t dim, size_t capacityBytes);
+
+    virtual int64_t wordId(const std::string& word) const override;
+    virtual std::vector<int64_t> sortedWordIds(
+        const std::vector<const std::string*>& words) const override;
+    virtual size_t size() const override;
+    virtual void extractById(size_t wordId, float* destination) const override;
+    virtual void extractRangeById(
+        size_t wordId, size_t dim, size_t begin, size_t end, float* destination) const override;
+    virtual boost::string_view word(size_t wordId) const override;
+    virtual ScoringQueries prepareScoring(
+        const float* queries, size_t queriesCount, size_t dim) const override;
+    virtual void scoreBatch(
+        const ScoringQueries& queries,
+        SimilarityMetric metric,
+        const uint32_t* wordIds,
+        size_t wordsCount,
+        float* scores) const override;
+    virtual void scorePairs(
+        size_t dim,
+        SimilarityMetric metric,
+        const int64_t* firstIds,
+        const int64_t* secondIds,
+        size_t pairsCount,
+        float* scores) const override;
+    virtual std::vector<MemoryRange> memoryRanges() const override;
+    virtual void prefetch(const std::vector<int64_t>& wordIds) const override;
+
+    CacheStatistics statistics() const;
+
+private:
+    std::shared_ptr<CompressedStorage> storage_;
+    VectorCache cache_;
+};
+
+}
@@ -0,0 +1,104 @@
+#include "vector_cache.h"
+
+#include <boost/test/unit_test.hpp>
+
+#include <future>
+
+using namespace memb;
+
+namespace {
+
+const size_t DIM = 4;
+
+std::vector<float> testVector(size_t wordId)
+{
+    return std::vector<float>(DIM, static_cast<float>(wordId));
+}
+
+} // namespace
+
+BOOST_AUTO_TEST_SUITE(vectorCache)
+
+BOOST_AUTO_TEST_CASE(hitsReturnInsertedValues)
+{
+    VectorCache cache(DIM, 100 * DIM * sizeof(float));
+    std::vector<float> result(DIM);
+
+    BOOST_CHECK(!cache.lookup(7, result.data()));
+    cache.insert(7, testVector(7).data());
+    BOOST_CHECK(cache.lookup(7, result.data()));
+    BOOST_CHECK(result == testVector(7));
+
+    auto statistics = cache.statistics();
+    BOOST_CHECK_EQUAL(statistics.hits, 1);
+    BOOST_CHECK_EQUAL(statistics.misses, 1);
+    BOOST_CHECK_EQUAL(statistics.entries, 1);
+    BOOST_CHECK_EQUAL(statistics.capacity, 96);
+}
+
+BOOST_AUTO_TEST_CASE(evictionKeepsCapacity)
+{
+    VectorCache cache(DIM, 8 * DIM * sizeof(float), 1);
+    std::vector<float> result(DIM);
+
+    for (size_t wordId = 0; wordId < 8; ++wordId) {
+        cache.insert(wordId, testVector(wordId).data());
+    }
+    BOOST_REQUIRE(cache.lookup(3, result.data()));
+
+    for (size_t wordId = 8; wordId < 15; ++wordId) {
+        cache.insert(wordId, testVector(wordId).data());
+    }
+
+    BOOST_CHECK_EQUAL(cache.statistics().entries, 8);
+    BOOST_CHECK(cache.lookup(3, result.data()));
+    BOOST_CHECK(result == testVector(3));
+    BOOST_CHECK(cache.lookup(14, result.data()));
+    BOOST_CHECK(result == testVector(14));
+}
+
+BOOST_AUTO_TEST_CASE(tinyBudgetDisablesCache)
+{
+    VectorCache cache(DIM, DIM * sizeof(float) - 1);
+    std::vector<float> result(DIM);
+
+    cache.insert(1, testVector(1).data());
+    BOOST_CHECK(!cache.lookup(1, result.data()));
+    BOOST_CHECK_EQUAL(cache.capacity(), 0);
+}
+
+BOOST_AUTO_TEST_CASE(concurrentAccessWorks)
+{
+    VectorCache cache(DIM, 64 * DIM * sizeof(float));
+
+    std::vector<std::future<bool>> results;
+    for (size_t thread = 0; thread < 4; ++thread) {
+        results.push_back(std::async(
+            std::launch::async,
+            [&cache, thread]
+            {
+                std::vector<float> result(DIM);
+                bool valid = true;
+                for (size_t i = 0; i < 10000; ++i) {
+                    size_t wordId = (i * 31 + thread) % 200;
+                    if (cache.lookup(wordId, result.data())) {
+                        valid = valid && result == testVector(wordId);
+                    } else {
+                        cache.insert(wordId, testVector(wordId).data());
+                    }
+                }
+
+                return valid;
+            }));
+    }
+
+    for (auto& result : results) {
+        BOOST_CHECK(result.get());
+    }
+
+    auto statistics = cache.statistics();
+    BOOST_CHECK_EQUAL(statistics.hits + statistics.misses, 40000);
+    BOOST_CHECK(statistics.entries <= statistics.capacity);
+}
+
+BOOST_AUTO_TEST_SUITE_END()
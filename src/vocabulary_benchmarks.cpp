@@ -0,0 +1,111 @@
+#include "benchmark.h"
+#include "packed_vocabulary.h"
+#include "trained_compression_generated.h"
+
+#include <boost/test/unit_test.hpp>
+
+#include <algorithm>
+#include <random>
+
+using namespace memb;
+
+namespace {
+
+const size_t QUERIES_COUNT = 1000000;
+const size_t MIN_WORD_LENGTH = 2;
+const size_t MAX_WORD_LENGTH = 14;
+
+std::vector<std::string> randomSortedWords(size_t count, std::mt19937& generator)
+{
+    std::uniform_int_distribution<size_t> lengthDistribution(MIN_WORD_LENGTH, MAX_WORD_LENGTH);
+    std::uniform_int_distribution<int> letterDistribution('a', 'z');
+
+    std::vector<std::string> words;
+    while (words.size() < count) {
+        while (words.size() < count) {
+            std::string word(lengthDistribution(generator), ' ');
+            for (auto& letter : word) {
+                letter = static_cast<char>(letterDistribution(generator));
+            }
+            words.push_back(word);
+        }
+        std::sort(words.begin(), words.end());
+        words.erase(std::unique(words.begin(), words.end()), words.end());
+    }
+
+    return words;
+}
+
+void vocabularyBenchmarkImpl(size_t wordsCount)
+{
+    std::mt19937 generator(42);
+    auto words = randomSortedWords(wordsCount, generator);
+
+    std::string packedWords;
+    std::vector<uint32_t> wordOffsets;
+    for (const auto& word : words) {
+        wordOffsets.push_back(packedWords.size());
+        packedWords.insert(packedWords.size(), word.c_str(), word.size() + 1);
+    }
+
+    flatbuffers::FlatBufferBuilder builder;
+    auto flatWordOffsets = builder.CreateVector(wordOffsets);
+    auto flatPackedWords = builder.CreateString(packedWords);
+    auto flatPerfectHash = PerfectHashIndexBuilder(words).save(builder);
+    auto flatSearchTree = SearchTreeBuilder(words).save(builder);
+    builder.Finish(wire::CreateTrained(
+        builder, flatWordOffsets, 0, flatPackedWords, 0, 0, 0, flatPerfectHash, flatSearchTree));
+    auto trained = flatbuffers::GetRoot<wire::Trained>(builder.GetBufferPointer());
+
+    std::vector<std::string> queries;
+    std::uniform_int_distribution<size_t> wordDistribution(0, words.size() - 1);
+    for (size_t i = 0; i < QUERIES_COUNT; ++i) {
+        queries.push_back(i % 10 == 0 ? words[wordDistribution(generator)] + "#" : words[wordDistribution(generator)]);
+    }
+
+    std::vector<std::pair<std::string, PackedVocabulary>> vocabularies = {
+        {"lower_bound", PackedVocabulary(trained->word_offsets(), trained->packed_words(), nullptr, nullptr)},
+        {"eytzinger", PackedVocabulary(trained->word_offsets(), trained->packed_words(), nullptr, trained->search_tree())},
+        {"perfect hash", PackedVocabulary(trained->word_offsets(), trained->packed_words(), trained->perfect_hash(), nullptr)},
+    };
+
+    int64_t expectedChecksum = 0;
+    for (const auto& item : vocabularies) {
+        int64_t checksum = 0;
+        auto seconds = measureSeconds(
+            [&]()
+            {
+                for (const auto& query : queries) {
+                    checksum += item.second.find(query);
+                }
+            });
+
+        if (item.first == vocabularies.front().first) {
+            expectedChecksum = checksum;
+        }
+        BOOST_CHECK_EQUAL(checksum, expectedChecksum);
+
+        reportThroughput(item.first + " (" + std::to_string(words.size()) + " words)", queries.size(), seconds);
+    }
+}
+
+} // namespace
+
+BOOST_AUTO_TEST_SUITE(vocabularyLookup)
+
+BOOST_AUTO_TEST_CASE(vocabulary100k)
+{
+    vocabularyBenchmarkImpl(100000);
+}
+
+BOOST_AUTO_TEST_CASE(vocabulary2M)
+{
+    vocabularyBenchmarkImpl(2000000);
+}
+
+BOOST_AUTO_TEST_CASE(vocabulary10M)
+{
+    vocabularyBenchmarkImpl(10000000);
+}
+
+BOOST_AUTO_TEST_SUITE_END()
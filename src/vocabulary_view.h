@@ -0,0 +1,93 @@
+#pragma once
+
+#include "compression_strategy.h"
+
+#include <boost/iterator/iterator_facade.hpp>
+
+namespace memb {
+
+// Sorted words of a storage without copying them out of the mapped file.
+// The view and the string_views it yields are valid while the reader is alive.
+class VocabularyView {
+public:
+    class Iterator : public boost::iterator_facade<
+        Iterator, boost::string_view, boost::random_access_traversal_tag, boost::string_view>
+    {
+    public:
+        Iterator():
+            storage_(nullptr),
+            wordId_(0)
+        {}
+
+        Iterator(const CompressedStorage* storage, size_t wordId):
+            storage_(storage),
+            wordId_(wordId)
+        {}
+
+    private:
+        friend class boost::iterator_core_access;
+
+        boost::string_view dereference() const
+        {
+            return storage_->word(wordId_);
+        }
+
+        bool equal(const Iterator& other) const
+        {
+            return wordId_ == other.wordId_;
+        }
+
+        void increment()
+        {
+            ++wordId_;
+        }
+
+        void decrement()
+        {
+            --wordId_;
+        }
+
+        void advance(std::ptrdiff_t distance)
+        {
+            wordId_ += distance;
+        }
+
+        std::ptrdiff_t distance_to(const Iterator& other) const
+        {
+            return static_cast<std::ptrdiff_t>(other.wordId_) - static_cast<std::ptrdiff_t>(wordId_);
+        }
+
+        const CompressedStorage* storage_;
+        size_t wordId_;
+    };
+
+    explicit VocabularyView(const CompressedStorage* storage):
+        storage_(storage)
+    {}
+
+    size_t size() const
+    {
+        return storage_->size();
+    }
+
+    // Word ids are indices in the view
+    boost::string_view operator[](size_t wordId) const
+    {
+        return storage_->word(wordId);
+    }
+
+    Iterator begin() const
+    {
+        return Iterator(storage_, 0);
+    }
+
+    Iterator end() const
+    {
+        return Iterator(storage_, size());
+    }
+
+private:
+    const CompressedStorage* storage_;
+};
+
+}